@@ -0,0 +1,200 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "general_purpose_allocator.hpp"
+#include "hashmap.hpp"
+#include "traits.hpp"
+#include "defines.hpp"
+#include "utility.hpp"
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+
+namespace sf {
+
+// HashMap split into SHARD_COUNT shards, each behind its own reader-writer lock.
+// The key is hashed once: the top bits of the hash pick the shard and the shard's map
+// takes the same hash, using its low bits for the bucket, so both stay uniform. Allocator is shared by all shards and must be thread safe
+// (GeneralPurposeAllocator is, linear/stack allocators are not).
+template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, u32 SHARD_COUNT = 64, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct ConcurrentHashMap {
+public:
+    using KeyType = K;
+    using ValueType = V;
+    using MapType = HashMap<K, V, Allocator, 32, Hasher, KeyEqual>;
+
+    static_assert(SHARD_COUNT > 0 && std::has_single_bit(SHARD_COUNT), "Shard count should be a power of 2");
+
+    // own cache line per shard, so locking one does not invalidate its neighbours
+    struct alignas(64) Shard {
+        std::shared_mutex lock;
+        MapType           map;
+
+        Shard(u32 prealloc_count, Allocator* allocator, const HashMapConfig& config, Hasher hasher, KeyEqual equal)
+            : map{prealloc_count, allocator, config, hasher, equal}
+        {}
+    };
+private:
+    alignas(Shard) u8   _shards_storage[sizeof(Shard) * SHARD_COUNT];
+    [[no_unique_address]] Hasher _hasher;
+public:
+    static constexpr u32 SHARD_BITS = std::countr_zero(SHARD_COUNT);
+
+    ConcurrentHashMap(const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : ConcurrentHashMap(SHARD_COUNT * 32, get_current_gpa(), config, hasher, equal)
+    {}
+
+    ConcurrentHashMap(Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : ConcurrentHashMap(SHARD_COUNT * 32, allocator, config, hasher, equal)
+    {}
+
+    ConcurrentHashMap(u32 prealloc_count, Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _hasher{hasher}
+    {
+        SF_ASSERT_MSG(allocator, "Should be valid pointer");
+        u32 shard_prealloc = std::max(prealloc_count / SHARD_COUNT, 1u);
+        for (u32 i{0}; i < SHARD_COUNT; ++i) {
+            ::new (shards() + i) Shard{shard_prealloc, allocator, config, hasher, equal};
+        }
+    }
+
+    // shards own mutexes, which can not be moved
+    ConcurrentHashMap(ConcurrentHashMap&& rhs) = delete;
+    ConcurrentHashMap& operator=(ConcurrentHashMap&& rhs) = delete;
+    ConcurrentHashMap(const ConcurrentHashMap& rhs) = delete;
+    ConcurrentHashMap& operator=(const ConcurrentHashMap& rhs) = delete;
+
+    ~ConcurrentHashMap() noexcept {
+        for (u32 i{0}; i < SHARD_COUNT; ++i) {
+            shards()[i].~Shard();
+        }
+    }
+
+    // updates entry with the same key
+    template<typename Key, typename Val>
+    void put(Key&& key, Val&& val) noexcept {
+        u64 hash = hash_key(key);
+        Shard& shard = shards()[shard_of(hash)];
+        std::unique_lock guard{shard.lock};
+        shard.map.put_with_hash(std::forward<Key>(key), std::forward<Val>(val), hash);
+    }
+
+    // put without update
+    template<typename Key, typename Val>
+    bool put_if_empty(Key&& key, Val&& val) noexcept {
+        u64 hash = hash_key(key);
+        Shard& shard = shards()[shard_of(hash)];
+        std::unique_lock guard{shard.lock};
+        return shard.map.put_if_empty_with_hash(std::forward<Key>(key), std::forward<Val>(val), hash);
+    }
+
+    // calls 'callback(const V&)' under the shard's shared lock, the reference must not
+    // outlive the call; returns false and skips the callback when the key is missing
+    template<typename F>
+    bool get(ConstLRefOrValType<K> key, F&& callback) noexcept {
+        u64 hash = hash_key(key);
+        Shard& shard = shards()[shard_of(hash)];
+        std::shared_lock guard{shard.lock};
+        V* value = shard.map.get_with_hash(key, hash);
+        if (!value) {
+            return false;
+        }
+
+        callback(static_cast<const V&>(*value));
+        return true;
+    }
+
+    // copy of the value, for cheap to copy values
+    bool get_copy(ConstLRefOrValType<K> key, V& out) noexcept {
+        return get(key, [&out](const V& value) { out = value; });
+    }
+
+    // calls 'callback(V&)' under the shard's exclusive lock, for in place updates
+    template<typename F>
+    bool update(ConstLRefOrValType<K> key, F&& callback) noexcept {
+        u64 hash = hash_key(key);
+        Shard& shard = shards()[shard_of(hash)];
+        std::unique_lock guard{shard.lock};
+        V* value = shard.map.get_with_hash(key, hash);
+        if (!value) {
+            return false;
+        }
+
+        callback(*value);
+        return true;
+    }
+
+    bool remove(ConstLRefOrValType<K> key) noexcept {
+        u64 hash = hash_key(key);
+        Shard& shard = shards()[shard_of(hash)];
+        std::unique_lock guard{shard.lock};
+        return shard.map.remove_with_hash(key, hash);
+    }
+
+    // calls 'fn(const K&, const V&)' for every entry of one shard under its shared lock,
+    // other shards stay writable meanwhile
+    template<typename F>
+    void for_each_in_shard(u32 shard_index, F&& fn) noexcept {
+        SF_ASSERT_MSG(shard_index < SHARD_COUNT, "Out of bounds");
+        Shard& shard = shards()[shard_index];
+        std::shared_lock guard{shard.lock};
+
+        for (auto& bucket : shard.map) {
+            if (bucket.hash >= MapType::FIRST_VALID_HASH) {
+                fn(static_cast<const K&>(bucket.key), static_cast<const V&>(bucket.value));
+            }
+        }
+    }
+
+    // shard by shard, not a snapshot of the whole map
+    template<typename F>
+    void for_each(F&& fn) noexcept {
+        for (u32 i{0}; i < SHARD_COUNT; ++i) {
+            for_each_in_shard(i, fn);
+        }
+    }
+
+    // sum over shards locked one at a time, exact only without concurrent writers
+    u32 count() noexcept {
+        u32 total{0};
+        for (u32 i{0}; i < SHARD_COUNT; ++i) {
+            std::shared_lock guard{shards()[i].lock};
+            total += shards()[i].map.count();
+        }
+        return total;
+    }
+
+    void clear() noexcept {
+        for (u32 i{0}; i < SHARD_COUNT; ++i) {
+            std::unique_lock guard{shards()[i].lock};
+            shards()[i].map.clear();
+        }
+    }
+
+    static constexpr u32 shard_count() noexcept { return SHARD_COUNT; }
+
+    u32 shard_index(ConstLRefOrValType<K> key) const noexcept {
+        return shard_of(hash_key(key));
+    }
+private:
+    Shard* shards() noexcept {
+        return reinterpret_cast<Shard*>(_shards_storage);
+    }
+
+    // the same value HashMap::hash_key gives, so the shard map can take it as is
+    u64 hash_key(ConstLRefOrValType<K> key) const noexcept {
+        return std::max<u64>(_hasher(key), MapType::FIRST_VALID_HASH);
+    }
+
+    static constexpr u32 shard_of(u64 hash) noexcept {
+        if constexpr (SHARD_BITS == 0) {
+            return 0;
+        } else {
+            return static_cast<u32>(hash >> (64 - SHARD_BITS));
+        }
+    }
+};
+
+} // sf
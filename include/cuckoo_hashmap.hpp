@@ -0,0 +1,620 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "general_purpose_allocator.hpp"
+#include "hashmap.hpp"
+#include "traits.hpp"
+#include "constants.hpp"
+#include "defines.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <algorithm>
+#include <bit>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+namespace sf {
+
+// Bucketized cuckoo hashing: every key has two candidate buckets of SLOTS_PER_BUCKET
+// slots, so a lookup reads at most two buckets plus a small stash that is only
+// scanned while non-empty, whatever the load. Buckets start on a cache line, for keys up
+// to 12 bytes their fingerprints and keys share that line: a lookup probes at most two
+// lines, a hit also reads its value right after the keys. Both buckets are derived from a 32-bit
+// fingerprint stored in the slot, which lets inserts kick entries to their other bucket
+// and lets resize move them without rehashing keys. An insert that runs out of kicks
+// parks the displaced entry in the stash, a full stash grows the table.
+// The alignment costs memory once a bucket outgrows a line: a u64/u64 bucket holds 80
+// bytes and takes 128, 32 bytes a slot instead of 20. Throughput on the 1m lookup bench
+// is the same either way, what the padding buys is the probe bound above, without it a
+// bucket can straddle lines and a miss touches up to four.
+template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, u32 DEFAULT_INIT_CAPACITY = 32, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct CuckooHashMap {
+public:
+    using KeyType = K;
+    using ValueType = V;
+
+    static constexpr u32 SLOTS_PER_BUCKET = 4;
+    static constexpr u32 STASH_SIZE = 8;
+    static constexpr u32 MAX_KICKS = 128;
+    static constexpr u32 MAX_GROWS_PER_INSERT = 4;
+    static constexpr u32 EMPTY_FINGERPRINT = 0;
+    static constexpr usize CACHE_LINE_SIZE = 64;
+
+    // fingerprints first: a miss is decided without touching keys
+    struct BucketFields {
+        u32 fingerprints[SLOTS_PER_BUCKET];
+        K   keys[SLOTS_PER_BUCKET];
+        V   values[SLOTS_PER_BUCKET];
+    };
+
+    static constexpr usize BUCKET_ALIGNMENT = std::max(alignof(BucketFields), std::min(CACHE_LINE_SIZE, std::bit_ceil(sizeof(BucketFields))));
+
+    // aligned to its size up to a cache line, so a small bucket never straddles two
+    // and a large one starts on its own line
+    struct alignas(BUCKET_ALIGNMENT) Bucket : BucketFields {};
+
+    struct StashEntry {
+        K   key;
+        V   value;
+        u32 fingerprint;
+    };
+
+    union Data {
+        u8* ptr;
+        u32 handle;
+    };
+
+    struct Entry {
+        K& key;
+        V& value;
+    };
+
+    // bucket slots first, then the stash
+    struct Iterator {
+    private:
+        Bucket*     _buckets;
+        StashEntry* _stash;
+        u32         _index;
+        u32         _slot_count;
+        u32         _end;
+    public:
+        Iterator(Bucket* buckets, StashEntry* stash, u32 index, u32 slot_count, u32 stash_count) noexcept
+            : _buckets{buckets}
+            , _stash{stash}
+            , _index{index}
+            , _slot_count{slot_count}
+            , _end{slot_count + stash_count}
+        {
+            skip_empty();
+        }
+
+        Entry operator*() const noexcept {
+            if (_index < _slot_count) {
+                Bucket& bucket = _buckets[_index / SLOTS_PER_BUCKET];
+                u32 slot = _index % SLOTS_PER_BUCKET;
+                return Entry{ bucket.keys[slot], bucket.values[slot] };
+            }
+            StashEntry& entry = _stash[_index - _slot_count];
+            return Entry{ entry.key, entry.value };
+        }
+
+        Iterator& operator++() noexcept {
+            ++_index;
+            skip_empty();
+            return *this;
+        }
+
+        friend bool operator==(const Iterator& first, const Iterator& second) noexcept {
+            return first._index == second._index;
+        }
+
+        friend bool operator!=(const Iterator& first, const Iterator& second) noexcept {
+            return first._index != second._index;
+        }
+    private:
+        void skip_empty() noexcept {
+            while (_index < _slot_count && _buckets[_index / SLOTS_PER_BUCKET].fingerprints[_index % SLOTS_PER_BUCKET] == EMPTY_FINGERPRINT) {
+                ++_index;
+            }
+        }
+    };
+private:
+    // buckets followed by the stash, in one allocation
+    Allocator*          _allocator;
+    Data                _data;
+    u32                 _bucket_count;
+    u32                 _count;
+    u32                 _stash_count;
+    HashMapConfig       _config;
+    [[no_unique_address]] Hasher   _hasher;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    static constexpr bool USE_HANDLE = Allocator::using_handle();
+    static constexpr u16 BLOCK_ALIGNMENT = static_cast<u16>(std::max(alignof(Bucket), alignof(StashEntry)));
+
+    static_assert(alignof(Bucket) == CACHE_LINE_SIZE || sizeof(Bucket) == alignof(Bucket));
+
+    CuckooHashMap(const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : CuckooHashMap(DEFAULT_INIT_CAPACITY, get_current_gpa(), config, hasher, equal)
+    {}
+
+    CuckooHashMap(Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : CuckooHashMap(DEFAULT_INIT_CAPACITY, allocator, config, hasher, equal)
+    {}
+
+    CuckooHashMap(u32 prealloc_count, Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _bucket_count{0}
+        , _count{0}
+        , _stash_count{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT_MSG(allocator, "Should be valid pointer");
+        SF_ASSERT(config.grow_factor > 1.0f);
+        SF_ASSERT(config.load_factor > 0.0f && config.load_factor < 1.0f);
+        reset_empty();
+        allocate_buckets(bucket_count_for(prealloc_count));
+    }
+
+    CuckooHashMap(CuckooHashMap&& rhs) noexcept
+        : _allocator{rhs._allocator}
+        , _data{rhs._data}
+        , _bucket_count{rhs._bucket_count}
+        , _count{rhs._count}
+        , _stash_count{rhs._stash_count}
+        , _config{rhs._config}
+        , _hasher{rhs._hasher}
+        , _equal{rhs._equal}
+    {
+        rhs.reset_empty();
+    }
+
+    CuckooHashMap& operator=(CuckooHashMap&& rhs) noexcept
+    {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        free();
+
+        _allocator = rhs._allocator;
+        _data = rhs._data;
+        _bucket_count = rhs._bucket_count;
+        _count = rhs._count;
+        _stash_count = rhs._stash_count;
+        _config = rhs._config;
+        _hasher = rhs._hasher;
+        _equal = rhs._equal;
+
+        rhs.reset_empty();
+        return *this;
+    }
+
+    CuckooHashMap(const CuckooHashMap& rhs) = delete;
+    CuckooHashMap& operator=(const CuckooHashMap& rhs) = delete;
+
+    ~CuckooHashMap() noexcept {
+        free();
+    }
+
+    void free() noexcept {
+        if (_bucket_count == 0) {
+            return;
+        }
+
+        destroy_entries();
+        if constexpr (USE_HANDLE) {
+            _allocator->free_handle(_data.handle, BLOCK_ALIGNMENT);
+        } else {
+            _allocator->free(_data.ptr, BLOCK_ALIGNMENT);
+        }
+        reset_empty();
+    }
+
+    void clear() noexcept {
+        if (_bucket_count == 0) {
+            return;
+        }
+
+        destroy_entries();
+        Bucket* b = buckets();
+        for (u32 i{0}; i < _bucket_count; ++i) {
+            sf_mem_zero(b[i].fingerprints, sizeof(b[i].fingerprints));
+        }
+        _count = 0;
+        _stash_count = 0;
+    }
+
+    void set_allocator(Allocator* alloc) noexcept {
+        SF_ASSERT_MSG(alloc, "Should be valid pointer");
+        _allocator = alloc;
+    }
+
+    // updates entry with the same key
+    template<typename Key, typename Val>
+    void put(Key&& key, Val&& val) noexcept {
+        u32 fingerprint = fingerprint_of<K>(key);
+        V* value = find_value<K>(key, fingerprint);
+        if (value) {
+            *value = std::forward<Val>(val);
+            return;
+        }
+
+        insert_new(K(std::forward<Key>(key)), V(std::forward<Val>(val)), fingerprint);
+    }
+
+    // put without update
+    template<typename Key, typename Val>
+    bool put_if_empty(Key&& key, Val&& val) noexcept {
+        u32 fingerprint = fingerprint_of<K>(key);
+        if (find_value<K>(key, fingerprint)) {
+            return false;
+        }
+
+        insert_new(K(std::forward<Key>(key)), V(std::forward<Val>(val)), fingerprint);
+        return true;
+    }
+
+    // reads at most two buckets and, only when non-empty, the stash
+    V* get(ConstLRefOrValType<K> key) noexcept {
+        return find_value<K>(key, fingerprint_of<K>(key));
+    }
+
+    template<typename Q> requires TransparentKey<Q, K, Hasher, KeyEqual>
+    V* get(const Q& key) noexcept {
+        return find_value(key, fingerprint_of(key));
+    }
+
+    bool has(ConstLRefOrValType<K> key) noexcept {
+        return get(key) != nullptr;
+    }
+
+    template<typename Q> requires TransparentKey<Q, K, Hasher, KeyEqual>
+    bool has(const Q& key) noexcept {
+        return get(key) != nullptr;
+    }
+
+    bool remove(ConstLRefOrValType<K> key) noexcept {
+        return remove_inner<K>(key);
+    }
+
+    template<typename Q> requires TransparentKey<Q, K, Hasher, KeyEqual>
+    bool remove(const Q& key) noexcept {
+        return remove_inner(key);
+    }
+
+    void reserve(u32 new_count) noexcept {
+        SF_ASSERT_MSG(_allocator, "Allocator should be set");
+        u32 new_bucket_count = bucket_count_for(new_count);
+        if (new_bucket_count > _bucket_count) {
+            resize(new_bucket_count);
+        }
+    }
+
+    bool is_empty() const noexcept { return _count == 0; }
+
+    constexpr u32 count() const noexcept { return _count; }
+    constexpr u32 capacity() const noexcept { return _bucket_count * SLOTS_PER_BUCKET; }
+    constexpr u32 stash_count() const noexcept { return _stash_count; }
+
+    Iterator begin() noexcept {
+        if (_bucket_count == 0) {
+            return Iterator{nullptr, nullptr, 0, 0, 0};
+        }
+        return Iterator{buckets(), stash(), 0, capacity(), _stash_count};
+    }
+
+    Iterator end() noexcept {
+        if (_bucket_count == 0) {
+            return Iterator{nullptr, nullptr, 0, 0, 0};
+        }
+        return Iterator{buckets(), stash(), capacity() + _stash_count, capacity(), _stash_count};
+    }
+private:
+    u8* access_data() const noexcept {
+        if constexpr (USE_HANDLE) {
+            return static_cast<u8*>(_allocator->handle_to_ptr(_data.handle));
+        } else {
+            return _data.ptr;
+        }
+    }
+
+    Bucket* buckets() const noexcept { return reinterpret_cast<Bucket*>(access_data()); }
+    StashEntry* stash() const noexcept { return reinterpret_cast<StashEntry*>(access_data() + stash_offset(_bucket_count)); }
+
+    static constexpr usize stash_offset(u32 bucket_count) noexcept {
+        usize offset = static_cast<usize>(bucket_count) * sizeof(Bucket);
+        return (offset + alignof(StashEntry) - 1) & ~(alignof(StashEntry) - 1);
+    }
+
+    // aligned_alloc wants a multiple of the alignment
+    static constexpr usize block_size(u32 bucket_count) noexcept {
+        usize size = stash_offset(bucket_count) + STASH_SIZE * sizeof(StashEntry);
+        return (size + BLOCK_ALIGNMENT - 1) & ~static_cast<usize>(BLOCK_ALIGNMENT - 1);
+    }
+
+    u32 max_load(u32 bucket_count) const noexcept {
+        return static_cast<u32>(bucket_count * SLOTS_PER_BUCKET * _config.load_factor);
+    }
+
+    u32 bucket_count_for(u32 count) const noexcept {
+        u32 bucket_count = std::max(next_power_of_2((count + SLOTS_PER_BUCKET - 1) / SLOTS_PER_BUCKET), 2u);
+        while (max_load(bucket_count) < count) {
+            bucket_count *= 2;
+        }
+        return bucket_count;
+    }
+
+    // folds the 64-bit hash, 0 is reserved for empty slots
+    template<typename Q>
+    u32 fingerprint_of(const Q& key) const noexcept {
+        u64 hash = _hasher(key);
+        return std::max(static_cast<u32>(hash ^ (hash >> 32)), 1u);
+    }
+
+    u32 primary_bucket(u32 fingerprint) const noexcept {
+        return fingerprint & (_bucket_count - 1);
+    }
+
+    // xor with an odd fingerprint mix, so the two buckets differ and map onto each other
+    u32 alternate_bucket(u32 index, u32 fingerprint) const noexcept {
+        u32 mix = static_cast<u32>((fingerprint * 0x9E3779B97F4A7C15ull) >> 32) | 1u;
+        return (index ^ mix) & (_bucket_count - 1);
+    }
+
+    void reset_empty() noexcept {
+        if constexpr (USE_HANDLE) {
+            _data.handle = INVALID_ALLOC_HANDLE;
+        } else {
+            _data.ptr = nullptr;
+        }
+        _bucket_count = 0;
+        _count = 0;
+        _stash_count = 0;
+    }
+
+    void allocate_buckets(u32 bucket_count) noexcept {
+        _bucket_count = bucket_count;
+        if constexpr (USE_HANDLE) {
+            _data.handle = _allocator->allocate_handle(block_size(_bucket_count), BLOCK_ALIGNMENT);
+        } else {
+            _data.ptr = static_cast<u8*>(_allocator->allocate(block_size(_bucket_count), BLOCK_ALIGNMENT));
+        }
+
+        Bucket* b = buckets();
+        for (u32 i{0}; i < _bucket_count; ++i) {
+            sf_mem_zero(b[i].fingerprints, sizeof(b[i].fingerprints));
+        }
+    }
+
+    template<typename Q>
+    bool remove_inner(const Q& key) noexcept {
+        if (_bucket_count == 0) {
+            return false;
+        }
+
+        u32 fingerprint = fingerprint_of(key);
+        u32 first = primary_bucket(fingerprint);
+        for (u32 index : { first, alternate_bucket(first, fingerprint) }) {
+            Bucket& bucket = buckets()[index];
+            for (u32 slot{0}; slot < SLOTS_PER_BUCKET; ++slot) {
+                if (bucket.fingerprints[slot] == fingerprint && _equal(key, bucket.keys[slot])) {
+                    destroy_slot(bucket, slot);
+                    bucket.fingerprints[slot] = EMPTY_FINGERPRINT;
+                    --_count;
+                    return true;
+                }
+            }
+        }
+
+        StashEntry* s = stash();
+        for (u32 i{0}; i < _stash_count; ++i) {
+            if (s[i].fingerprint == fingerprint && _equal(key, s[i].key)) {
+                // last entry fills the hole
+                if (i != _stash_count - 1) {
+                    s[i] = std::move(s[_stash_count - 1]);
+                }
+                s[_stash_count - 1].~StashEntry();
+                --_stash_count;
+                --_count;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void destroy_slot(Bucket& bucket, u32 slot) noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K>) {
+            bucket.keys[slot].~K();
+        }
+        if constexpr (!std::is_trivially_destructible_v<V>) {
+            bucket.values[slot].~V();
+        }
+    }
+
+    void destroy_entries() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K> || !std::is_trivially_destructible_v<V>) {
+            Bucket* b = buckets();
+            for (u32 i{0}; i < _bucket_count; ++i) {
+                for (u32 slot{0}; slot < SLOTS_PER_BUCKET; ++slot) {
+                    if (b[i].fingerprints[slot] != EMPTY_FINGERPRINT) {
+                        destroy_slot(b[i], slot);
+                    }
+                }
+            }
+            StashEntry* s = stash();
+            for (u32 i{0}; i < _stash_count; ++i) {
+                s[i].~StashEntry();
+            }
+        }
+    }
+
+    template<typename Q>
+    V* find_value(const Q& key, u32 fingerprint) noexcept {
+        if (_bucket_count == 0) {
+            return nullptr;
+        }
+
+        u32 first = primary_bucket(fingerprint);
+        Bucket* b = buckets();
+        V* value = find_in_bucket(b[first], key, fingerprint);
+        if (value) {
+            return value;
+        }
+
+        value = find_in_bucket(b[alternate_bucket(first, fingerprint)], key, fingerprint);
+        if (value || _stash_count == 0) {
+            return value;
+        }
+
+        StashEntry* s = stash();
+        for (u32 i{0}; i < _stash_count; ++i) {
+            if (s[i].fingerprint == fingerprint && _equal(key, s[i].key)) {
+                return &s[i].value;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // all fingerprints are compared at once, keys only on a match
+    template<typename Q>
+    V* find_in_bucket(Bucket& bucket, const Q& key, u32 fingerprint) noexcept {
+        u32 matches{0};
+        for (u32 slot{0}; slot < SLOTS_PER_BUCKET; ++slot) {
+            matches |= static_cast<u32>(bucket.fingerprints[slot] == fingerprint) << slot;
+        }
+
+        for (; matches != 0; matches &= matches - 1) {
+            u32 slot = static_cast<u32>(std::countr_zero(matches));
+            if (_equal(key, bucket.keys[slot])) {
+                return bucket.values + slot;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // key is known to be missing
+    void insert_new(K&& key, V&& val, u32 fingerprint) noexcept {
+        if (_bucket_count == 0 || _count >= max_load(_bucket_count)) {
+            resize(_bucket_count == 0 ? bucket_count_for(DEFAULT_INIT_CAPACITY) : static_cast<u32>(_bucket_count * _config.grow_factor));
+        }
+
+        // on failure the entry left over from the kick chain comes back in the arguments
+        for (u32 grow_count{0}; !place(key, val, fingerprint); ++grow_count) {
+            if (_stash_count < STASH_SIZE) {
+                ::new (stash() + _stash_count) StashEntry{ .key = std::move(key), .value = std::move(val), .fingerprint = fingerprint };
+                ++_stash_count;
+                break;
+            }
+            // more than 2 buckets and the stash worth of keys on one fingerprint, no size fits them
+            if (grow_count == MAX_GROWS_PER_INSERT) {
+                panic("CuckooHashMap: too many keys with the same hash");
+            }
+            resize(static_cast<u32>(_bucket_count * _config.grow_factor));
+        }
+        ++_count;
+    }
+
+    bool place_in_bucket(u32 index, K& key, V& val, u32 fingerprint) noexcept {
+        Bucket& bucket = buckets()[index];
+        for (u32 slot{0}; slot < SLOTS_PER_BUCKET; ++slot) {
+            if (bucket.fingerprints[slot] == EMPTY_FINGERPRINT) {
+                ::new (bucket.keys + slot) K(std::move(key));
+                ::new (bucket.values + slot) V(std::move(val));
+                bucket.fingerprints[slot] = fingerprint;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // places into either bucket, otherwise evicts a victim to its other bucket, up to MAX_KICKS times
+    bool place(K& key, V& val, u32& fingerprint) noexcept {
+        u32 index = primary_bucket(fingerprint);
+        if (place_in_bucket(index, key, val, fingerprint)) {
+            return true;
+        }
+        index = alternate_bucket(index, fingerprint);
+        if (place_in_bucket(index, key, val, fingerprint)) {
+            return true;
+        }
+
+        for (u32 kick{0}; kick < MAX_KICKS; ++kick) {
+            Bucket& bucket = buckets()[index];
+            // victim picked from the fingerprint, so chains do not cycle over one slot
+            u32 slot = (fingerprint + kick) % SLOTS_PER_BUCKET;
+            std::swap(key, bucket.keys[slot]);
+            std::swap(val, bucket.values[slot]);
+            std::swap(fingerprint, bucket.fingerprints[slot]);
+
+            index = alternate_bucket(index, fingerprint);
+            if (place_in_bucket(index, key, val, fingerprint)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // fingerprints give both buckets, so entries move without rehashing keys
+    void resize(u32 new_bucket_count) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+
+        u32 old_bucket_count = _bucket_count;
+        Data old_data = _data;
+        [[maybe_unused]] u32 old_count = _count;
+        u32 old_stash_count = _stash_count;
+
+        allocate_buckets(new_bucket_count);
+        _count = 0;
+        _stash_count = 0;
+
+        if (old_bucket_count > 0) {
+            // a full stash mid rehash resizes again, which may move a handle allocator's
+            // buffer, so the old block is resolved anew for every entry and entries are
+            // moved out of it before they are inserted
+            auto old_block = [this, old_data]() noexcept -> u8* {
+                if constexpr (USE_HANDLE) {
+                    return static_cast<u8*>(_allocator->handle_to_ptr(old_data.handle));
+                } else {
+                    return old_data.ptr;
+                }
+            };
+
+            for (u32 i{0}; i < old_bucket_count; ++i) {
+                for (u32 slot{0}; slot < SLOTS_PER_BUCKET; ++slot) {
+                    Bucket& old_bucket = reinterpret_cast<Bucket*>(old_block())[i];
+                    if (old_bucket.fingerprints[slot] != EMPTY_FINGERPRINT) {
+                        u32 fingerprint = old_bucket.fingerprints[slot];
+                        K key{std::move(old_bucket.keys[slot])};
+                        V value{std::move(old_bucket.values[slot])};
+                        destroy_slot(old_bucket, slot);
+                        insert_new(std::move(key), std::move(value), fingerprint);
+                    }
+                }
+            }
+            for (u32 i{0}; i < old_stash_count; ++i) {
+                StashEntry& old_entry = reinterpret_cast<StashEntry*>(old_block() + stash_offset(old_bucket_count))[i];
+                StashEntry entry{std::move(old_entry)};
+                old_entry.~StashEntry();
+                insert_new(std::move(entry.key), std::move(entry.value), entry.fingerprint);
+            }
+
+            if constexpr (USE_HANDLE) {
+                _allocator->free_handle(old_data.handle, BLOCK_ALIGNMENT);
+            } else {
+                _allocator->free(old_data.ptr, BLOCK_ALIGNMENT);
+            }
+        }
+
+        SF_ASSERT_MSG(_count == old_count, "Resize should keep every entry");
+    }
+};
+
+} // sf
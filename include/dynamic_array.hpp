@@ -9,6 +9,7 @@
 #include "asserts_sf.hpp"
 #include "constants.hpp"
 #include "memory_sf.hpp"
+#include "hash.hpp"
 #include <algorithm>
 #include <initializer_list>
 #include <span>
@@ -80,6 +81,10 @@ public:
             } else {
                 _data.ptr = static_cast<T*>(allocator->allocate(capacity_input * sizeof(T), alignof(T)));
             }
+        } else if constexpr (USE_HANDLE) {
+            _data.handle = INVALID_ALLOC_HANDLE;
+        } else {
+            _data.ptr = nullptr;
         }
     }
 
@@ -98,6 +103,10 @@ public:
                 _data.ptr = static_cast<T*>(allocator->allocate(capacity_input * sizeof(T), alignof(T)));
             }
             move_forward(count);
+        } else if constexpr (USE_HANDLE) {
+            _data.handle = INVALID_ALLOC_HANDLE;
+        } else {
+            _data.ptr = nullptr;
         }
     }
 
@@ -265,6 +274,8 @@ public:
                 _data.ptr = nullptr;
             }
         }
+        _count = 0;
+        _capacity = 0;
     }
 
     void set_allocator(Allocator* allocator) noexcept
@@ -486,17 +497,7 @@ public:
     }
 
     static u64 hash(const DynamicArray<T, Allocator>& key) noexcept {
-        constexpr u64 PRIME = 1099511628211u;
-        constexpr u64 OFFSET_BASIS = 14695981039346656037u;
-
-        u64 hash = OFFSET_BASIS;
-
-        for (u32 i{0}; i < key.count() * sizeof(T); ++i) {
-            hash ^= reinterpret_cast<u8*>(key.data())[i];
-            hash *= PRIME;
-        }
-
-        return hash;
+        return hash_bytes(key.data(), key.count() * sizeof(T));
     }
 
     void shrink(u32 new_capacity) noexcept {
@@ -557,13 +558,13 @@ protected:
         if constexpr (USE_HANDLE) {
             ReallocReturnHandle realloc_res = _allocator->reallocate_handle(_data.handle, _capacity * sizeof(T), alignof(T));
             if (realloc_res.should_mem_copy && old_capacity > 0) {
-                sf_mem_copy((void*)(_allocator->handle_to_ptr(realloc_res.handle)), (void*)(_allocator->handle_to_ptr(_data.handle)), old_capacity);
+                sf_mem_copy((void*)(_allocator->handle_to_ptr(realloc_res.handle)), (void*)(_allocator->handle_to_ptr(_data.handle)), old_capacity * sizeof(T));
             }
             _data.handle = realloc_res.handle;
         } else {
             ReallocReturn realloc_res = _allocator->reallocate(_data.ptr, _capacity * sizeof(T), alignof(T));
             if (realloc_res.should_mem_copy && old_capacity > 0) {
-                sf_mem_copy((void*)realloc_res.ptr, (void*)_data.ptr, old_capacity);
+                sf_mem_copy((void*)realloc_res.ptr, (void*)_data.ptr, old_capacity * sizeof(T));
             }
             _data.ptr = static_cast<T*>(realloc_res.ptr);
         }         
@@ -0,0 +1,456 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "general_purpose_allocator.hpp"
+#include "hashmap.hpp"
+#include "traits.hpp"
+#include "constants.hpp"
+#include "defines.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <initializer_list>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace sf {
+
+// Minimal perfect hash in the "hash and displace" style (CHD / PTHash):
+// keys are grouped into ~N/KEYS_PER_BUCKET buckets by their hash, and every bucket
+// gets a pilot chosen at build time so that mixing each key's hash with it sends
+// every key of the table to its own slot in [0, N). A lookup is one key hash,
+// one multiply to apply the pilot and one key compare.
+namespace frozen {
+
+inline constexpr u32 KEYS_PER_BUCKET = 4;
+inline constexpr u32 MAX_PILOT = 1 << 16;
+inline constexpr u32 MAX_SEED_ATTEMPTS = 64;
+
+constexpr u32 bucket_count_for(u32 key_count) noexcept {
+    return key_count / KEYS_PER_BUCKET + 1;
+}
+
+// multiply-shift range reduction, cheaper than '%'
+constexpr u32 reduce(u64 hash, u32 range) noexcept {
+    return static_cast<u32>(((hash >> 32) * range) >> 32);
+}
+
+constexpr u32 bucket_of(u64 hash, u32 bucket_count) noexcept {
+    return reduce(hash << 32, bucket_count);
+}
+
+constexpr u32 slot_of(u64 hash, u32 pilot, u32 key_count) noexcept {
+    return reduce(hash_u64(hash, pilot), key_count);
+}
+
+// scratch memory for 'build', provided by the caller so it works at compile time too
+struct BuildScratch {
+    u32* bucket_start;  // bucket_count + 1
+    u32* bucket_keys;   // key_count, key indices grouped by bucket
+    u32* bucket_order;  // bucket_count, largest buckets first
+    u8*  taken;         // key_count
+};
+
+// fills 'pilots' and 'slots' (slot of every key), returns false when some bucket
+// finds no pilot, the caller then retries with another seed
+constexpr bool build(const u64* hashes, u32 key_count, u32 bucket_count, u32* pilots, u32* slots, BuildScratch scratch) noexcept {
+    for (u32 b{0}; b <= bucket_count; ++b) {
+        scratch.bucket_start[b] = 0;
+    }
+    for (u32 i{0}; i < key_count; ++i) {
+        ++scratch.bucket_start[bucket_of(hashes[i], bucket_count) + 1];
+        scratch.taken[i] = 0;
+    }
+
+    u32 max_bucket_size{0};
+    for (u32 b{0}; b < bucket_count; ++b) {
+        max_bucket_size = std::max(max_bucket_size, scratch.bucket_start[b + 1]);
+        scratch.bucket_start[b + 1] += scratch.bucket_start[b];
+    }
+
+    // counting sort of keys by bucket, 'pilots' doubles as the fill cursor
+    for (u32 b{0}; b < bucket_count; ++b) {
+        pilots[b] = scratch.bucket_start[b];
+    }
+    for (u32 i{0}; i < key_count; ++i) {
+        u32 b = bucket_of(hashes[i], bucket_count);
+        scratch.bucket_keys[pilots[b]++] = i;
+    }
+
+    // big buckets first, while most slots are still free
+    u32 order_count{0};
+    for (u32 size{max_bucket_size}; size > 0; --size) {
+        for (u32 b{0}; b < bucket_count; ++b) {
+            if (scratch.bucket_start[b + 1] - scratch.bucket_start[b] == size) {
+                scratch.bucket_order[order_count++] = b;
+            }
+        }
+    }
+    for (u32 b{0}; b < bucket_count; ++b) {
+        pilots[b] = 0;
+    }
+
+    for (u32 o{0}; o < order_count; ++o) {
+        u32 b = scratch.bucket_order[o];
+        u32 begin = scratch.bucket_start[b];
+        u32 end = scratch.bucket_start[b + 1];
+
+        bool placed{false};
+        for (u32 pilot{0}; pilot < MAX_PILOT && !placed; ++pilot) {
+            u32 k = begin;
+            for (; k < end; ++k) {
+                u32 key = scratch.bucket_keys[k];
+                u32 slot = slot_of(hashes[key], pilot, key_count);
+                if (scratch.taken[slot]) {
+                    break;
+                }
+                scratch.taken[slot] = 1;
+                slots[key] = slot;
+            }
+
+            if (k == end) {
+                pilots[b] = pilot;
+                placed = true;
+            } else {
+                // give back the slots this pilot took from the bucket
+                for (u32 r{begin}; r < k; ++r) {
+                    scratch.taken[slots[scratch.bucket_keys[r]]] = 0;
+                }
+            }
+        }
+
+        if (!placed) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // frozen
+
+// Read-only map built once from a fixed key set, lookups never probe.
+// Keys must be unique. Hashing goes through 'hashfn_seeded', starting at the seed
+// 'hashfn_default' uses and moving to the next one only if the build fails.
+template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct FrozenHashMap {
+public:
+    using KeyType = K;
+    using ValueType = V;
+
+    struct Entry {
+        K key;
+        V value;
+    };
+
+    union Data {
+        u8* ptr;
+        u32 handle;
+    };
+private:
+    // entries in slot order followed by the bucket pilots, in one allocation
+    Allocator*          _allocator;
+    Data                _data;
+    u32                 _count;
+    u32                 _bucket_count;
+    u64                 _seed;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    static constexpr bool USE_HANDLE = Allocator::using_handle();
+    static constexpr u16 BLOCK_ALIGNMENT = static_cast<u16>(std::max(alignof(Entry), alignof(u32)));
+
+    FrozenHashMap(std::span<const K> keys, std::span<const V> values, KeyEqual equal = {})
+        : FrozenHashMap(keys, values, get_current_gpa(), equal)
+    {}
+
+    FrozenHashMap(std::span<const K> keys, std::span<const V> values, Allocator* allocator, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _count{static_cast<u32>(keys.size())}
+        , _bucket_count{frozen::bucket_count_for(static_cast<u32>(keys.size()))}
+        , _seed{DEFAULT_HASH_SEED}
+        , _equal{equal}
+    {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        SF_ASSERT_MSG(values.size() >= keys.size(), "Should have a value for every key");
+        build(keys.data(), values.data());
+    }
+
+    FrozenHashMap(std::initializer_list<Entry> entries, Allocator* allocator, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _count{static_cast<u32>(entries.size())}
+        , _bucket_count{frozen::bucket_count_for(static_cast<u32>(entries.size()))}
+        , _seed{DEFAULT_HASH_SEED}
+        , _equal{equal}
+    {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        build(entries.begin());
+    }
+
+    FrozenHashMap(std::initializer_list<Entry> entries, KeyEqual equal = {})
+        : FrozenHashMap(entries, get_current_gpa(), equal)
+    {}
+
+    FrozenHashMap(FrozenHashMap&& rhs) noexcept
+        : _allocator{rhs._allocator}
+        , _data{rhs._data}
+        , _count{rhs._count}
+        , _bucket_count{rhs._bucket_count}
+        , _seed{rhs._seed}
+        , _equal{rhs._equal}
+    {
+        rhs.reset_empty();
+    }
+
+    FrozenHashMap& operator=(FrozenHashMap&& rhs) noexcept
+    {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        free();
+
+        _allocator = rhs._allocator;
+        _data = rhs._data;
+        _count = rhs._count;
+        _bucket_count = rhs._bucket_count;
+        _seed = rhs._seed;
+        _equal = rhs._equal;
+
+        rhs.reset_empty();
+        return *this;
+    }
+
+    FrozenHashMap(const FrozenHashMap& rhs) = delete;
+    FrozenHashMap& operator=(const FrozenHashMap& rhs) = delete;
+
+    ~FrozenHashMap() noexcept {
+        free();
+    }
+
+    void free() noexcept {
+        if (!_allocator || _count == 0) {
+            return;
+        }
+
+        if constexpr (!std::is_trivially_destructible_v<Entry>) {
+            Entry* e = entries();
+            for (u32 i{0}; i < _count; ++i) {
+                e[i].~Entry();
+            }
+        }
+        if constexpr (USE_HANDLE) {
+            _allocator->free_handle(_data.handle, BLOCK_ALIGNMENT);
+        } else {
+            _allocator->free(_data.ptr, BLOCK_ALIGNMENT);
+        }
+        reset_empty();
+    }
+
+    const V* get(ConstLRefOrValType<K> key) const noexcept {
+        if (_count == 0) {
+            return nullptr;
+        }
+
+        u64 hash = hashfn_seeded<K>(key, _seed);
+        u32 pilot = pilots()[frozen::bucket_of(hash, _bucket_count)];
+        const Entry& entry = entries()[frozen::slot_of(hash, pilot, _count)];
+
+        return _equal(key, entry.key) ? &entry.value : nullptr;
+    }
+
+    bool has(ConstLRefOrValType<K> key) const noexcept {
+        return get(key) != nullptr;
+    }
+
+    constexpr u32 count() const noexcept { return _count; }
+    constexpr u64 seed() const noexcept { return _seed; }
+    constexpr u32 size_in_bytes() const noexcept { return block_size(_count, _bucket_count); }
+
+    // entries in slot order, the order of the source is not kept
+    const Entry* begin() const noexcept {
+        return _count == 0 ? nullptr : entries();
+    }
+
+    const Entry* end() const noexcept {
+        return _count == 0 ? nullptr : entries() + _count;
+    }
+private:
+    u8* access_data() const noexcept {
+        if constexpr (USE_HANDLE) {
+            return static_cast<u8*>(_allocator->handle_to_ptr(_data.handle));
+        } else {
+            return _data.ptr;
+        }
+    }
+
+    Entry* entries() const noexcept { return reinterpret_cast<Entry*>(access_data()); }
+    u32* pilots() const noexcept { return reinterpret_cast<u32*>(access_data() + pilots_offset(_count)); }
+
+    static constexpr usize pilots_offset(u32 count) noexcept {
+        return (static_cast<usize>(count) * sizeof(Entry) + alignof(u32) - 1) & ~(alignof(u32) - 1);
+    }
+
+    static constexpr usize block_size(u32 count, u32 bucket_count) noexcept {
+        return pilots_offset(count) + static_cast<usize>(bucket_count) * sizeof(u32);
+    }
+
+    void reset_empty() noexcept {
+        if constexpr (USE_HANDLE) {
+            _data.handle = INVALID_ALLOC_HANDLE;
+        } else {
+            _data.ptr = nullptr;
+        }
+        _count = 0;
+        _bucket_count = 0;
+    }
+
+    void build(const K* keys, const V* values) noexcept {
+        u32* slots = build_slots([keys](u32 i) -> const K& { return keys[i]; });
+        if (!slots) {
+            return;
+        }
+
+        Entry* e = entries();
+        for (u32 i{0}; i < _count; ++i) {
+            ::new (e + slots[i]) Entry{ .key = keys[i], .value = values[i] };
+        }
+        _allocator->free(slots, alignof(u32));
+    }
+
+    void build(const Entry* source) noexcept {
+        u32* slots = build_slots([source](u32 i) -> const K& { return source[i].key; });
+        if (!slots) {
+            return;
+        }
+
+        Entry* e = entries();
+        for (u32 i{0}; i < _count; ++i) {
+            ::new (e + slots[i]) Entry{ source[i] };
+        }
+        _allocator->free(slots, alignof(u32));
+    }
+
+    // allocates the table and finds the pilots, returns the slot of every key
+    // (to be freed by the caller) or nullptr for an empty key set
+    template<typename KeyAt>
+    u32* build_slots(KeyAt&& key_at) noexcept {
+        if (_count == 0) {
+            reset_empty();
+            return nullptr;
+        }
+
+        if constexpr (USE_HANDLE) {
+            _data.handle = _allocator->allocate_handle(block_size(_count, _bucket_count), BLOCK_ALIGNMENT);
+        } else {
+            _data.ptr = static_cast<u8*>(_allocator->allocate(block_size(_count, _bucket_count), BLOCK_ALIGNMENT));
+        }
+
+        // scratch: hashes | slots | bucket_start | bucket_keys | bucket_order | taken
+        usize scratch_size = _count * sizeof(u64) + (_count * 2 + _bucket_count * 2 + 1) * sizeof(u32) + _count;
+        u8* scratch = static_cast<u8*>(_allocator->allocate(scratch_size, alignof(u64)));
+        u64* hashes = reinterpret_cast<u64*>(scratch);
+        u32* slots = reinterpret_cast<u32*>(hashes + _count);
+        frozen::BuildScratch build_scratch{
+            .bucket_start = slots + _count,
+            .bucket_keys  = slots + _count + _bucket_count + 1,
+            .bucket_order = slots + _count * 2 + _bucket_count + 1,
+            .taken        = reinterpret_cast<u8*>(slots + _count * 2 + _bucket_count * 2 + 1),
+        };
+
+        bool built{false};
+        for (u32 attempt{0}; attempt < frozen::MAX_SEED_ATTEMPTS && !built; ++attempt) {
+            _seed = DEFAULT_HASH_SEED + attempt;
+            for (u32 i{0}; i < _count; ++i) {
+                hashes[i] = hashfn_seeded<K>(key_at(i), _seed);
+            }
+            // handle allocators may have moved the table while scratch was allocated
+            built = frozen::build(hashes, _count, _bucket_count, pilots(), slots, build_scratch);
+        }
+        SF_ASSERT_MSG(built, "Keys should be unique");
+        if (!built) {
+            panic("FrozenHashMap: no perfect hash found, keys are probably duplicated");
+        }
+
+        // slots are moved to the front so the caller can free them as one block
+        sf_mem_move(scratch, slots, _count * sizeof(u32));
+        return reinterpret_cast<u32*>(scratch);
+    }
+};
+
+// FrozenHashMap with inline storage, constructible in constant expressions:
+//     constexpr FixedFrozenHashMap<std::string_view, u32, 2> OPCODES{{ {"add", 1}, {"sub", 2} }};
+//     static_assert(*OPCODES.get("sub") == 2);
+// K and V have to be default constructible literal types.
+template<typename K, typename V, u32 N, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct FixedFrozenHashMap {
+public:
+    using KeyType = K;
+    using ValueType = V;
+    static_assert(N > 0, "Should have at least one key");
+
+    struct Entry {
+        K key;
+        V value;
+    };
+
+    static constexpr u32 BUCKET_COUNT = frozen::bucket_count_for(N);
+private:
+    Entry _entries[N];
+    u32   _pilots[BUCKET_COUNT];
+    u64   _seed;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    constexpr FixedFrozenHashMap(const Entry (&entries)[N], KeyEqual equal = {}) noexcept
+        : _entries{}
+        , _pilots{}
+        , _seed{DEFAULT_HASH_SEED}
+        , _equal{equal}
+    {
+        u64 hashes[N]{};
+        u32 slots[N]{};
+        u32 bucket_start[BUCKET_COUNT + 1]{};
+        u32 bucket_keys[N]{};
+        u32 bucket_order[BUCKET_COUNT]{};
+        u8  taken[N]{};
+        frozen::BuildScratch scratch{
+            .bucket_start = bucket_start,
+            .bucket_keys  = bucket_keys,
+            .bucket_order = bucket_order,
+            .taken        = taken,
+        };
+
+        bool built{false};
+        for (u32 attempt{0}; attempt < frozen::MAX_SEED_ATTEMPTS && !built; ++attempt) {
+            _seed = DEFAULT_HASH_SEED + attempt;
+            for (u32 i{0}; i < N; ++i) {
+                hashes[i] = hashfn_seeded<K>(entries[i].key, _seed);
+            }
+            built = frozen::build(hashes, N, BUCKET_COUNT, _pilots, slots, scratch);
+        }
+        if (!built) {
+            // not a constant expression: duplicated keys fail the build at compile time
+            panic("FixedFrozenHashMap: no perfect hash found, keys are probably duplicated");
+        }
+
+        for (u32 i{0}; i < N; ++i) {
+            _entries[slots[i]] = entries[i];
+        }
+    }
+
+    constexpr const V* get(ConstLRefOrValType<K> key) const noexcept {
+        u64 hash = hashfn_seeded<K>(key, _seed);
+        const Entry& entry = _entries[frozen::slot_of(hash, _pilots[frozen::bucket_of(hash, BUCKET_COUNT)], N)];
+        return _equal(key, entry.key) ? &entry.value : nullptr;
+    }
+
+    constexpr bool has(ConstLRefOrValType<K> key) const noexcept {
+        return get(key) != nullptr;
+    }
+
+    constexpr u32 count() const noexcept { return N; }
+
+    constexpr const Entry* begin() const noexcept { return _entries; }
+    constexpr const Entry* end() const noexcept { return _entries + N; }
+};
+
+} // sf
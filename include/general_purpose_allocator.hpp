@@ -20,4 +20,9 @@ struct GeneralPurposeAllocator {
 
 GeneralPurposeAllocator* get_current_gpa();
 
+// Gives the calling thread's small block cache back to the shared slab. Runs on its own at
+// thread exit, call it earlier for threads that stop allocating but keep running: the
+// thread's later allocations go to the shared slab lists, it does not adopt another cache.
+void gpa_flush_thread_cache() noexcept;
+
 } // sf
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "defines.hpp"
+#include <cstring>
+#include <type_traits>
+
+#if defined(_MSC_VER) && defined(_M_X64) && !defined(__clang__)
+#include <intrin.h>
+#pragma intrinsic(_umul128)
+#endif
+
+namespace sf {
+
+// fnv1a hash function
+static constexpr u64 PRIME = 1099511628211ull;
+static constexpr u64 OFFSET_BASIS = 14695981039346656037ull;
+
+inline u64 hash_fnv1a(const void* data, usize len) noexcept {
+    const u8* bytes = static_cast<const u8*>(data);
+    u64 hash = OFFSET_BASIS;
+
+    for (usize i{0}; i < len; ++i) {
+        hash ^= bytes[i];
+        hash *= PRIME;
+    }
+
+    return hash;
+}
+
+// wyhash (final version 4), public domain: https://github.com/wangyi-fudan/wyhash
+// a 64x64->128 multiply folded back to 64 bits mixes every input bit into both
+// halves of the result, strings are consumed 16/48 bytes per step
+inline constexpr u64 DEFAULT_HASH_SEED = 0;
+inline constexpr u64 HASH_SECRET[4] = {
+    0x2d358dccaa6c78a5ull,
+    0x8bb84b93962eacc9ull,
+    0x4b33a62ed433d4a3ull,
+    0x4d5a2da51de1aa47ull,
+};
+
+constexpr void hash_mum_portable(u64* a, u64* b) noexcept {
+    u64 ha = *a >> 32, hb = *b >> 32, la = static_cast<u32>(*a), lb = static_cast<u32>(*b);
+    u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+    u64 c = t < rl;
+    u64 lo = t + (rm1 << 32);
+    c += lo < t;
+    u64 hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    *a = lo;
+    *b = hi;
+}
+
+constexpr void hash_mum(u64* a, u64* b) noexcept {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = *a;
+    r *= *b;
+    *a = static_cast<u64>(r);
+    *b = static_cast<u64>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    if (std::is_constant_evaluated()) {
+        hash_mum_portable(a, b);
+    } else {
+        *a = _umul128(*a, *b, b);
+    }
+#else
+    hash_mum_portable(a, b);
+#endif
+}
+
+constexpr u64 hash_mix(u64 a, u64 b) noexcept {
+    hash_mum(&a, &b);
+    return a ^ b;
+}
+
+namespace detail {
+
+// little-endian loads, byte by byte while constant evaluated
+template<typename Byte>
+constexpr u64 read_bytes(const Byte* p, u32 count) noexcept {
+    u64 v{0};
+    for (u32 i{0}; i < count; ++i) {
+        v |= static_cast<u64>(static_cast<u8>(p[i])) << (i * 8);
+    }
+    return v;
+}
+
+template<typename Byte>
+constexpr u64 read_u64(const Byte* p) noexcept {
+    if (std::is_constant_evaluated()) {
+        return read_bytes(p, sizeof(u64));
+    }
+    u64 v;
+    std::memcpy(&v, p, sizeof(u64));
+    return v;
+}
+
+template<typename Byte>
+constexpr u64 read_u32(const Byte* p) noexcept {
+    if (std::is_constant_evaluated()) {
+        return read_bytes(p, sizeof(u32));
+    }
+    u32 v;
+    std::memcpy(&v, p, sizeof(u32));
+    return v;
+}
+
+// 1..3 bytes
+template<typename Byte>
+constexpr u64 read_small(const Byte* p, usize len) noexcept {
+    return (static_cast<u64>(static_cast<u8>(p[0])) << 16) | (static_cast<u64>(static_cast<u8>(p[len >> 1])) << 8) | static_cast<u8>(p[len - 1]);
+}
+
+} // detail
+
+// fixed-size keys up to 8 bytes: one multiply
+constexpr u64 hash_u64(u64 key, u64 seed = DEFAULT_HASH_SEED) noexcept {
+    return hash_mix(key ^ HASH_SECRET[0] ^ seed, HASH_SECRET[1]);
+}
+
+// byte pointers (char, u8) hash in constant expressions too
+template<typename Byte> requires (sizeof(Byte) == 1)
+constexpr u64 hash_bytes(const Byte* p, usize len, u64 seed = DEFAULT_HASH_SEED) noexcept {
+    seed ^= hash_mix(seed ^ HASH_SECRET[0], HASH_SECRET[1]);
+    u64 a;
+    u64 b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (detail::read_u32(p) << 32) | detail::read_u32(p + ((len >> 3) << 2));
+            b = (detail::read_u32(p + len - 4) << 32) | detail::read_u32(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = detail::read_small(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        usize i = len;
+        if (i >= 48) {
+            u64 see1 = seed;
+            u64 see2 = seed;
+            do {
+                seed = hash_mix(detail::read_u64(p) ^ HASH_SECRET[1], detail::read_u64(p + 8) ^ seed);
+                see1 = hash_mix(detail::read_u64(p + 16) ^ HASH_SECRET[2], detail::read_u64(p + 24) ^ see1);
+                see2 = hash_mix(detail::read_u64(p + 32) ^ HASH_SECRET[3], detail::read_u64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = hash_mix(detail::read_u64(p) ^ HASH_SECRET[1], detail::read_u64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = detail::read_u64(p + i - 16);
+        b = detail::read_u64(p + i - 8);
+    }
+
+    a ^= HASH_SECRET[1];
+    b ^= seed;
+    hash_mum(&a, &b);
+    return hash_mix(a ^ HASH_SECRET[0] ^ len, b ^ HASH_SECRET[1]);
+}
+
+inline u64 hash_bytes(const void* data, usize len, u64 seed = DEFAULT_HASH_SEED) noexcept {
+    return hash_bytes(static_cast<const u8*>(data), len, seed);
+}
+
+} // sf
@@ -4,15 +4,24 @@
 #include "general_purpose_allocator.hpp"
 #include "traits.hpp"
 #include "constants.hpp"
+#include "hash.hpp"
 #include "defines.hpp"
 #include "memory_sf.hpp"
 #include "utility.hpp"
 #include "iterator.hpp"
+#include <bit>
+#include <concepts>
+#include <span>
 #include <cstring>
 #include <string_view>
 #include <type_traits>
 #include <utility>
 
+#ifdef SF_HASHMAP_STATS
+#include <atomic>
+#include <chrono>
+#endif
+
 namespace sf {
 
 template<typename K>
@@ -25,86 +34,237 @@ template<typename K>
 u64 hashfn_default(ConstLRefOrValType<K> key) noexcept;
 
 template<typename K>
-bool equal_fn_default(ConstLRefOrValType<K> first, ConstLRefOrValType<K> second) {
+constexpr bool equal_fn_default(ConstLRefOrValType<K> first, ConstLRefOrValType<K> second) {
     return first == second;
 };
 
-// fnv1a hash function
-static constexpr u64 PRIME = 1099511628211ull;
-static constexpr u64 OFFSET_BASIS = 14695981039346656037ull;
+// keys exposing contiguous trivially copyable storage (FixedString, String, arrays)
+// are hashed by content, so equal keys hash equally whatever lies past count()
+template<typename K>
+concept ContiguousHashable = requires(const K& key) {
+    { key.data() };
+    { key.count() } -> std::convertible_to<usize>;
+} && std::is_trivially_copyable_v<typename K::ValueType>;
+
+// same hash family under another seed; FrozenHashMap retries seeds until its
+// perfect hash builds, hashfn_default is the DEFAULT_HASH_SEED member
+template<typename K>
+constexpr u64 hashfn_seeded(ConstLRefOrValType<K> key, u64 seed) noexcept {
+    if constexpr (std::is_same_v<K, std::string_view>) {
+        return hash_bytes(key.data(), key.size(), seed);
+    } else if constexpr (std::is_same_v<K, const char*>) {
+        // hashes the pointed-to string, same value as for the equal std::string_view
+        return hash_bytes(key, std::char_traits<char>::length(key), seed);
+    } else if constexpr (std::is_integral_v<K> || std::is_enum_v<K>) {
+        return hash_u64(static_cast<u64>(key), seed);
+    } else if constexpr (std::is_pointer_v<K>) {
+        return hash_u64(reinterpret_cast<usize>(key), seed);
+    } else if constexpr (ContiguousHashable<K>) {
+        return hash_bytes(key.data(), key.count() * sizeof(typename K::ValueType), seed);
+    } else if constexpr (sizeof(K) <= sizeof(u64) && std::is_trivially_copyable_v<K>) {
+        u64 word{0};
+        sf_mem_copy((void*)&word, (void*)&key, sizeof(K));
+        return hash_u64(word, seed);
+    } else {
+        return hash_bytes(&key, sizeof(K), seed);
+    }
+}
 
 template<typename K>
 u64 hashfn_default(ConstLRefOrValType<K> key) noexcept {
-    u64 hash = OFFSET_BASIS;
+    return hashfn_seeded<K>(key, DEFAULT_HASH_SEED);
+}
 
-    u8 bytes[sizeof(K)];
-    sf_mem_copy((void*)bytes, (void*)&key, sizeof(K));
+template<typename H, typename K>
+concept HasherTrait = requires(const H hasher, ConstLRefOrValType<K> key) {
+    { hasher(key) } -> std::convertible_to<u64>;
+};
 
-    for (u32 i{0}; i < sizeof(K); ++i) {
-        hash ^= bytes[i];
-        hash *= PRIME;
+template<typename E, typename K>
+concept KeyEqualTrait = requires(const E equal, ConstLRefOrValType<K> first, ConstLRefOrValType<K> second) {
+    { equal(first, second) } -> std::convertible_to<bool>;
+};
+
+// stateless functors, inlined into the probe loops
+template<typename K>
+struct DefaultHasher {
+    u64 operator()(ConstLRefOrValType<K> key) const noexcept {
+        return hashfn_default<K>(key);
     }
+};
 
-    return hash;
-}
+template<typename K>
+struct DefaultEqual {
+    constexpr bool operator()(ConstLRefOrValType<K> first, ConstLRefOrValType<K> second) const noexcept {
+        return equal_fn_default<K>(first, second);
+    }
+};
+
+// keys hashed by their characters only (FixedString, String): a std::string_view
+// with the same characters gets the same hash, so it can probe without building a key
+template<typename K>
+concept StringKey = ContiguousHashable<K> && std::same_as<typename K::ValueType, char>;
 
-template<>
-inline u64 hashfn_default<std::string_view>(ConstLRefOrValType<std::string_view> key) noexcept {
-    u64 hash = OFFSET_BASIS;
+template<StringKey K>
+struct DefaultHasher<K> {
+    using is_transparent = void;
 
-    for (u32 i{0}; i < key.size(); ++i) {
-        hash ^= key[i];
-        hash *= PRIME;
+    u64 operator()(const K& key) const noexcept {
+        return hashfn_default<K>(key);
     }
 
-    return hash;
-}
+    u64 operator()(std::string_view key) const noexcept {
+        return hashfn_default<std::string_view>(key);
+    }
+};
 
-template<>
-inline u64 hashfn_default<const char*>(ConstLRefOrValType<const char*> key) noexcept {
-    u64 hash = OFFSET_BASIS;
+template<StringKey K>
+struct DefaultEqual<K> {
+    using is_transparent = void;
 
-    u32 s_len{ static_cast<u32>(strlen(key)) };
+    bool operator()(const K& first, const K& second) const noexcept {
+        return first == second;
+    }
 
-    for (u32 i{0}; i < s_len; ++i) {
-        hash ^= key[i];
-        hash *= PRIME;
+    bool operator()(std::string_view first, const K& second) const noexcept {
+        return first.size() == second.count() && sf_mem_cmp((void*)first.data(), (void*)second.data(), first.size());
     }
+};
 
-    return hash;
-}
+// lookup by a key-like Q without constructing K, both functors have to opt in
+// with 'is_transparent' and promise to hash Q and an equal K the same way
+template<typename Q, typename K, typename H, typename E>
+concept TransparentKey = !std::same_as<std::remove_cvref_t<Q>, K>
+    && requires { typename H::is_transparent; typename E::is_transparent; }
+    && requires(const H hasher, const E equal, const Q& query, const K& key) {
+        { hasher(query) } -> std::convertible_to<u64>;
+        { equal(query, key) } -> std::convertible_to<bool>;
+    };
+
+// explicit opt-in for hash functions chosen at runtime, every call is indirect
+template<typename K>
+struct RuntimeHasher {
+    HashFn<K> hash_fn = hashfn_default<K>;
+
+    u64 operator()(ConstLRefOrValType<K> key) const noexcept {
+        return hash_fn(key);
+    }
+};
 
 template<typename K>
+struct RuntimeEqual {
+    EqualFn<K> equal_fn = equal_fn_default<K>;
+
+    bool operator()(ConstLRefOrValType<K> first, ConstLRefOrValType<K> second) const noexcept {
+        return equal_fn(first, second);
+    }
+};
+
 struct HashMapConfig {
-    HashFn<K>   hash_fn;
-    EqualFn<K>  equal_fn;
     f32         load_factor;
     f32         grow_factor;
 
     HashMapConfig(
-        HashFn<K> hash_fn = hashfn_default<K>,
-        EqualFn<K> equal_fn = equal_fn_default<K>,
         f32 load_factor = 0.8f,
         f32 grow_factor = 2.0f
     )
-        : hash_fn{ hash_fn }
-        , equal_fn{ equal_fn }
-        , load_factor{ load_factor }
+        : load_factor{ load_factor }
         , grow_factor{ grow_factor }
     {}
 };
 
-template<typename K>
-static HashMapConfig<K> get_default_config() {
-    return HashMapConfig<K>{
-        hashfn_default<K>,
-        equal_fn_default<K>,
+// probe and resize counters, compiled in only with SF_HASHMAP_STATS defined
+#ifdef SF_HASHMAP_STATS
+inline constexpr bool HASHMAP_STATS_ENABLED = true;
+#else
+inline constexpr bool HASHMAP_STATS_ENABLED = false;
+#endif
+
+// probe lengths at or past the last histogram entry are counted in it
+inline constexpr u32 PROBE_HISTOGRAM_SIZE = 32;
+
+struct HashMapCounters {
+    // index is the number of buckets inspected by a lookup, minus one
+    u64 hit_probes[PROBE_HISTOGRAM_SIZE];
+    u64 miss_probes[PROBE_HISTOGRAM_SIZE];
+    u64 resize_count;
+    u64 resize_ns_total;
+    u64 resize_ns_max;
+    // every bucket block allocated over the map lifetime
+    u64 bytes_allocated_total;
+};
+
+struct HashMapNoCounters {};
+
+#ifdef SF_HASHMAP_STATS
+// Live counters of a map. Lookups may run concurrently under a shared lock (ConcurrentHashMap),
+// so every counter is a relaxed atomic; copies and snapshots are not synchronized with writers.
+struct HashMapAtomicCounters {
+    std::atomic<u64> hit_probes[PROBE_HISTOGRAM_SIZE]{};
+    std::atomic<u64> miss_probes[PROBE_HISTOGRAM_SIZE]{};
+    std::atomic<u64> resize_count{0};
+    std::atomic<u64> resize_ns_total{0};
+    std::atomic<u64> resize_ns_max{0};
+    std::atomic<u64> bytes_allocated_total{0};
+
+    HashMapAtomicCounters() noexcept = default;
+
+    HashMapAtomicCounters(const HashMapAtomicCounters& rhs) noexcept {
+        *this = rhs;
+    }
+
+    HashMapAtomicCounters& operator=(const HashMapAtomicCounters& rhs) noexcept {
+        for (u32 i{0}; i < PROBE_HISTOGRAM_SIZE; ++i) {
+            hit_probes[i].store(rhs.hit_probes[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            miss_probes[i].store(rhs.miss_probes[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        resize_count.store(rhs.resize_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        resize_ns_total.store(rhs.resize_ns_total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        resize_ns_max.store(rhs.resize_ns_max.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        bytes_allocated_total.store(rhs.bytes_allocated_total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+
+    HashMapCounters snapshot() const noexcept {
+        HashMapCounters result{};
+        for (u32 i{0}; i < PROBE_HISTOGRAM_SIZE; ++i) {
+            result.hit_probes[i] = hit_probes[i].load(std::memory_order_relaxed);
+            result.miss_probes[i] = miss_probes[i].load(std::memory_order_relaxed);
+        }
+        result.resize_count = resize_count.load(std::memory_order_relaxed);
+        result.resize_ns_total = resize_ns_total.load(std::memory_order_relaxed);
+        result.resize_ns_max = resize_ns_max.load(std::memory_order_relaxed);
+        result.bytes_allocated_total = bytes_allocated_total.load(std::memory_order_relaxed);
+        return result;
+    }
+};
+
+using HashMapCountersStorage = HashMapAtomicCounters;
+#else
+using HashMapCountersStorage = HashMapNoCounters;
+#endif
+
+// snapshot from 'stats()'; counters stay zero unless HASHMAP_STATS_ENABLED,
+// the rest is computed from the table on the call
+struct HashMapStats {
+    HashMapCounters counters;
+    u32             count;
+    u32             capacity;
+    u32             tombstone_count;
+    f32             load;
+    // longest run of occupied (live or tombstone) buckets
+    u32             max_cluster_length;
+    u64             bytes_in_use;
+};
+
+static HashMapConfig get_default_config() {
+    return HashMapConfig{
         0.8f,
         2.0f,
     };
 }
 
-template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, u32 DEFAULT_INIT_CAPACITY = 32>
+template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, u32 DEFAULT_INIT_CAPACITY = 32, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
 struct HashMap {
 public:
     using KeyType = K;
@@ -112,7 +272,8 @@ public:
 
     struct Bucket {
         K   key;
-        V   value;
+        // empty value types (HashSet) take no space
+        [[no_unique_address]] V value;
         u64 hash;
     };
 
@@ -120,55 +281,141 @@ public:
         Bucket* ptr;
         u32     handle; 
     };
+
+    struct EmplaceResult {
+        V*   value;
+        bool inserted;
+    };
+
+    // visits only live buckets, jumping between set bits of the occupancy bitmap
+    struct Iterator {
+    private:
+        Bucket*    _data;
+        const u64* _occupancy;
+        u64        _bits;
+        u32        _word;
+        u32        _capacity;
+        u32        _index;
+    public:
+        Iterator(Bucket* data, const u64* occupancy, u32 capacity) noexcept
+            : _data{data}
+            , _occupancy{occupancy}
+            , _bits{occupancy[0]}
+            , _word{0}
+            , _capacity{capacity}
+            , _index{capacity}
+        {
+            seek();
+        }
+
+        // end iterator
+        explicit Iterator(u32 capacity) noexcept
+            : _data{nullptr}
+            , _occupancy{nullptr}
+            , _bits{0}
+            , _word{0}
+            , _capacity{capacity}
+            , _index{capacity}
+        {}
+
+        Bucket& operator*() noexcept { return _data[_index]; }
+        Bucket* operator->() noexcept { return _data + _index; }
+
+        Iterator& operator++() noexcept {
+            _bits &= _bits - 1;
+            seek();
+            return *this;
+        }
+
+        friend bool operator==(const Iterator& first, const Iterator& second) noexcept {
+            return first._index == second._index;
+        }
+
+        friend bool operator!=(const Iterator& first, const Iterator& second) noexcept {
+            return first._index != second._index;
+        }
+    private:
+        void seek() noexcept {
+            u32 word_count = HashMap::occupancy_words(_capacity);
+            while (_bits == 0) {
+                if (++_word >= word_count) {
+                    _index = _capacity;
+                    return;
+                }
+                _bits = _occupancy[_word];
+            }
+            _index = _word * 64 + static_cast<u32>(std::countr_zero(_bits));
+        }
+    };
 private:
     // 1 capacity = 1 count = sizeof(Bucket<K, V>)
     Allocator*          _allocator;
     Data                _data;
     u32                 _capacity;
     u32                 _count;
-    HashMapConfig<K>    _config;
+    // removed entries still occupy buckets to keep probe chains intact until next resize
+    u32                 _tombstone_count;
+    HashMapConfig       _config;
+    [[no_unique_address]] Hasher   _hasher;
+    [[no_unique_address]] KeyEqual _equal;
+    [[no_unique_address]] HashMapCountersStorage _counters{};
 public: 
     static constexpr u64 FREE_HASH = 0;
     static constexpr u64 TOMBSTONE_HASH = 1;
     static constexpr u64 FIRST_VALID_HASH = 2;
     static constexpr bool USE_HANDLE = Allocator::using_handle();
+    // keys hashed and prefetched ahead in 'get_many'/'put_many'
+    static constexpr u32 BATCH_SIZE = 16;
 
-    HashMap(const HashMapConfig<K>& config = get_default_config<K>())
+    HashMap(const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
         : _allocator{get_current_gpa()}
         , _capacity{DEFAULT_INIT_CAPACITY}
         , _count{0}
+        , _tombstone_count{0}
         , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
     {
         SF_ASSERT(config.grow_factor > 1.0f);
         resize_empty(DEFAULT_INIT_CAPACITY);
     }
 
-    HashMap(Allocator* allocator, const HashMapConfig<K>& config = get_default_config<K>())
+    HashMap(Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
         : _allocator{allocator}
         , _capacity{DEFAULT_INIT_CAPACITY}
         , _count{0}
+        , _tombstone_count{0}
         , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
     {
         SF_ASSERT(config.grow_factor > 1.0f);
         resize_empty(DEFAULT_INIT_CAPACITY);
     }
     
-    HashMap(u32 prealloc_count, Allocator* allocator, const HashMapConfig<K>& config = get_default_config<K>())
+    HashMap(u32 prealloc_count, Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
         : _allocator{allocator}
         , _capacity{next_power_of_2(prealloc_count)}
         , _count{0}
+        , _tombstone_count{0}
         , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
     {
         SF_ASSERT(config.grow_factor > 1.0f);
         resize_empty(prealloc_count);
     }
 
-    HashMap(HashMap<K, V, Allocator>&& rhs) noexcept
+    HashMap(HashMap&& rhs) noexcept
         : _allocator{rhs._allocator}
         , _data{rhs._data}
         , _capacity{rhs._capacity}
         , _count{rhs._count}
+        , _tombstone_count{rhs._tombstone_count}
         , _config{rhs._config}
+        , _hasher{rhs._hasher}
+        , _equal{rhs._equal}
+        , _counters{rhs._counters}
     {
         rhs._allocator = nullptr;
         if constexpr (USE_HANDLE) {
@@ -176,12 +423,12 @@ public:
         } else {
             rhs._data.ptr = nullptr;
         }
-        rhs._buffer = nullptr;
         rhs._capacity = 0;
         rhs._count = 0;
+        rhs._tombstone_count = 0;
     }
 
-    HashMap<K, V, Allocator>& operator=(HashMap<K, V, Allocator>&& rhs) noexcept
+    HashMap& operator=(HashMap&& rhs) noexcept
     {
         if (this == &rhs) {
             return *this;
@@ -196,7 +443,11 @@ public:
         _data = rhs._data;
         _capacity = rhs._capacity;
         _count = rhs._count;
+        _tombstone_count = rhs._tombstone_count;
         _config = rhs._config;
+        _hasher = rhs._hasher;
+        _equal = rhs._equal;
+        _counters = rhs._counters;
 
         rhs._allocator = nullptr;
         if constexpr (USE_HANDLE) {
@@ -204,13 +455,15 @@ public:
         } else {
             rhs._data.ptr = nullptr;
         }
-        rhs._buffer = nullptr;
         rhs._capacity = 0;
         rhs._count = 0;
+        rhs._tombstone_count = 0;
+
+        return *this;
     }
     
-    HashMap(const HashMap<K, V, Allocator>& rhs) = delete;
-    HashMap<K, V, Allocator>& operator=(const HashMap<K, V, Allocator>& rhs) = delete;
+    HashMap(const HashMap& rhs) = delete;
+    HashMap& operator=(const HashMap& rhs) = delete;
 
     ~HashMap() noexcept {
         free();
@@ -219,74 +472,41 @@ public:
     void free() noexcept {
         if constexpr (USE_HANDLE) {
             if (_data.handle != INVALID_ALLOC_HANDLE) {
-                if constexpr (std::is_destructible_v<K> || std::is_destructible_v<V>) {
-                    for (auto it{begin()}; it != end(); ++it) {
-                        if (it->hash >= FIRST_VALID_HASH) {
-                            if constexpr (std::is_destructible_v<K>) {
-                                it->key.~K();
-                            }
-                            if constexpr (std::is_destructible_v<V>) {
-                                it->value.~V();
-                            }
-                        }
-                    }
-                }
+                destroy_entries();
                 _allocator->free_handle(_data.handle, alignof(Bucket));
                 _data.handle = INVALID_ALLOC_HANDLE;
             }
         } else {
             if (_data.ptr) {
-                if constexpr (std::is_destructible_v<K> || std::is_destructible_v<V>) {
-                    for (auto it{begin()}; it != end(); ++it) {
-                        if (it->hash >= FIRST_VALID_HASH) {
-                            if constexpr (std::is_destructible_v<K>) {
-                                it->key.~K();
-                            }
-                            if constexpr (std::is_destructible_v<V>) {
-                                it->value.~V();
-                            }
-                        }
-                    }
-                }
+                destroy_entries();
                 _allocator->free(_data.ptr, alignof(Bucket));
                 _data.ptr = nullptr;
             }
         }
         _count = 0;
+        _tombstone_count = 0;
         _capacity = 0;
     }
 
+    // touches only occupied buckets, unless tombstones are left to reset
     void clear() noexcept {
-        if constexpr (USE_HANDLE) {
-            if (_data.handle != INVALID_ALLOC_HANDLE) {
-                for (auto it{begin()}; it != end(); ++it) {
-                    if (it->hash >= FIRST_VALID_HASH) {
-                        it->hash = FREE_HASH;
-                        if constexpr (std::is_destructible_v<K>) {
-                            it->key.~K();
-                        }
-                        if constexpr (std::is_destructible_v<V>) {
-                            it->value.~V();
-                        }
-                    }
+        Bucket* data = access_data();
+        if (data) {
+            if (_tombstone_count > 0) {
+                destroy_entries();
+                for (u32 i{0}; i < _capacity; ++i) {
+                    data[i].hash = FREE_HASH;
                 }
-            }
-        } else {
-            if (_data.ptr) {
+            } else {
                 for (auto it{begin()}; it != end(); ++it) {
-                    if (it->hash >= FIRST_VALID_HASH) {
-                        it->hash = FREE_HASH;
-                        if constexpr (std::is_destructible_v<K>) {
-                            it->key.~K();
-                        }
-                        if constexpr (std::is_destructible_v<V>) {
-                            it->value.~V();
-                        }
-                    }
+                    destroy_bucket(*it);
+                    it->hash = FREE_HASH;
                 }
             }
+            sf_mem_zero(occupancy(), occupancy_words(_capacity) * sizeof(u64));
         }
         _count = 0;
+        _tombstone_count = 0;
    }
 
     void set_allocator(Allocator* alloc) noexcept {
@@ -298,80 +518,167 @@ public:
     template<typename Key, typename Val>
     void put(Key&& key, Val&& val) noexcept {
         SF_ASSERT_MSG(_allocator, "Should be valid pointer");
-        if (_count >= static_cast<u32>(_capacity * _config.load_factor)) {
-            resize(_capacity * _config.grow_factor);
-        }
+        grow_if_needed();
         put_inner(std::forward<Key&&>(key), std::forward<Val&&>(val));
     }
 
     template<typename Key, typename Val>
     void put_without_realloc(Key&& key, Val&& val) noexcept {
         SF_ASSERT_MSG(_allocator, "Should be valid pointer");
-        SF_ASSERT_MSG(_count < static_cast<u32>(_capacity * _config.load_factor), "Should have empty space");
+        SF_ASSERT_MSG(_count + _tombstone_count < static_cast<u32>(_capacity * _config.load_factor), "Should have empty space");
         put_inner(std::forward<Key&&>(key), std::forward<Val&&>(val));
     }
 
     // put without update
     template<typename Key, typename Val>
     bool put_if_empty(Key&& key, Val&& val) noexcept {
+        u64 hash = hash_inner(key);
+        return put_if_empty_with_hash(std::forward<Key&&>(key), std::forward<Val&&>(val), hash);
+    }
+
+    // The *_with_hash calls take the hash from 'hash_key' and do not hash the key again,
+    // for callers that already needed it (ConcurrentHashMap routes to a shard on it).
+    u64 hash_key(ConstLRefOrValType<K> key) noexcept {
+        return hash_inner(key);
+    }
+
+    template<typename Q> requires TransparentKey<Q, K, Hasher, KeyEqual>
+    u64 hash_key(const Q& key) noexcept {
+        return hash_inner(key);
+    }
+
+    template<typename Key, typename Val>
+    void put_with_hash(Key&& key, Val&& val, u64 hash) noexcept {
         SF_ASSERT_MSG(_allocator, "Should be valid pointer");
-        if (_count >= static_cast<u32>(_capacity * _config.load_factor)) {
-            resize(_capacity * _config.grow_factor);
+        grow_if_needed();
+        put_hashed(std::forward<Key&&>(key), std::forward<Val&&>(val), hash);
+    }
+
+    template<typename Key, typename Val>
+    bool put_if_empty_with_hash(Key&& key, Val&& val, u64 hash) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        grow_if_needed();
+
+        Bucket* bucket = find_bucket_for_insert(key, hash);
+
+        if (bucket->hash >= FIRST_VALID_HASH) {
+            return false;
         }
 
+        place_bucket(bucket, std::forward<Key&&>(key), std::forward<Val&&>(val), hash);
+        return true;
+    }
+
+    // value for the key, built from 'factory()' in place when missing; one hash and probe
+    template<typename Key, typename F>
+    V& find_or_insert(Key&& key, F&& factory) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        u64 hash = hash_inner(key);
+        Bucket* bucket = find_bucket_or_slot(key, hash);
+        if (bucket->hash < FIRST_VALID_HASH) {
+            emplace_bucket(bucket, hash, std::forward<Key>(key), factory());
+        }
+        return bucket->value;
+    }
+
+    // constructs the value from 'args' only when the key is missing, existing entries are left as is
+    template<typename Key, typename... Args>
+    EmplaceResult try_emplace(Key&& key, Args&&... args) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        u64 hash = hash_inner(key);
+        Bucket* bucket = find_bucket_or_slot(key, hash);
+        if (bucket->hash >= FIRST_VALID_HASH) {
+            return EmplaceResult{ .value = &bucket->value, .inserted = false };
+        }
+
+        emplace_bucket(bucket, hash, std::forward<Key>(key), std::forward<Args>(args)...);
+        return EmplaceResult{ .value = &bucket->value, .inserted = true };
+    }
+
+    // applies 'fn(V&)' to the value, default constructed first when the key is missing
+    template<typename Key, typename F>
+    V& upsert(Key&& key, F&& fn) noexcept {
+        V& value = find_or_insert(std::forward<Key>(key), [] { return V{}; });
+        fn(value);
+        return value;
+    }
+
+    V* get(ConstLRefOrValType<K> key) noexcept {
+        return get_inner(key, hash_inner(key));
+    }
+
+    template<typename Q> requires std::same_as<Q, K> || TransparentKey<Q, K, Hasher, KeyEqual>
+    V* get_with_hash(const Q& key, u64 hash) noexcept {
+        return get_inner(key, hash);
+    }
+
+    // resolves keys in groups of BATCH_SIZE: the whole group is hashed and its home
+    // buckets prefetched before the first probe, so the cache misses overlap
+    void get_many(std::span<const K> keys, std::span<V*> out) noexcept {
+        SF_ASSERT_MSG(out.size() >= keys.size(), "Output should have a slot for every key");
         Bucket* data = access_data();
-        u64 hash = hash_inner();
-        u32 index = index_hash(hash);
+        u64 hashes[BATCH_SIZE];
 
-        for (u32 i = index; i < _capacity; ++i) {
-            if (data[i].hash < FIRST_VALID_HASH) {
-                ::new (&data[i]) Bucket{ .key = std::forward<Key&&>(key), .value = std::forward<Val&&>(val), .hash = hash };
-                ++_count;
-                return true;
+        for (usize start{0}; start < keys.size(); start += BATCH_SIZE) {
+            usize batch_count = std::min<usize>(BATCH_SIZE, keys.size() - start);
+
+            for (usize i{0}; i < batch_count; ++i) {
+                hashes[i] = hash_inner(keys[start + i]);
+                sf_mem_prefetch(data + index_hash(hashes[i]));
             }
-            else if (hash == data[i].hash && _config.equal_fn(key, data[i].key)) {
-                return false;
+
+            for (usize i{0}; i < batch_count; ++i) {
+                Bucket* bucket = find_bucket_hashed(keys[start + i], hashes[i]);
+                out[start + i] = bucket ? &bucket->value : nullptr;
             }
         }
+    }
 
-        for (u32 i = 0; i < index; ++i) {
-            if (data[i].hash < FIRST_VALID_HASH) {
-                ::new (&data[i]) Bucket{ .key = std::forward<Key&&>(key), .value = std::forward<Val&&>(val), .hash = hash };
-                ++_count;
-                return true;
+    // batched 'put', updates entries with the same key
+    void put_many(std::span<const K> keys, std::span<const V> values) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        SF_ASSERT_MSG(values.size() >= keys.size(), "Should have a value for every key");
+
+        // grow once up front, a resize in the middle of a group would drop its prefetches
+        u32 needed = _count + _tombstone_count + static_cast<u32>(keys.size());
+        if (needed >= static_cast<u32>(_capacity * _config.load_factor)) {
+            resize(next_power_of_2(static_cast<u32>(needed / _config.load_factor) + 1));
+        }
+
+        Bucket* data = access_data();
+        u64 hashes[BATCH_SIZE];
+
+        for (usize start{0}; start < keys.size(); start += BATCH_SIZE) {
+            usize batch_count = std::min<usize>(BATCH_SIZE, keys.size() - start);
+
+            for (usize i{0}; i < batch_count; ++i) {
+                hashes[i] = hash_inner(keys[start + i]);
+                sf_mem_prefetch(data + index_hash(hashes[i]));
             }
-            else if (hash == data[i].hash && _config.equal_fn(key, data[i].key)) {
-                return false;
+
+            for (usize i{0}; i < batch_count; ++i) {
+                put_hashed(keys[start + i], values[start + i], hashes[i]);
             }
         }
     }
 
-    V* get(ConstLRefOrValType<K> key) noexcept {
-        Bucket* maybe_bucket = find_bucket(key);
-        if (!maybe_bucket) {
-            return nullptr;
-        }
-
-        return &maybe_bucket->value;
+    template<typename Q> requires TransparentKey<Q, K, Hasher, KeyEqual>
+    V* get(const Q& key) noexcept {
+        return get_inner(key, hash_inner(key));
     }
 
     bool remove(ConstLRefOrValType<K> key) noexcept {
-        Bucket* bucket = find_bucket(key);
-        if (!bucket) {
-            return false;
-        }
+        return remove_inner(key, hash_inner(key));
+    }
 
-        if constexpr (std::is_destructible_v<K>) {
-            bucket->key.~K();
-        }
-        if constexpr (std::is_destructible_v<V>) {
-            bucket->value.~V();
-        }
-        
-        bucket->hash = FREE_HASH;
-        --_count;
+    template<typename Q> requires TransparentKey<Q, K, Hasher, KeyEqual>
+    bool remove(const Q& key) noexcept {
+        return remove_inner(key, hash_inner(key));
+    }
 
-        return true;
+    template<typename Q> requires std::same_as<Q, K> || TransparentKey<Q, K, Hasher, KeyEqual>
+    bool remove_with_hash(const Q& key, u64 hash) noexcept {
+        return remove_inner(key, hash);
     }
 
     void reserve(u32 new_capacity) noexcept {
@@ -385,8 +692,9 @@ public:
     }
 
     void fill(ConstLRefOrValType<V> val) noexcept {
-        for (auto it{begin()}; it != end(); ++it) {
-            it->value = val;
+        Bucket* data = access_data();
+        for (u32 i{0}; i < _capacity; ++i) {
+            data[i].value = val;
         }
         _count = _capacity;
     }
@@ -402,39 +710,131 @@ public:
     constexpr u32 count() const noexcept { return _count; }
     constexpr u32 size_in_bytes() const noexcept { return sizeof(Bucket) * _count; }
     constexpr u32 capacity() const noexcept { return _capacity; }
+
+    // all 'capacity()' buckets in probing order, free and tombstone ones included
+    const Bucket* data() noexcept { return access_data(); }
     constexpr u32 capacity_remain() const noexcept { return _capacity - _count; }
 
-    constexpr PtrRandomAccessIterator<Bucket> begin() noexcept {
-        return PtrRandomAccessIterator<Bucket>(access_data());
+    Iterator begin() noexcept {
+        Bucket* data = access_data();
+        if (!data) {
+            return end();
+        }
+        return Iterator(data, occupancy(), _capacity);
+    }
+
+    Iterator end() noexcept {
+        return Iterator(_capacity);
     }
 
-    constexpr PtrRandomAccessIterator<Bucket> end() noexcept {
-        return PtrRandomAccessIterator<Bucket>(access_data() + _capacity);
+    static constexpr u32 occupancy_words(u32 capacity) noexcept {
+        return (capacity + 63) / 64;
+    }
+
+    // walks the whole table for the cluster length, meant for diagnostics not hot paths
+    HashMapStats stats() noexcept {
+        HashMapStats result{};
+#ifdef SF_HASHMAP_STATS
+        result.counters = _counters.snapshot();
+#endif
+        result.count = _count;
+        result.capacity = _capacity;
+        result.tombstone_count = _tombstone_count;
+        result.load = _capacity > 0 ? static_cast<f32>(_count + _tombstone_count) / _capacity : 0.0f;
+        result.bytes_in_use = access_data() ? block_size(_capacity) : 0;
+
+        Bucket* data = access_data();
+        if (!data) {
+            return result;
+        }
+
+        // a run touching both ends wraps around, like probing does
+        u32 leading{0};
+        while (leading < _capacity && data[leading].hash != FREE_HASH) {
+            ++leading;
+        }
+        if (leading == _capacity) {
+            result.max_cluster_length = _capacity;
+            return result;
+        }
+
+        u32 run{0};
+        for (u32 i{leading}; i < _capacity; ++i) {
+            run = data[i].hash != FREE_HASH ? run + 1 : 0;
+            result.max_cluster_length = std::max(result.max_cluster_length, run);
+        }
+        result.max_cluster_length = std::max(result.max_cluster_length, run + leading);
+
+        return result;
     }
 private:
     Bucket* access_data() {
         if constexpr (USE_HANDLE) {
+            if (_data.handle == INVALID_ALLOC_HANDLE) {
+                return nullptr;
+            }
             return static_cast<Bucket*>(_allocator->handle_to_ptr(_data.handle));
         } else {
             return _data.ptr;
         }
     }
 
+    // buckets and their occupancy bitmap share one block, the bitmap follows the buckets
+    static constexpr usize block_size(u32 capacity) noexcept {
+        return capacity * sizeof(Bucket) + occupancy_words(capacity) * sizeof(u64);
+    }
+
+    static u64* occupancy_of(Bucket* data, u32 capacity) noexcept {
+        return reinterpret_cast<u64*>(data + capacity);
+    }
+
+    u64* occupancy() noexcept {
+        return occupancy_of(access_data(), _capacity);
+    }
+
+    static void mark_occupied(u64* occupancy, u32 index) noexcept {
+        occupancy[index >> 6] |= u64{1} << (index & 63);
+    }
+
+    void destroy_bucket(Bucket& bucket) noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K>) {
+            bucket.key.~K();
+        }
+        if constexpr (!std::is_trivially_destructible_v<V>) {
+            bucket.value.~V();
+        }
+    }
+
+    void destroy_entries() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K> || !std::is_trivially_destructible_v<V>) {
+            for (auto it{begin()}; it != end(); ++it) {
+                destroy_bucket(*it);
+            }
+        }
+    }
+
     void resize_empty(u32 new_capacity) {
         SF_ASSERT_MSG(_allocator, "Should be valid pointer");
-        _capacity = new_capacity == 0 ? DEFAULT_INIT_CAPACITY : new_capacity;
+        // index_hash masks with capacity - 1
+        _capacity = next_power_of_2(new_capacity == 0 ? DEFAULT_INIT_CAPACITY : new_capacity);
+#ifdef SF_HASHMAP_STATS
+        _counters.bytes_allocated_total.fetch_add(block_size(_capacity), std::memory_order_relaxed);
+#endif
 
         if constexpr (USE_HANDLE) {
-            _data.handle = _allocator->allocate_handle(_capacity * sizeof(Bucket), alignof(Bucket));
+            _data.handle = _allocator->allocate_handle(block_size(_capacity), alignof(Bucket));
             init_buffer_empty(access_data(), _capacity);
         } else {
-            _data.ptr = static_cast<Bucket*>(_allocator->allocate(_capacity * sizeof(Bucket), alignof(Bucket)));
+            _data.ptr = static_cast<Bucket*>(_allocator->allocate(block_size(_capacity), alignof(Bucket)));
             init_buffer_empty(_data.ptr, _capacity);
         }
     }
 
     void resize(u32 new_capacity) noexcept {
         SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+#ifdef SF_HASHMAP_STATS
+        auto resize_start = std::chrono::steady_clock::now();
+#endif
 
         u32 old_capacity = _capacity;
         if (_capacity == 0) {
@@ -444,17 +844,26 @@ private:
             _capacity *= _config.grow_factor;
         }
 
-        Bucket* old_buffer = access_data();
-        Bucket* new_buffer = (Bucket*)_allocator->allocate(_capacity * sizeof(Bucket), alignof(Bucket));
+        Bucket* old_buffer;
+        Bucket* new_buffer;
+        if constexpr (USE_HANDLE) {
+            // allocating may move the allocator's buffer, so the old handle is resolved after it
+            usize new_handle = _allocator->allocate_handle(block_size(_capacity), alignof(Bucket));
+            new_buffer = static_cast<Bucket*>(_allocator->handle_to_ptr(new_handle));
+            old_buffer = access_data();
+        } else {
+            old_buffer = access_data();
+            new_buffer = static_cast<Bucket*>(_allocator->allocate(block_size(_capacity), alignof(Bucket)));
+        }
         init_buffer_empty(new_buffer, _capacity);
 
         // copy old nodes
-        for (u32 i{0}; i < old_capacity; ++i) {
-            Bucket&& bucket{ std::move(old_buffer[i]) };
-            if (bucket.hash < FIRST_VALID_HASH) {
-                continue;
+        const u64* old_occupancy = occupancy_of(old_buffer, old_capacity);
+        for (u32 word{0}; word < occupancy_words(old_capacity); ++word) {
+            for (u64 bits{old_occupancy[word]}; bits != 0; bits &= bits - 1) {
+                Bucket&& bucket{ std::move(old_buffer[word * 64 + std::countr_zero(bits)]) };
+                put_old_entry(new_buffer, std::forward<K&&>(bucket.key), std::forward<V&&>(bucket.value));
             }
-            put_old_entry(new_buffer, std::forward<K&&>(bucket.key), std::forward<V&&>(bucket.value));
         }
 
         if constexpr (USE_HANDLE) {
@@ -462,8 +871,18 @@ private:
         } else {
             _data.ptr = new_buffer;
         }
+        _tombstone_count = 0;
 
         _allocator->free(old_buffer, alignof(Bucket));
+
+#ifdef SF_HASHMAP_STATS
+        u64 resize_ns = static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - resize_start).count());
+        // resizes are exclusive, only lookups race with each other
+        _counters.resize_count.fetch_add(1, std::memory_order_relaxed);
+        _counters.resize_ns_total.fetch_add(resize_ns, std::memory_order_relaxed);
+        _counters.resize_ns_max.store(std::max(_counters.resize_ns_max.load(std::memory_order_relaxed), resize_ns), std::memory_order_relaxed);
+        _counters.bytes_allocated_total.fetch_add(block_size(_capacity), std::memory_order_relaxed);
+#endif
     }
 
     void init_buffer_empty(Bucket* new_buffer, u32 capacity) {
@@ -471,66 +890,161 @@ private:
             return;
         }
 
-        sf_mem_zero(new_buffer, capacity * sizeof(Bucket));
+        sf_mem_zero(new_buffer, block_size(capacity));
     }
 
-    Bucket* find_bucket(ConstLRefOrValType<K> key) noexcept {
-        u64 hash = hash_inner(key);
+    template<typename Q>
+    V* get_inner(const Q& key, u64 hash) noexcept {
+        Bucket* maybe_bucket = find_bucket_hashed(key, hash);
+        if (!maybe_bucket) {
+            return nullptr;
+        }
+
+        return &maybe_bucket->value;
+    }
+
+    template<typename Q>
+    bool remove_inner(const Q& key, u64 hash) noexcept {
+        Bucket* bucket = find_bucket_hashed(key, hash);
+        if (!bucket) {
+            return false;
+        }
+
+        destroy_bucket(*bucket);
+
+        // FREE_HASH here would cut probe chains of entries placed after this one
+        bucket->hash = TOMBSTONE_HASH;
+        u32 index = static_cast<u32>(bucket - access_data());
+        occupancy()[index >> 6] &= ~(u64{1} << (index & 63));
+        ++_tombstone_count;
+        --_count;
+
+        return true;
+    }
+
+    template<typename Q>
+    Bucket* find_bucket_hashed(const Q& key, u64 hash) noexcept {
         u32 index = index_hash(hash);
-        u32 search_count = 0;
 
         Bucket* data = access_data();
         for (u32 i = index; i < _capacity; ++i) {
             if (data[i].hash >= FIRST_VALID_HASH) {
-                if (data[i].hash == hash && _config.equal_fn(key, data[i].key)) {
+                if (data[i].hash == hash && _equal(key, data[i].key)) {
+                    record_probes(true, i - index + 1);
                     return data + i;
                 }
             } else if (data[i].hash == FREE_HASH) {
+                record_probes(false, i - index + 1);
                 return nullptr;
             }
         }
 
         for (u32 i = 0; i < index; ++i) {
             if (data[i].hash >= FIRST_VALID_HASH) {
-                if (data[i].hash == hash && _config.equal_fn(key, data[i].key)) {
+                if (data[i].hash == hash && _equal(key, data[i].key)) {
+                    record_probes(true, _capacity - index + i + 1);
                     return data + i;
                 }
             } else if (data[i].hash == FREE_HASH) {
+                record_probes(false, _capacity - index + i + 1);
                 return nullptr;
             }
         }
 
+        record_probes(false, _capacity);
         return nullptr;
     }
 
+    void record_probes([[maybe_unused]] bool hit, [[maybe_unused]] u32 probes) noexcept {
+#ifdef SF_HASHMAP_STATS
+        u32 slot = std::min(probes, PROBE_HISTOGRAM_SIZE) - 1;
+        (hit ? _counters.hit_probes : _counters.miss_probes)[slot].fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
     template<typename Key, typename Val>
     void put_inner(Key&& key, Val&& val) noexcept {
+        put_hashed(std::forward<Key&&>(key), std::forward<Val&&>(val), hash_inner(key));
+    }
+
+    template<typename Key, typename Val>
+    void put_hashed(Key&& key, Val&& val, u64 hash) noexcept {
+        Bucket* bucket = find_bucket_for_insert(key, hash);
+
+        if (bucket->hash >= FIRST_VALID_HASH) {
+            bucket->value = std::forward<Val&&>(val);
+            return;
+        }
+
+        place_bucket(bucket, std::forward<Key&&>(key), std::forward<Val&&>(val), hash);
+    }
+
+    // returns the bucket holding the key, or the first reusable (free or tombstone) bucket
+    // on its probe chain; the whole chain is checked before a tombstone is reused
+    Bucket* find_bucket_for_insert(ConstLRefOrValType<K> key, u64 hash) noexcept {
         Bucket* data = access_data();
-        u64 hash = hash_inner(key);
+        u32 mask = _capacity - 1;
         u32 index = index_hash(hash);
+        Bucket* first_tombstone = nullptr;
 
-        for (u32 i = index; i < _capacity; ++i) {
-            if (data[i].hash < FIRST_VALID_HASH) {
-                ::new (&data[i]) Bucket{ .key = std::forward<Key&&>(key), .value = std::forward<Val&&>(val), .hash = hash };
-                ++_count;
-                return;
-            }
-            else if (hash == data[i].hash && _config.equal_fn(key, data[i].key)) {
-                data[i].value = std::forward<Val&&>(val);
-                return;
+        for (u32 n{0}; n <= mask; ++n) {
+            Bucket* bucket = data + ((index + n) & mask);
+            if (bucket->hash == hash) {
+                if (_equal(key, bucket->key)) {
+                    return bucket;
+                }
+            } else if (bucket->hash == FREE_HASH) {
+                return first_tombstone ? first_tombstone : bucket;
+            } else if (bucket->hash == TOMBSTONE_HASH && !first_tombstone) {
+                first_tombstone = bucket;
             }
         }
 
-        for (u32 i = 0; i < index; ++i) {
-            if (data[i].hash < FIRST_VALID_HASH) {
-                ::new (&data[i]) Bucket{ .key = std::forward<Key&&>(key), .value = std::forward<Val&&>(val), .hash = hash };
-                ++_count;
-                return;
-            }
-            else if (hash == data[i].hash && _config.equal_fn(key, data[i].key)) {
-                data[i].value = std::forward<Val&&>(val);
-                return;
-            }
+        SF_ASSERT_MSG(first_tombstone, "Should have empty space");
+        return first_tombstone;
+    }
+
+    template<typename Key, typename Val>
+    void place_bucket(Bucket* bucket, Key&& key, Val&& val, u64 hash) noexcept {
+        if (bucket->hash == TOMBSTONE_HASH) {
+            --_tombstone_count;
+        }
+        ::new (bucket) Bucket{ .key = std::forward<Key&&>(key), .value = std::forward<Val&&>(val), .hash = hash };
+        mark_occupied(occupancy(), static_cast<u32>(bucket - access_data()));
+        ++_count;
+    }
+
+    // bucket holding the key, or the slot to insert it into; a full table is grown
+    // only when the key turns out to be missing, so hits never pay for a resize
+    Bucket* find_bucket_or_slot(ConstLRefOrValType<K> key, u64 hash) noexcept {
+        if (_count + _tombstone_count < static_cast<u32>(_capacity * _config.load_factor)) {
+            return find_bucket_for_insert(key, hash);
+        }
+
+        Bucket* bucket = find_bucket_hashed(key, hash);
+        if (bucket) {
+            return bucket;
+        }
+        grow_if_needed();
+        return find_bucket_for_insert(key, hash);
+    }
+
+    template<typename Key, typename... Args>
+    void emplace_bucket(Bucket* bucket, u64 hash, Key&& key, Args&&... args) noexcept {
+        if (bucket->hash == TOMBSTONE_HASH) {
+            --_tombstone_count;
+        }
+        ::new (&bucket->key) K(std::forward<Key>(key));
+        ::new (&bucket->value) V(std::forward<Args>(args)...);
+        bucket->hash = hash;
+        mark_occupied(occupancy(), static_cast<u32>(bucket - access_data()));
+        ++_count;
+    }
+
+    void grow_if_needed() noexcept {
+        if (_count + _tombstone_count >= static_cast<u32>(_capacity * _config.load_factor)) {
+            // mostly tombstones: rehash at the same capacity to reclaim them
+            resize(_tombstone_count > _count ? _capacity : _capacity * _config.grow_factor);
         }
     }
 
@@ -543,6 +1057,7 @@ private:
         for (u32 i = index; i < _capacity; ++i) {
             if (new_buffer[i].hash < FIRST_VALID_HASH) {
                 ::new (&new_buffer[i]) Bucket{ .key = std::forward<Key&&>(key), .value = std::forward<Val&&>(val), .hash = hash };
+                mark_occupied(occupancy_of(new_buffer, _capacity), i);
                 return;
             }
         }
@@ -550,6 +1065,7 @@ private:
         for (u32 i = 0; i < index; ++i) {
             if (new_buffer[i].hash < FIRST_VALID_HASH) {
                 ::new (&new_buffer[i]) Bucket{ .key = std::forward<Key&&>(key), .value = std::forward<Val&&>(val), .hash = hash };
+                mark_occupied(occupancy_of(new_buffer, _capacity), i);
                 return;
             }
         }
@@ -558,7 +1074,12 @@ private:
     }
 
     u64 hash_inner(ConstLRefOrValType<K> key) {
-        return std::max(_config.hash_fn(key), FIRST_VALID_HASH);
+        return std::max(_hasher(key), FIRST_VALID_HASH);
+    }
+
+    template<typename Q> requires TransparentKey<Q, K, Hasher, KeyEqual>
+    u64 hash_inner(const Q& key) {
+        return std::max<u64>(_hasher(key), FIRST_VALID_HASH);
     }
 
     u32 index_hash(u64 hash) {
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "hashmap.hpp"
+#include "io.hpp"
+#include "result.hpp"
+#include "defines.hpp"
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+namespace sf {
+
+// File image of a HashMap: this header followed by the raw bucket array, in the
+// positions the map probed them into. Loading maps the file and probes it in place.
+// Hash values are stored, so the hasher must give the same hashes in every process
+// (DefaultHasher does, seeded or pointer keys do not).
+struct HashMapSnapshotHeader {
+    u64 magic;
+    u32 version;
+    u32 key_size;
+    u32 value_size;
+    u32 bucket_size;
+    u32 bucket_alignment;
+    u32 capacity;
+    u32 count;
+    u8  padding[28];
+};
+
+// buckets start right after the header, which keeps them aligned in a page aligned mapping
+static_assert(sizeof(HashMapSnapshotHeader) == 64);
+
+inline constexpr u64 HASHMAP_SNAPSHOT_MAGIC = 0x31504e5350414d48; // "HMAPSNP1"
+inline constexpr u32 HASHMAP_SNAPSHOT_VERSION = 1;
+
+template<typename K, typename V>
+concept SnapshotTrivial = std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>;
+
+template<typename K, typename V, AllocatorTrait Allocator, u32 DEFAULT_INIT_CAPACITY, HasherTrait<K> Hasher, KeyEqualTrait<K> KeyEqual>
+requires SnapshotTrivial<K, V>
+bool save_snapshot(HashMap<K, V, Allocator, DEFAULT_INIT_CAPACITY, Hasher, KeyEqual>& map, std::string_view file_path) noexcept {
+    using Bucket = typename HashMap<K, V, Allocator, DEFAULT_INIT_CAPACITY, Hasher, KeyEqual>::Bucket;
+    static_assert(alignof(Bucket) <= sizeof(HashMapSnapshotHeader), "Buckets would be misaligned after the header");
+
+    HashMapSnapshotHeader header{
+        .magic = HASHMAP_SNAPSHOT_MAGIC,
+        .version = HASHMAP_SNAPSHOT_VERSION,
+        .key_size = sizeof(K),
+        .value_size = sizeof(V),
+        .bucket_size = sizeof(Bucket),
+        .bucket_alignment = alignof(Bucket),
+        .capacity = map.data() ? map.capacity() : 0,
+        .count = map.count(),
+        .padding = {},
+    };
+
+    return write_file(file_path, {
+        std::span<const u8>{ reinterpret_cast<const u8*>(&header), sizeof(header) },
+        std::span<const u8>{ reinterpret_cast<const u8*>(map.data()), static_cast<usize>(header.capacity) * sizeof(Bucket) },
+    });
+}
+
+// Read-only HashMap over a mapped snapshot file, nothing is copied or rehashed on open.
+// Probing matches HashMap, so a snapshot opens with the same Hasher and KeyEqual it was saved with.
+template<typename K, typename V, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+requires SnapshotTrivial<K, V>
+struct MappedHashMap {
+public:
+    using KeyType = K;
+    using ValueType = V;
+    using Bucket = typename HashMap<K, V>::Bucket;
+
+    static constexpr u64 FREE_HASH = HashMap<K, V>::FREE_HASH;
+    static constexpr u64 FIRST_VALID_HASH = HashMap<K, V>::FIRST_VALID_HASH;
+private:
+    MappedFile      _file;
+    const Bucket*   _buckets;
+    u32             _capacity;
+    u32             _count;
+    [[no_unique_address]] Hasher   _hasher;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    MappedHashMap() noexcept
+        : _file{nullptr, 0}
+        , _buckets{nullptr}
+        , _capacity{0}
+        , _count{0}
+    {}
+
+    MappedHashMap(MappedHashMap&& rhs) noexcept
+        : _file{rhs._file}
+        , _buckets{rhs._buckets}
+        , _capacity{rhs._capacity}
+        , _count{rhs._count}
+        , _hasher{rhs._hasher}
+        , _equal{rhs._equal}
+    {
+        rhs.reset_empty();
+    }
+
+    MappedHashMap& operator=(MappedHashMap&& rhs) noexcept {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        close();
+        _file = rhs._file;
+        _buckets = rhs._buckets;
+        _capacity = rhs._capacity;
+        _count = rhs._count;
+        _hasher = rhs._hasher;
+        _equal = rhs._equal;
+
+        rhs.reset_empty();
+        return *this;
+    }
+
+    MappedHashMap(const MappedHashMap& rhs) = delete;
+    MappedHashMap& operator=(const MappedHashMap& rhs) = delete;
+
+    ~MappedHashMap() noexcept {
+        close();
+    }
+
+    // fails on missing files and on snapshots of other key, value or bucket layouts
+    bool open(std::string_view file_path, Hasher hasher = {}, KeyEqual equal = {}) noexcept {
+        close();
+
+        Result<MappedFile> mapped = map_file_read_only(file_path);
+        if (mapped.is_err()) {
+            return false;
+        }
+        _file = mapped.unwrap_copy();
+
+        HashMapSnapshotHeader header;
+        if (_file.size < sizeof(header)) {
+            close();
+            return false;
+        }
+        sf_mem_copy(&header, (void*)_file.data, sizeof(header));
+
+        bool valid = header.magic == HASHMAP_SNAPSHOT_MAGIC
+            && header.version == HASHMAP_SNAPSHOT_VERSION
+            && header.key_size == sizeof(K)
+            && header.value_size == sizeof(V)
+            && header.bucket_size == sizeof(Bucket)
+            && header.bucket_alignment == alignof(Bucket)
+            && (header.capacity & (header.capacity - 1)) == 0
+            && _file.size >= sizeof(header) + static_cast<usize>(header.capacity) * sizeof(Bucket);
+        if (!valid) {
+            close();
+            return false;
+        }
+
+        _buckets = reinterpret_cast<const Bucket*>(_file.data + sizeof(header));
+        _capacity = header.capacity;
+        _count = header.count;
+        _hasher = hasher;
+        _equal = equal;
+        return true;
+    }
+
+    void close() noexcept {
+        unmap_file(_file);
+        reset_empty();
+    }
+
+    const V* get(ConstLRefOrValType<K> key) const noexcept {
+        if (_capacity == 0) {
+            return nullptr;
+        }
+
+        u64 hash = std::max<u64>(_hasher(key), FIRST_VALID_HASH);
+        u32 mask = _capacity - 1;
+        for (u32 n{0}, index = static_cast<u32>(hash) & mask; n < _capacity; ++n, index = (index + 1) & mask) {
+            const Bucket& bucket = _buckets[index];
+            if (bucket.hash == hash && _equal(key, bucket.key)) {
+                return &bucket.value;
+            }
+            if (bucket.hash == FREE_HASH) {
+                return nullptr;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool has(ConstLRefOrValType<K> key) const noexcept {
+        return get(key) != nullptr;
+    }
+
+    // calls 'fn(const K&, const V&)' for every entry, in bucket order
+    template<typename F>
+    void for_each(F&& fn) const noexcept {
+        for (u32 i{0}; i < _capacity; ++i) {
+            if (_buckets[i].hash >= FIRST_VALID_HASH) {
+                fn(_buckets[i].key, _buckets[i].value);
+            }
+        }
+    }
+
+    bool is_open() const noexcept { return _file.data != nullptr; }
+    bool is_empty() const noexcept { return _count == 0; }
+    constexpr u32 count() const noexcept { return _count; }
+    constexpr u32 capacity() const noexcept { return _capacity; }
+private:
+    void reset_empty() noexcept {
+        _file = MappedFile{nullptr, 0};
+        _buckets = nullptr;
+        _capacity = 0;
+        _count = 0;
+    }
+};
+
+} // sf
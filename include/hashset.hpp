@@ -0,0 +1,151 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "general_purpose_allocator.hpp"
+#include "hashmap.hpp"
+#include "traits.hpp"
+#include "defines.hpp"
+#include <utility>
+
+namespace sf {
+
+// value type of the HashMap behind HashSet, occupies no bucket space
+struct SetEmpty {
+    friend constexpr bool operator==(SetEmpty, SetEmpty) noexcept { return true; }
+};
+
+// Set of keys on the HashMap engine (same probing, tombstones and growth), buckets
+// hold only the key and its hash: 16 bytes for u64 keys instead of 24 with HashMap<u64, bool>.
+template<typename K, AllocatorTrait Allocator = GeneralPurposeAllocator, u32 DEFAULT_INIT_CAPACITY = 32, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct HashSet {
+public:
+    using KeyType = K;
+    using MapType = HashMap<K, SetEmpty, Allocator, DEFAULT_INIT_CAPACITY, Hasher, KeyEqual>;
+    using Bucket = typename MapType::Bucket;
+    using MapIterator = decltype(std::declval<MapType&>().begin());
+
+    struct Iterator {
+    private:
+        MapIterator _it;
+        MapIterator _end;
+    public:
+        Iterator(MapIterator it, MapIterator end) noexcept
+            : _it{it}
+            , _end{end}
+        {
+            skip_empty();
+        }
+
+        const K& operator*() noexcept { return _it->key; }
+        const K* operator->() noexcept { return &_it->key; }
+
+        Iterator& operator++() noexcept {
+            ++_it;
+            skip_empty();
+            return *this;
+        }
+
+        friend bool operator==(const Iterator& first, const Iterator& second) noexcept {
+            return first._it == second._it;
+        }
+
+        friend bool operator!=(const Iterator& first, const Iterator& second) noexcept {
+            return first._it != second._it;
+        }
+    private:
+        void skip_empty() noexcept {
+            while (_it != _end && _it->hash < MapType::FIRST_VALID_HASH) {
+                ++_it;
+            }
+        }
+    };
+private:
+    MapType _map;
+public:
+    HashSet(const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _map{config, hasher, equal}
+    {}
+
+    HashSet(Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _map{allocator, config, hasher, equal}
+    {}
+
+    HashSet(u32 prealloc_count, Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _map{prealloc_count, allocator, config, hasher, equal}
+    {}
+
+    HashSet(HashSet&& rhs) noexcept = default;
+    HashSet& operator=(HashSet&& rhs) noexcept = default;
+    HashSet(const HashSet& rhs) = delete;
+    HashSet& operator=(const HashSet& rhs) = delete;
+
+    // returns false when the key was already there
+    template<typename Key>
+    bool insert(Key&& key) noexcept {
+        return _map.try_emplace(std::forward<Key>(key)).inserted;
+    }
+
+    bool contains(ConstLRefOrValType<K> key) noexcept {
+        return _map.get(key) != nullptr;
+    }
+
+    template<typename Q> requires TransparentKey<Q, K, Hasher, KeyEqual>
+    bool contains(const Q& key) noexcept {
+        return _map.get(key) != nullptr;
+    }
+
+    bool remove(ConstLRefOrValType<K> key) noexcept {
+        return _map.remove(key);
+    }
+
+    template<typename Q> requires TransparentKey<Q, K, Hasher, KeyEqual>
+    bool remove(const Q& key) noexcept {
+        return _map.remove(key);
+    }
+
+    // adds every key of 'other'
+    void union_with(HashSet& other) noexcept {
+        for (const K& key : other) {
+            insert(key);
+        }
+    }
+
+    // keeps only keys also in 'other'; removing marks tombstones, so iterating meanwhile is safe
+    void intersect_with(HashSet& other) noexcept {
+        for (auto it{_map.begin()}; it != _map.end(); ++it) {
+            if (it->hash >= MapType::FIRST_VALID_HASH && !other.contains(it->key)) {
+                _map.remove(it->key);
+            }
+        }
+    }
+
+    // removes every key of 'other'
+    void difference_with(HashSet& other) noexcept {
+        if (other.count() < count()) {
+            for (const K& key : other) {
+                remove(key);
+            }
+        } else {
+            for (auto it{_map.begin()}; it != _map.end(); ++it) {
+                if (it->hash >= MapType::FIRST_VALID_HASH && other.contains(it->key)) {
+                    _map.remove(it->key);
+                }
+            }
+        }
+    }
+
+    void reserve(u32 new_capacity) noexcept { _map.reserve(new_capacity); }
+    void clear() noexcept { _map.clear(); }
+    void free() noexcept { _map.free(); }
+    void set_allocator(Allocator* alloc) noexcept { _map.set_allocator(alloc); }
+
+    bool is_empty() const noexcept { return _map.is_empty(); }
+    constexpr u32 count() const noexcept { return _map.count(); }
+    constexpr u32 capacity() const noexcept { return _map.capacity(); }
+    HashMapStats stats() noexcept { return _map.stats(); }
+
+    Iterator begin() noexcept { return Iterator{_map.begin(), _map.end()}; }
+    Iterator end() noexcept { return Iterator{_map.end(), _map.end()}; }
+};
+
+} // sf
@@ -0,0 +1,623 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "general_purpose_allocator.hpp"
+#include "hashmap.hpp"
+#include "traits.hpp"
+#include "constants.hpp"
+#include "defines.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+namespace sf {
+
+// Open-addressing map which never rehashes everything at once.
+// Growth starts a bit before the load factor is hit: the new table is allocated and
+// zeroed ZERO_BUCKETS_PER_OP buckets at a time while the current one keeps taking inserts.
+// Once it is ready every following put/get/remove moves at most MIGRATE_BUCKETS_PER_OP
+// buckets out of the old table; until the old table is drained lookups consult both.
+// Each key lives in exactly one of the tables.
+template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, u32 DEFAULT_INIT_CAPACITY = 32, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>, u32 MIGRATE_BUCKETS_PER_OP = 16>
+struct IncrementalHashMap {
+public:
+    using KeyType = K;
+    using ValueType = V;
+
+    struct Bucket {
+        K   key;
+        V   value;
+        u64 hash;
+    };
+
+    union Data {
+        Bucket* ptr;
+        u32     handle;
+    };
+
+    struct Table {
+        Data data;
+        u32  capacity;
+        u32  count;
+        u32  tombstone_count;
+    };
+
+    // walks the table being drained first, then the current one
+    struct Iterator {
+    private:
+        Bucket* _bucket;
+        Bucket* _end;
+        Bucket* _next_bucket;
+        Bucket* _next_end;
+    public:
+        Iterator(Bucket* bucket, Bucket* end, Bucket* next_bucket, Bucket* next_end) noexcept
+            : _bucket{bucket}
+            , _end{end}
+            , _next_bucket{next_bucket}
+            , _next_end{next_end}
+        {
+            skip_free();
+        }
+
+        Bucket& operator*() const noexcept { return *_bucket; }
+        Bucket* operator->() const noexcept { return _bucket; }
+
+        Iterator& operator++() noexcept {
+            ++_bucket;
+            skip_free();
+            return *this;
+        }
+
+        friend bool operator==(const Iterator& first, const Iterator& second) noexcept {
+            return first._bucket == second._bucket;
+        }
+
+        friend bool operator!=(const Iterator& first, const Iterator& second) noexcept {
+            return first._bucket != second._bucket;
+        }
+    private:
+        void skip_free() noexcept {
+            while (true) {
+                while (_bucket != _end && _bucket->hash < FIRST_VALID_HASH) {
+                    ++_bucket;
+                }
+                if (_bucket != _end || _next_bucket == _next_end) {
+                    return;
+                }
+                _bucket = _next_bucket;
+                _end = _next_end;
+                _next_bucket = _next_end = nullptr;
+            }
+        }
+    };
+private:
+    Allocator*          _allocator;
+    Table               _table;
+    // table being drained, capacity 0 when no migration is in progress
+    Table               _old_table;
+    // next bucket of _old_table to migrate
+    u32                 _migrate_index;
+    // table being zeroed before it becomes current, capacity 0 when none
+    Table               _pending_table;
+    u32                 _zero_index;
+    HashMapConfig       _config;
+    [[no_unique_address]] Hasher   _hasher;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    static constexpr u64 FREE_HASH = 0;
+    static constexpr u64 TOMBSTONE_HASH = 1;
+    static constexpr u64 FIRST_VALID_HASH = 2;
+    static constexpr bool USE_HANDLE = Allocator::using_handle();
+    static constexpr u32 ZERO_BUCKETS_PER_OP = MIGRATE_BUCKETS_PER_OP * 8;
+    static_assert(MIGRATE_BUCKETS_PER_OP >= 2, "Migration should outpace inserts into the new table");
+
+    IncrementalHashMap(const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{get_current_gpa()}
+        , _table{empty_table()}
+        , _old_table{empty_table()}
+        , _migrate_index{0}
+        , _pending_table{empty_table()}
+        , _zero_index{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        _table = allocate_table(DEFAULT_INIT_CAPACITY);
+    }
+
+    IncrementalHashMap(Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _table{empty_table()}
+        , _old_table{empty_table()}
+        , _migrate_index{0}
+        , _pending_table{empty_table()}
+        , _zero_index{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        _table = allocate_table(DEFAULT_INIT_CAPACITY);
+    }
+
+    IncrementalHashMap(u32 prealloc_count, Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _table{empty_table()}
+        , _old_table{empty_table()}
+        , _migrate_index{0}
+        , _pending_table{empty_table()}
+        , _zero_index{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        _table = allocate_table(prealloc_count);
+    }
+
+    IncrementalHashMap(IncrementalHashMap&& rhs) noexcept
+        : _allocator{rhs._allocator}
+        , _table{rhs._table}
+        , _old_table{rhs._old_table}
+        , _migrate_index{rhs._migrate_index}
+        , _pending_table{rhs._pending_table}
+        , _zero_index{rhs._zero_index}
+        , _config{rhs._config}
+        , _hasher{rhs._hasher}
+        , _equal{rhs._equal}
+    {
+        rhs._table = empty_table();
+        rhs._old_table = empty_table();
+        rhs._migrate_index = 0;
+        rhs._pending_table = empty_table();
+        rhs._zero_index = 0;
+    }
+
+    IncrementalHashMap& operator=(IncrementalHashMap&& rhs) noexcept
+    {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        free();
+
+        _allocator = rhs._allocator;
+        _table = rhs._table;
+        _old_table = rhs._old_table;
+        _migrate_index = rhs._migrate_index;
+        _pending_table = rhs._pending_table;
+        _zero_index = rhs._zero_index;
+        _config = rhs._config;
+        _hasher = rhs._hasher;
+        _equal = rhs._equal;
+
+        rhs._table = empty_table();
+        rhs._old_table = empty_table();
+        rhs._migrate_index = 0;
+        rhs._pending_table = empty_table();
+        rhs._zero_index = 0;
+        return *this;
+    }
+
+    IncrementalHashMap(const IncrementalHashMap& rhs) = delete;
+    IncrementalHashMap& operator=(const IncrementalHashMap& rhs) = delete;
+
+    ~IncrementalHashMap() noexcept {
+        free();
+    }
+
+    void free() noexcept {
+        free_pending_table();
+        free_table(_old_table);
+        free_table(_table);
+        _migrate_index = 0;
+    }
+
+    void clear() noexcept {
+        free_pending_table();
+        free_table(_old_table);
+        _migrate_index = 0;
+
+        if (_table.capacity > 0) {
+            Bucket* data = access_data(_table);
+            destroy_buckets(data, _table.capacity);
+            sf_mem_zero(data, _table.capacity * sizeof(Bucket));
+            _table.count = 0;
+            _table.tombstone_count = 0;
+        }
+    }
+
+    void set_allocator(Allocator* alloc) noexcept {
+        SF_ASSERT_MSG(alloc, "Should be valid pointer");
+        _allocator = alloc;
+    }
+
+    // updates entry with the same key
+    template<typename Key, typename Val>
+    void put(Key&& key, Val&& val) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        rehash_step();
+
+        u64 hash = hash_inner(key);
+        if (is_rehashing()) {
+            // the key stays where it is, migration will move it later
+            Bucket* old_bucket = find_bucket(_old_table, key, hash);
+            if (old_bucket) {
+                old_bucket->value = std::forward<Val>(val);
+                return;
+            }
+        }
+
+        grow_if_needed();
+        Bucket* bucket = find_bucket_for_insert(_table, key, hash);
+        if (bucket->hash >= FIRST_VALID_HASH) {
+            bucket->value = std::forward<Val>(val);
+            return;
+        }
+        place_bucket(_table, bucket, std::forward<Key>(key), std::forward<Val>(val), hash);
+    }
+
+    // put without update
+    template<typename Key, typename Val>
+    bool put_if_empty(Key&& key, Val&& val) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        rehash_step();
+
+        u64 hash = hash_inner(key);
+        if (is_rehashing() && find_bucket(_old_table, key, hash)) {
+            return false;
+        }
+
+        grow_if_needed();
+        Bucket* bucket = find_bucket_for_insert(_table, key, hash);
+        if (bucket->hash >= FIRST_VALID_HASH) {
+            return false;
+        }
+        place_bucket(_table, bucket, std::forward<Key>(key), std::forward<Val>(val), hash);
+        return true;
+    }
+
+    V* get(ConstLRefOrValType<K> key) noexcept {
+        rehash_step();
+        Bucket* bucket = find_any_bucket(key, hash_inner(key));
+        if (!bucket) {
+            return nullptr;
+        }
+
+        return &bucket->value;
+    }
+
+    bool remove(ConstLRefOrValType<K> key) noexcept {
+        rehash_step();
+        u64 hash = hash_inner(key);
+
+        Table* table = &_table;
+        Bucket* bucket = find_bucket(_table, key, hash);
+        if (!bucket && is_rehashing()) {
+            table = &_old_table;
+            bucket = find_bucket(_old_table, key, hash);
+        }
+        if (!bucket) {
+            return false;
+        }
+
+        destroy_bucket(bucket);
+        bucket->hash = TOMBSTONE_HASH;
+        ++table->tombstone_count;
+        --table->count;
+
+        return true;
+    }
+
+    void reserve(u32 new_capacity) noexcept {
+        SF_ASSERT_MSG(_allocator, "Allocator should be set");
+        finish_rehash();
+        if (new_capacity > _table.capacity) {
+            _pending_table = allocate_table(new_capacity, false);
+            _zero_index = 0;
+            finish_rehash();
+        }
+    }
+
+    // completes a pending growth right away, e.g. before a latency-sensitive phase
+    void finish_rehash() noexcept {
+        if (_pending_table.capacity > 0) {
+            zero_buckets(_pending_table.capacity);
+        }
+        while (is_rehashing()) {
+            migrate_buckets(_old_table.capacity);
+        }
+    }
+
+    bool is_rehashing() const noexcept { return _old_table.capacity > 0; }
+    bool is_growth_pending() const noexcept { return _pending_table.capacity > 0; }
+    bool is_empty() const noexcept { return count() == 0; }
+
+    constexpr u32 count() const noexcept { return _table.count + _old_table.count; }
+    constexpr u32 size_in_bytes() const noexcept { return sizeof(Bucket) * count(); }
+    constexpr u32 capacity() const noexcept { return _table.capacity; }
+    constexpr u32 capacity_remain() const noexcept { return _table.capacity - count(); }
+
+    Iterator begin() noexcept {
+        Bucket* data = access_data(_table);
+        if (is_rehashing()) {
+            Bucket* old_data = access_data(_old_table);
+            return Iterator{old_data, old_data + _old_table.capacity, data, data + _table.capacity};
+        }
+        return Iterator{data, data + _table.capacity, nullptr, nullptr};
+    }
+
+    Iterator end() noexcept {
+        Bucket* data_end = access_data(_table) + _table.capacity;
+        return Iterator{data_end, data_end, nullptr, nullptr};
+    }
+private:
+    static constexpr Table empty_table() noexcept {
+        Table table{};
+        if constexpr (USE_HANDLE) {
+            table.data.handle = INVALID_ALLOC_HANDLE;
+        } else {
+            table.data.ptr = nullptr;
+        }
+        return table;
+    }
+
+    Bucket* access_data(const Table& table) const noexcept {
+        if constexpr (USE_HANDLE) {
+            if (table.data.handle == INVALID_ALLOC_HANDLE) {
+                return nullptr;
+            }
+            return static_cast<Bucket*>(_allocator->handle_to_ptr(table.data.handle));
+        } else {
+            return table.data.ptr;
+        }
+    }
+
+    Table allocate_table(u32 capacity, bool zero = true) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        Table table = empty_table();
+        table.capacity = next_power_of_2(capacity == 0 ? DEFAULT_INIT_CAPACITY : capacity);
+
+        if constexpr (USE_HANDLE) {
+            table.data.handle = _allocator->allocate_handle(table.capacity * sizeof(Bucket), alignof(Bucket));
+        } else {
+            table.data.ptr = static_cast<Bucket*>(_allocator->allocate(table.capacity * sizeof(Bucket), alignof(Bucket)));
+        }
+        if (zero) {
+            sf_mem_zero(access_data(table), table.capacity * sizeof(Bucket));
+        }
+
+        return table;
+    }
+
+    void free_table(Table& table) noexcept {
+        if (table.capacity == 0) {
+            return;
+        }
+
+        destroy_buckets(access_data(table), table.capacity);
+        if constexpr (USE_HANDLE) {
+            _allocator->free_handle(table.data.handle, alignof(Bucket));
+        } else {
+            _allocator->free(table.data.ptr, alignof(Bucket));
+        }
+        table = empty_table();
+    }
+
+    // pending table holds no entries, only has to be released
+    void free_pending_table() noexcept {
+        if (_pending_table.capacity == 0) {
+            return;
+        }
+
+        if constexpr (USE_HANDLE) {
+            _allocator->free_handle(_pending_table.data.handle, alignof(Bucket));
+        } else {
+            _allocator->free(_pending_table.data.ptr, alignof(Bucket));
+        }
+        _pending_table = empty_table();
+        _zero_index = 0;
+    }
+
+    void destroy_bucket(Bucket* bucket) noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K>) {
+            bucket->key.~K();
+        }
+        if constexpr (!std::is_trivially_destructible_v<V>) {
+            bucket->value.~V();
+        }
+    }
+
+    void destroy_buckets(Bucket* data, u32 capacity) noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K> || !std::is_trivially_destructible_v<V>) {
+            for (u32 i{0}; i < capacity; ++i) {
+                if (data[i].hash >= FIRST_VALID_HASH) {
+                    destroy_bucket(data + i);
+                }
+            }
+        }
+    }
+
+    void grow_if_needed() noexcept {
+        if (_table.capacity == 0) {
+            _table = allocate_table(DEFAULT_INIT_CAPACITY);
+            return;
+        }
+
+        // entries still waiting in the old table will land here too
+        u32 used = count() + _table.tombstone_count;
+        u32 max_load = static_cast<u32>(_table.capacity * _config.load_factor);
+
+        if (_pending_table.capacity > 0) {
+            // zeroing fell behind, finish it to stay correct
+            if (used >= max_load) {
+                finish_rehash();
+                grow_if_needed();
+            }
+            return;
+        }
+
+        u32 new_capacity = _table.tombstone_count > _table.count
+            ? _table.capacity
+            : static_cast<u32>(_table.capacity * _config.grow_factor);
+        // start early enough for the new table to be zeroed before this one is full
+        u32 headroom = new_capacity / ZERO_BUCKETS_PER_OP + 1;
+        if (used + headroom < max_load) {
+            return;
+        }
+
+        // migration fell behind (e.g. a low load factor), drain it to stay correct
+        finish_rehash();
+
+        _pending_table = allocate_table(new_capacity, false);
+        _zero_index = 0;
+        if (used >= max_load) {
+            finish_rehash();
+        }
+    }
+
+    void rehash_step() noexcept {
+        if (_pending_table.capacity > 0) {
+            zero_buckets(ZERO_BUCKETS_PER_OP);
+        } else if (is_rehashing()) {
+            migrate_buckets(MIGRATE_BUCKETS_PER_OP);
+        }
+    }
+
+    void zero_buckets(u32 bucket_count) noexcept {
+        u32 end = std::min(_zero_index + bucket_count, _pending_table.capacity);
+        sf_mem_zero(access_data(_pending_table) + _zero_index, (end - _zero_index) * sizeof(Bucket));
+        _zero_index = end;
+
+        if (_zero_index == _pending_table.capacity) {
+            start_rehash();
+        }
+    }
+
+    void start_rehash() noexcept {
+        SF_ASSERT_MSG(!is_rehashing(), "Previous migration should be finished");
+        _old_table = _table;
+        _table = _pending_table;
+        _pending_table = empty_table();
+        _zero_index = 0;
+        _migrate_index = 0;
+
+        if (_old_table.count == 0) {
+            free_table(_old_table);
+        }
+    }
+
+    void migrate_buckets(u32 bucket_count) noexcept {
+        Bucket* old_data = access_data(_old_table);
+        Bucket* new_data = access_data(_table);
+        u32 end = std::min(_migrate_index + bucket_count, _old_table.capacity);
+
+        for (; _migrate_index < end; ++_migrate_index) {
+            Bucket* bucket = old_data + _migrate_index;
+            if (bucket->hash < FIRST_VALID_HASH) {
+                continue;
+            }
+
+            Bucket* target = find_free_bucket(new_data, _table.capacity, bucket->hash);
+            if (target->hash == TOMBSTONE_HASH) {
+                --_table.tombstone_count;
+            }
+            ::new (target) Bucket{ .key = std::move(bucket->key), .value = std::move(bucket->value), .hash = bucket->hash };
+            ++_table.count;
+
+            destroy_bucket(bucket);
+            // keeps probe chains of the old table intact for keys not yet migrated
+            bucket->hash = TOMBSTONE_HASH;
+            --_old_table.count;
+        }
+
+        if (_migrate_index == _old_table.capacity || _old_table.count == 0) {
+            free_table(_old_table);
+            _migrate_index = 0;
+        }
+    }
+
+    Bucket* find_any_bucket(ConstLRefOrValType<K> key, u64 hash) noexcept {
+        Bucket* bucket = find_bucket(_table, key, hash);
+        if (!bucket && is_rehashing()) {
+            bucket = find_bucket(_old_table, key, hash);
+        }
+        return bucket;
+    }
+
+    Bucket* find_bucket(const Table& table, ConstLRefOrValType<K> key, u64 hash) const noexcept {
+        if (table.capacity == 0) {
+            return nullptr;
+        }
+
+        Bucket* data = access_data(table);
+        u32 mask = table.capacity - 1;
+        u32 index = static_cast<u32>(hash) & mask;
+
+        for (u32 n{0}; n < table.capacity; ++n) {
+            Bucket* bucket = data + ((index + n) & mask);
+            if (bucket->hash == FREE_HASH) {
+                return nullptr;
+            }
+            if (bucket->hash == hash && _equal(key, bucket->key)) {
+                return bucket;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // returns the bucket holding the key, or the first reusable bucket on its probe chain
+    Bucket* find_bucket_for_insert(const Table& table, ConstLRefOrValType<K> key, u64 hash) noexcept {
+        Bucket* data = access_data(table);
+        u32 mask = table.capacity - 1;
+        u32 index = static_cast<u32>(hash) & mask;
+        Bucket* first_tombstone = nullptr;
+
+        for (u32 n{0}; n < table.capacity; ++n) {
+            Bucket* bucket = data + ((index + n) & mask);
+            if (bucket->hash == FREE_HASH) {
+                return first_tombstone ? first_tombstone : bucket;
+            }
+            if (bucket->hash == TOMBSTONE_HASH) {
+                if (!first_tombstone) {
+                    first_tombstone = bucket;
+                }
+            } else if (bucket->hash == hash && _equal(key, bucket->key)) {
+                return bucket;
+            }
+        }
+
+        SF_ASSERT_MSG(first_tombstone, "Should have empty space");
+        return first_tombstone;
+    }
+
+    // key is known to be absent from the table
+    Bucket* find_free_bucket(Bucket* data, u32 capacity, u64 hash) noexcept {
+        u32 mask = capacity - 1;
+        u32 index = static_cast<u32>(hash) & mask;
+
+        while (data[index].hash >= FIRST_VALID_HASH) {
+            index = (index + 1) & mask;
+        }
+        return data + index;
+    }
+
+    template<typename Key, typename Val>
+    void place_bucket(Table& table, Bucket* bucket, Key&& key, Val&& val, u64 hash) noexcept {
+        if (bucket->hash == TOMBSTONE_HASH) {
+            --table.tombstone_count;
+        }
+        ::new (bucket) Bucket{ .key = std::forward<Key>(key), .value = std::forward<Val>(val), .hash = hash };
+        ++table.count;
+    }
+
+    u64 hash_inner(ConstLRefOrValType<K> key) const noexcept {
+        return std::max(_hasher(key), FIRST_VALID_HASH);
+    }
+};
+
+} // sf
@@ -5,6 +5,8 @@
 #include "result.hpp"
 #include "traits.hpp"
 #include <fstream>
+#include <initializer_list>
+#include <span>
 #include <string_view>
 
 namespace sf {
@@ -46,6 +48,17 @@ FixedString<ARR_LEN>& strip_extension_from_file_name(FixedString<ARR_LEN>& file_
     return file_name;
 }
 
+// read-only view of a whole file, pages are loaded by the OS on first touch
+struct MappedFile {
+    const u8* data;
+    usize     size;
+};
+
+Result<MappedFile> map_file_read_only(std::string_view file_path) noexcept;
+void unmap_file(MappedFile& file) noexcept;
+// writes the parts one after another, replacing the file
+bool write_file(std::string_view file_path, std::initializer_list<std::span<const u8>> parts) noexcept;
+
 std::string_view extract_extension_from_file_name(std::string_view file_name);
 std::string_view strip_extension_from_file_name(std::string_view file_name);
 std::string_view strip_file_name_from_path(std::string_view file_path);
@@ -5,17 +5,33 @@
 
 namespace sf {
 
+// Size of the address range a LinearAllocator reserves instead of allocating from the heap.
+struct VirtualReserve {
+    usize size;
+};
+
+// Bump allocator. By default the buffer comes from the heap and moves when it grows, so
+// only handles stay valid. Made with VirtualReserve it reserves the whole range up front and
+// commits pages as the count grows: the buffer never moves, raw pointers stay valid and growth
+// costs page faults instead of a copy, up to the reserved size.
 struct LinearAllocator {
 public:
 static constexpr usize DEFAULT_INIT_CAPACITY{1024};
+// smallest step of committed memory in the reserve mode
+static constexpr usize COMMIT_GRANULARITY{64 * 1024};
 private:
+    // committed bytes in the reserve mode
     usize _capacity;
     usize _count;
     u8*   _buffer;
+    // zero for heap buffers
+    usize _reserved;
 
 public:
     LinearAllocator() noexcept;
     LinearAllocator(usize capacity) noexcept;
+    // rounded up to whole pages, nothing is committed until the first allocation
+    explicit LinearAllocator(VirtualReserve reserve) noexcept;
     LinearAllocator(LinearAllocator&& rhs) noexcept;
     LinearAllocator& operator=(LinearAllocator&& rhs) noexcept;
     ~LinearAllocator() noexcept;
@@ -35,6 +51,8 @@ public:
     constexpr u8* end() noexcept { return _buffer + _count; }
     constexpr usize count() const noexcept { return _count; }
     constexpr usize capacity() const noexcept { return _capacity; }
+    constexpr usize reserved() const noexcept { return _reserved; }
+    constexpr bool is_reserved() const noexcept { return _reserved > 0; }
     // const counterparts
     const u8* begin() const noexcept { return _buffer; }
     const u8* data() const noexcept { return _buffer; }
@@ -43,6 +61,8 @@ public:
 
 private:
     void resize(usize new_capacity) noexcept;
+    void commit(usize min_capacity) noexcept;
+    void release() noexcept;
 };
 
 } // sf
@@ -0,0 +1,737 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "general_purpose_allocator.hpp"
+#include "hashmap.hpp"
+#include "traits.hpp"
+#include "constants.hpp"
+#include "defines.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <algorithm>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sf {
+
+// Shared by LruCache and ClockCache: fixed node array plus an open addressing index of
+// (hash, node) slots, both in one block allocated up front. The index is kept under half
+// full and deletes shift later slots back instead of leaving tombstones, so constant
+// eviction churn never degrades probing.
+// HashMap is not reused for the index on purpose: a full cache removes an entry on every
+// miss, and HashMap's tombstones would pile up until a rehash allocates, while a cache never
+// allocates after construction. HashMap also stores the key in its buckets, the key would be
+// kept twice since eviction needs it in the node; a slot here is 8 bytes whatever K is.
+namespace cache {
+
+struct Slot {
+    u32 hash;
+    u32 node;
+};
+
+inline constexpr u32 EMPTY_HASH = 0;
+inline constexpr u32 INVALID_NODE = UINT32_MAX;
+
+inline u32 slot_count_for(u32 capacity) noexcept {
+    return next_power_of_2(std::max(capacity * 2, 8u));
+}
+
+inline u32 fold_hash(u64 hash) noexcept {
+    return std::max(static_cast<u32>(hash ^ (hash >> 32)), 1u);
+}
+
+// key is known to be missing
+inline void insert_slot(Slot* slots, u32 mask, u32 hash, u32 node) noexcept {
+    u32 index = hash & mask;
+    while (slots[index].hash != EMPTY_HASH) {
+        index = (index + 1) & mask;
+    }
+    slots[index] = Slot{ .hash = hash, .node = node };
+}
+
+// slot pointing at 'node', found without comparing keys
+inline u32 find_node_slot(const Slot* slots, u32 mask, u32 hash, u32 node) noexcept {
+    u32 index = hash & mask;
+    while (slots[index].node != node || slots[index].hash != hash) {
+        SF_ASSERT_MSG(slots[index].hash != EMPTY_HASH, "Node should be indexed");
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+// backward shift: slots after the hole move into it unless that would put them before their home
+inline void erase_slot(Slot* slots, u32 mask, u32 index) noexcept {
+    u32 hole = index;
+    for (u32 next = (index + 1) & mask; slots[next].hash != EMPTY_HASH; next = (next + 1) & mask) {
+        u32 home = slots[next].hash & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            slots[hole] = slots[next];
+            hole = next;
+        }
+    }
+    slots[hole].hash = EMPTY_HASH;
+}
+
+} // cache
+
+// called with the entry about to be dropped by a full cache, not for 'remove' or 'clear'
+template<typename K, typename V>
+using EvictCallback = void (*)(const K& key, V& value, void* user_data);
+
+// Least recently used cache of fixed capacity. Recency links live inside the nodes,
+// so a hit is one index probe plus relinking and eviction of the list tail is O(1).
+template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct LruCache {
+public:
+    using KeyType = K;
+    using ValueType = V;
+    using Slot = cache::Slot;
+
+    struct Node {
+        K   key;
+        V   value;
+        u32 hash;
+        // towards most recent, towards least recent; free nodes chain through 'next'
+        u32 prev;
+        u32 next;
+    };
+
+    union Data {
+        u8* ptr;
+        u32 handle;
+    };
+private:
+    // nodes followed by the index slots, in one allocation
+    Allocator*          _allocator;
+    Data                _data;
+    u32                 _capacity;
+    u32                 _slot_count;
+    u32                 _count;
+    u32                 _head;
+    u32                 _tail;
+    u32                 _free_head;
+    EvictCallback<K, V> _on_evict;
+    void*               _evict_user_data;
+    [[no_unique_address]] Hasher   _hasher;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    static constexpr bool USE_HANDLE = Allocator::using_handle();
+
+    explicit LruCache(u32 capacity, Hasher hasher = {}, KeyEqual equal = {})
+        : LruCache(capacity, get_current_gpa(), hasher, equal)
+    {}
+
+    LruCache(u32 capacity, Allocator* allocator, Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _capacity{capacity}
+        , _slot_count{cache::slot_count_for(capacity)}
+        , _count{0}
+        , _head{cache::INVALID_NODE}
+        , _tail{cache::INVALID_NODE}
+        , _free_head{cache::INVALID_NODE}
+        , _on_evict{nullptr}
+        , _evict_user_data{nullptr}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT_MSG(allocator, "Should be valid pointer");
+        SF_ASSERT_MSG(capacity > 0, "Cache should hold at least one entry");
+        if constexpr (USE_HANDLE) {
+            _data.handle = _allocator->allocate_handle(block_size(), alignof(Node));
+        } else {
+            _data.ptr = static_cast<u8*>(_allocator->allocate(block_size(), alignof(Node)));
+        }
+        reset_links();
+    }
+
+    LruCache(LruCache&& rhs) noexcept
+        : _allocator{rhs._allocator}
+        , _data{rhs._data}
+        , _capacity{rhs._capacity}
+        , _slot_count{rhs._slot_count}
+        , _count{rhs._count}
+        , _head{rhs._head}
+        , _tail{rhs._tail}
+        , _free_head{rhs._free_head}
+        , _on_evict{rhs._on_evict}
+        , _evict_user_data{rhs._evict_user_data}
+        , _hasher{rhs._hasher}
+        , _equal{rhs._equal}
+    {
+        rhs.reset_empty();
+    }
+
+    LruCache& operator=(LruCache&& rhs) noexcept {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        free();
+        _allocator = rhs._allocator;
+        _data = rhs._data;
+        _capacity = rhs._capacity;
+        _slot_count = rhs._slot_count;
+        _count = rhs._count;
+        _head = rhs._head;
+        _tail = rhs._tail;
+        _free_head = rhs._free_head;
+        _on_evict = rhs._on_evict;
+        _evict_user_data = rhs._evict_user_data;
+        _hasher = rhs._hasher;
+        _equal = rhs._equal;
+
+        rhs.reset_empty();
+        return *this;
+    }
+
+    LruCache(const LruCache& rhs) = delete;
+    LruCache& operator=(const LruCache& rhs) = delete;
+
+    ~LruCache() noexcept {
+        free();
+    }
+
+    void free() noexcept {
+        if (_capacity == 0) {
+            return;
+        }
+
+        destroy_entries();
+        if constexpr (USE_HANDLE) {
+            _allocator->free_handle(_data.handle, alignof(Node));
+        } else {
+            _allocator->free(_data.ptr, alignof(Node));
+        }
+        reset_empty();
+    }
+
+    // drops every entry without calling the eviction callback
+    void clear() noexcept {
+        if (_capacity == 0) {
+            return;
+        }
+
+        destroy_entries();
+        reset_links();
+    }
+
+    void set_eviction_callback(EvictCallback<K, V> callback, void* user_data = nullptr) noexcept {
+        _on_evict = callback;
+        _evict_user_data = user_data;
+    }
+
+    // marks the entry most recently used
+    V* get(ConstLRefOrValType<K> key) noexcept {
+        u32 node = find_node(key, cache::fold_hash(_hasher(key)));
+        if (node == cache::INVALID_NODE) {
+            return nullptr;
+        }
+
+        move_to_front(node);
+        return &nodes()[node].value;
+    }
+
+    // lookup without touching recency
+    V* peek(ConstLRefOrValType<K> key) noexcept {
+        u32 node = find_node(key, cache::fold_hash(_hasher(key)));
+        return node == cache::INVALID_NODE ? nullptr : &nodes()[node].value;
+    }
+
+    // updates entry with the same key; a full cache evicts its least recently used entry
+    template<typename Key, typename Val>
+    void put(Key&& key, Val&& val) noexcept {
+        SF_ASSERT_MSG(_capacity > 0, "Cache is freed");
+        u32 hash = cache::fold_hash(_hasher(key));
+        u32 node = find_node(key, hash);
+        if (node != cache::INVALID_NODE) {
+            nodes()[node].value = std::forward<Val>(val);
+            move_to_front(node);
+            return;
+        }
+
+        if (_count == _capacity) {
+            evict(_tail);
+        }
+
+        node = _free_head;
+        Node& new_node = nodes()[node];
+        _free_head = new_node.next;
+        ::new (&new_node.key) K(std::forward<Key>(key));
+        ::new (&new_node.value) V(std::forward<Val>(val));
+        new_node.hash = hash;
+        link_front(node);
+        cache::insert_slot(slots(), _slot_count - 1, hash, node);
+        ++_count;
+    }
+
+    bool remove(ConstLRefOrValType<K> key) noexcept {
+        u32 node = find_node(key, cache::fold_hash(_hasher(key)));
+        if (node == cache::INVALID_NODE) {
+            return false;
+        }
+
+        drop(node);
+        return true;
+    }
+
+    // calls 'fn(const K&, V&)' from most to least recently used
+    template<typename F>
+    void for_each(F&& fn) noexcept {
+        Node* n = nodes();
+        for (u32 node{_head}; node != cache::INVALID_NODE; node = n[node].next) {
+            fn(static_cast<const K&>(n[node].key), n[node].value);
+        }
+    }
+
+    bool is_empty() const noexcept { return _count == 0; }
+    bool is_full() const noexcept { return _count == _capacity; }
+    constexpr u32 count() const noexcept { return _count; }
+    constexpr u32 capacity() const noexcept { return _capacity; }
+private:
+    usize nodes_size() const noexcept {
+        return static_cast<usize>(_capacity) * sizeof(Node);
+    }
+
+    usize block_size() const noexcept {
+        return nodes_size() + static_cast<usize>(_slot_count) * sizeof(Slot);
+    }
+
+    u8* access_data() const noexcept {
+        if constexpr (USE_HANDLE) {
+            return static_cast<u8*>(_allocator->handle_to_ptr(_data.handle));
+        } else {
+            return _data.ptr;
+        }
+    }
+
+    Node* nodes() const noexcept { return reinterpret_cast<Node*>(access_data()); }
+    Slot* slots() const noexcept { return reinterpret_cast<Slot*>(access_data() + nodes_size()); }
+
+    void reset_empty() noexcept {
+        if constexpr (USE_HANDLE) {
+            _data.handle = INVALID_ALLOC_HANDLE;
+        } else {
+            _data.ptr = nullptr;
+        }
+        _capacity = 0;
+        _slot_count = 0;
+        _count = 0;
+        _head = cache::INVALID_NODE;
+        _tail = cache::INVALID_NODE;
+        _free_head = cache::INVALID_NODE;
+    }
+
+    // every node on the free list, index empty
+    void reset_links() noexcept {
+        Node* n = nodes();
+        for (u32 i{0}; i < _capacity; ++i) {
+            n[i].next = i + 1 < _capacity ? i + 1 : cache::INVALID_NODE;
+        }
+        sf_mem_zero(slots(), _slot_count * sizeof(Slot));
+        _free_head = 0;
+        _head = cache::INVALID_NODE;
+        _tail = cache::INVALID_NODE;
+        _count = 0;
+    }
+
+    void destroy_node(Node& node) noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K>) {
+            node.key.~K();
+        }
+        if constexpr (!std::is_trivially_destructible_v<V>) {
+            node.value.~V();
+        }
+    }
+
+    void destroy_entries() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K> || !std::is_trivially_destructible_v<V>) {
+            Node* n = nodes();
+            for (u32 node{_head}; node != cache::INVALID_NODE; node = n[node].next) {
+                destroy_node(n[node]);
+            }
+        }
+    }
+
+    u32 find_node(ConstLRefOrValType<K> key, u32 hash) const noexcept {
+        if (_count == 0) {
+            return cache::INVALID_NODE;
+        }
+
+        const Slot* s = slots();
+        const Node* n = nodes();
+        u32 mask = _slot_count - 1;
+        for (u32 index = hash & mask; s[index].hash != cache::EMPTY_HASH; index = (index + 1) & mask) {
+            if (s[index].hash == hash && _equal(key, n[s[index].node].key)) {
+                return s[index].node;
+            }
+        }
+        return cache::INVALID_NODE;
+    }
+
+    void link_front(u32 node) noexcept {
+        Node* n = nodes();
+        n[node].prev = cache::INVALID_NODE;
+        n[node].next = _head;
+        if (_head != cache::INVALID_NODE) {
+            n[_head].prev = node;
+        } else {
+            _tail = node;
+        }
+        _head = node;
+    }
+
+    void unlink(u32 node) noexcept {
+        Node* n = nodes();
+        if (n[node].prev != cache::INVALID_NODE) {
+            n[n[node].prev].next = n[node].next;
+        } else {
+            _head = n[node].next;
+        }
+        if (n[node].next != cache::INVALID_NODE) {
+            n[n[node].next].prev = n[node].prev;
+        } else {
+            _tail = n[node].prev;
+        }
+    }
+
+    void move_to_front(u32 node) noexcept {
+        if (node != _head) {
+            unlink(node);
+            link_front(node);
+        }
+    }
+
+    void evict(u32 node) noexcept {
+        if (_on_evict) {
+            Node& victim = nodes()[node];
+            _on_evict(victim.key, victim.value, _evict_user_data);
+        }
+        drop(node);
+    }
+
+    void drop(u32 node) noexcept {
+        Node& victim = nodes()[node];
+        u32 mask = _slot_count - 1;
+        cache::erase_slot(slots(), mask, cache::find_node_slot(slots(), mask, victim.hash, node));
+        unlink(node);
+        destroy_node(victim);
+        victim.next = _free_head;
+        _free_head = node;
+        --_count;
+    }
+};
+
+// CLOCK (second chance) approximation of LRU: a hit only sets the node's reference bit,
+// no links are touched. Eviction sweeps a hand over the nodes, clearing set bits and
+// taking the first node without one.
+template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct ClockCache {
+public:
+    using KeyType = K;
+    using ValueType = V;
+    using Slot = cache::Slot;
+
+    struct Node {
+        K    key;
+        V    value;
+        u32  hash;
+        bool referenced;
+        bool occupied;
+    };
+
+    union Data {
+        u8* ptr;
+        u32 handle;
+    };
+private:
+    // nodes followed by the index slots, in one allocation
+    Allocator*          _allocator;
+    Data                _data;
+    u32                 _capacity;
+    u32                 _slot_count;
+    u32                 _count;
+    u32                 _hand;
+    EvictCallback<K, V> _on_evict;
+    void*               _evict_user_data;
+    [[no_unique_address]] Hasher   _hasher;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    static constexpr bool USE_HANDLE = Allocator::using_handle();
+
+    explicit ClockCache(u32 capacity, Hasher hasher = {}, KeyEqual equal = {})
+        : ClockCache(capacity, get_current_gpa(), hasher, equal)
+    {}
+
+    ClockCache(u32 capacity, Allocator* allocator, Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _capacity{capacity}
+        , _slot_count{cache::slot_count_for(capacity)}
+        , _count{0}
+        , _hand{0}
+        , _on_evict{nullptr}
+        , _evict_user_data{nullptr}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT_MSG(allocator, "Should be valid pointer");
+        SF_ASSERT_MSG(capacity > 0, "Cache should hold at least one entry");
+        if constexpr (USE_HANDLE) {
+            _data.handle = _allocator->allocate_handle(block_size(), alignof(Node));
+        } else {
+            _data.ptr = static_cast<u8*>(_allocator->allocate(block_size(), alignof(Node)));
+        }
+        reset_nodes();
+    }
+
+    ClockCache(ClockCache&& rhs) noexcept
+        : _allocator{rhs._allocator}
+        , _data{rhs._data}
+        , _capacity{rhs._capacity}
+        , _slot_count{rhs._slot_count}
+        , _count{rhs._count}
+        , _hand{rhs._hand}
+        , _on_evict{rhs._on_evict}
+        , _evict_user_data{rhs._evict_user_data}
+        , _hasher{rhs._hasher}
+        , _equal{rhs._equal}
+    {
+        rhs.reset_empty();
+    }
+
+    ClockCache& operator=(ClockCache&& rhs) noexcept {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        free();
+        _allocator = rhs._allocator;
+        _data = rhs._data;
+        _capacity = rhs._capacity;
+        _slot_count = rhs._slot_count;
+        _count = rhs._count;
+        _hand = rhs._hand;
+        _on_evict = rhs._on_evict;
+        _evict_user_data = rhs._evict_user_data;
+        _hasher = rhs._hasher;
+        _equal = rhs._equal;
+
+        rhs.reset_empty();
+        return *this;
+    }
+
+    ClockCache(const ClockCache& rhs) = delete;
+    ClockCache& operator=(const ClockCache& rhs) = delete;
+
+    ~ClockCache() noexcept {
+        free();
+    }
+
+    void free() noexcept {
+        if (_capacity == 0) {
+            return;
+        }
+
+        destroy_entries();
+        if constexpr (USE_HANDLE) {
+            _allocator->free_handle(_data.handle, alignof(Node));
+        } else {
+            _allocator->free(_data.ptr, alignof(Node));
+        }
+        reset_empty();
+    }
+
+    // drops every entry without calling the eviction callback
+    void clear() noexcept {
+        if (_capacity == 0) {
+            return;
+        }
+
+        destroy_entries();
+        reset_nodes();
+    }
+
+    void set_eviction_callback(EvictCallback<K, V> callback, void* user_data = nullptr) noexcept {
+        _on_evict = callback;
+        _evict_user_data = user_data;
+    }
+
+    // gives the entry a second chance at the next sweep
+    V* get(ConstLRefOrValType<K> key) noexcept {
+        u32 node = find_node(key, cache::fold_hash(_hasher(key)));
+        if (node == cache::INVALID_NODE) {
+            return nullptr;
+        }
+
+        Node& found = nodes()[node];
+        found.referenced = true;
+        return &found.value;
+    }
+
+    V* peek(ConstLRefOrValType<K> key) noexcept {
+        u32 node = find_node(key, cache::fold_hash(_hasher(key)));
+        return node == cache::INVALID_NODE ? nullptr : &nodes()[node].value;
+    }
+
+    // updates entry with the same key; a full cache evicts the entry under the hand
+    template<typename Key, typename Val>
+    void put(Key&& key, Val&& val) noexcept {
+        SF_ASSERT_MSG(_capacity > 0, "Cache is freed");
+        u32 hash = cache::fold_hash(_hasher(key));
+        u32 node = find_node(key, hash);
+        if (node != cache::INVALID_NODE) {
+            Node& found = nodes()[node];
+            found.value = std::forward<Val>(val);
+            found.referenced = true;
+            return;
+        }
+
+        node = _count == _capacity ? evict() : find_free_node();
+        Node& new_node = nodes()[node];
+        ::new (&new_node.key) K(std::forward<Key>(key));
+        ::new (&new_node.value) V(std::forward<Val>(val));
+        new_node.hash = hash;
+        new_node.referenced = false;
+        new_node.occupied = true;
+        cache::insert_slot(slots(), _slot_count - 1, hash, node);
+        ++_count;
+    }
+
+    bool remove(ConstLRefOrValType<K> key) noexcept {
+        u32 node = find_node(key, cache::fold_hash(_hasher(key)));
+        if (node == cache::INVALID_NODE) {
+            return false;
+        }
+
+        drop(node);
+        return true;
+    }
+
+    // calls 'fn(const K&, V&)' for every entry, in node order
+    template<typename F>
+    void for_each(F&& fn) noexcept {
+        Node* n = nodes();
+        for (u32 i{0}; i < _capacity; ++i) {
+            if (n[i].occupied) {
+                fn(static_cast<const K&>(n[i].key), n[i].value);
+            }
+        }
+    }
+
+    bool is_empty() const noexcept { return _count == 0; }
+    bool is_full() const noexcept { return _count == _capacity; }
+    constexpr u32 count() const noexcept { return _count; }
+    constexpr u32 capacity() const noexcept { return _capacity; }
+private:
+    usize nodes_size() const noexcept {
+        return static_cast<usize>(_capacity) * sizeof(Node);
+    }
+
+    usize block_size() const noexcept {
+        return nodes_size() + static_cast<usize>(_slot_count) * sizeof(Slot);
+    }
+
+    u8* access_data() const noexcept {
+        if constexpr (USE_HANDLE) {
+            return static_cast<u8*>(_allocator->handle_to_ptr(_data.handle));
+        } else {
+            return _data.ptr;
+        }
+    }
+
+    Node* nodes() const noexcept { return reinterpret_cast<Node*>(access_data()); }
+    Slot* slots() const noexcept { return reinterpret_cast<Slot*>(access_data() + nodes_size()); }
+
+    void reset_empty() noexcept {
+        if constexpr (USE_HANDLE) {
+            _data.handle = INVALID_ALLOC_HANDLE;
+        } else {
+            _data.ptr = nullptr;
+        }
+        _capacity = 0;
+        _slot_count = 0;
+        _count = 0;
+        _hand = 0;
+    }
+
+    void reset_nodes() noexcept {
+        Node* n = nodes();
+        for (u32 i{0}; i < _capacity; ++i) {
+            n[i].occupied = false;
+        }
+        sf_mem_zero(slots(), _slot_count * sizeof(Slot));
+        _count = 0;
+        _hand = 0;
+    }
+
+    void destroy_node(Node& node) noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K>) {
+            node.key.~K();
+        }
+        if constexpr (!std::is_trivially_destructible_v<V>) {
+            node.value.~V();
+        }
+        node.occupied = false;
+    }
+
+    void destroy_entries() noexcept {
+        Node* n = nodes();
+        for (u32 i{0}; i < _capacity; ++i) {
+            if (n[i].occupied) {
+                destroy_node(n[i]);
+            }
+        }
+    }
+
+    u32 find_node(ConstLRefOrValType<K> key, u32 hash) const noexcept {
+        if (_count == 0) {
+            return cache::INVALID_NODE;
+        }
+
+        const Slot* s = slots();
+        const Node* n = nodes();
+        u32 mask = _slot_count - 1;
+        for (u32 index = hash & mask; s[index].hash != cache::EMPTY_HASH; index = (index + 1) & mask) {
+            if (s[index].hash == hash && _equal(key, n[s[index].node].key)) {
+                return s[index].node;
+            }
+        }
+        return cache::INVALID_NODE;
+    }
+
+    // nodes fill up from the hand onwards, only 'remove' leaves holes behind it
+    u32 find_free_node() noexcept {
+        Node* n = nodes();
+        while (n[_hand].occupied) {
+            _hand = _hand + 1 == _capacity ? 0 : _hand + 1;
+        }
+        return _hand;
+    }
+
+    // second chance sweep, ends within two turns of the hand
+    u32 evict() noexcept {
+        Node* n = nodes();
+        while (n[_hand].referenced) {
+            n[_hand].referenced = false;
+            _hand = _hand + 1 == _capacity ? 0 : _hand + 1;
+        }
+
+        u32 victim = _hand;
+        if (_on_evict) {
+            _on_evict(n[victim].key, n[victim].value, _evict_user_data);
+        }
+        drop(victim);
+        _hand = _hand + 1 == _capacity ? 0 : _hand + 1;
+        return victim;
+    }
+
+    void drop(u32 node) noexcept {
+        Node& victim = nodes()[node];
+        u32 mask = _slot_count - 1;
+        cache::erase_slot(slots(), mask, cache::find_node_slot(slots(), mask, victim.hash, node));
+        destroy_node(victim);
+        --_count;
+    }
+};
+
+} // sf
@@ -3,6 +3,10 @@
 #include <new>
 #include <utility>
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <xmmintrin.h>
+#endif
+
 namespace sf {
 
 void* sf_mem_alloc(usize byte_size, u16 alignment = 0, bool zero = false);
@@ -15,6 +19,13 @@ void  sf_mem_move(void* dest, void* src, usize byte_size);
 bool  sf_mem_cmp(void* first, void* second, usize byte_size);
 bool  sf_str_cmp(const char* first, const char* second);
 
+// address space without backing memory: reserve gives a page aligned range nothing can touch,
+// commit makes part of it readable and writable, decommit hands the pages back but keeps the range
+void* sf_mem_reserve(usize byte_size);
+bool  sf_mem_commit(void* addr, usize byte_size);
+void  sf_mem_decommit(void* addr, usize byte_size);
+void  sf_mem_release(void* addr, usize byte_size);
+
 u32 sf_calc_padding(void* address, u16 alignment);
 bool is_address_in_range(void* start, u32 total_size, void* addr);
 bool is_handle_in_range(void* start, u32 total_size, u32 handle);
@@ -48,6 +59,15 @@ constexpr T* sf_align_forward(T* address, u16 alignment) noexcept {
     return reinterpret_cast<T*>((addr + (alignment - 1)) & ~(alignment - 1));
 }
 
+// hint to pull a cache line in ahead of use, never faults
+inline void sf_mem_prefetch(const void* address) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    __builtin_prefetch(address);
+#endif
+}
+
 // templated versions of memory functions
 template<typename T, bool should_align>
 T* sf_mem_alloc_typed(usize count) {
@@ -0,0 +1,444 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "general_purpose_allocator.hpp"
+#include "dynamic_array.hpp"
+#include "hashmap.hpp"
+#include "traits.hpp"
+#include "constants.hpp"
+#include "defines.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+namespace sf {
+
+// Entries live densely in a DynamicArray in insertion order, the hash table holds only
+// 8-byte slots (32-bit hash and entry index). Iteration is a linear scan in insertion
+// order, independent of the table capacity. Removed entries stay in the array marked
+// dead until the next rebuild compacts them, so removal keeps the order of the rest.
+template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, u32 DEFAULT_INIT_CAPACITY = 32, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct OrderedHashMap {
+public:
+    using KeyType = K;
+    using ValueType = V;
+
+    struct Entry {
+        K   key;
+        V   value;
+        // TOMBSTONE_HASH marks a removed entry
+        u32 hash;
+    };
+
+    struct Slot {
+        u32 hash;
+        u32 index;
+    };
+
+    union Data {
+        Slot* ptr;
+        u32   handle;
+    };
+
+    struct Iterator {
+    private:
+        Entry* _entries;
+        u32    _index;
+        u32    _count;
+    public:
+        Iterator(Entry* entries, u32 index, u32 count) noexcept
+            : _entries{entries}
+            , _index{index}
+            , _count{count}
+        {
+            skip_dead();
+        }
+
+        Entry& operator*() noexcept { return _entries[_index]; }
+        Entry* operator->() noexcept { return _entries + _index; }
+
+        Iterator& operator++() noexcept {
+            ++_index;
+            skip_dead();
+            return *this;
+        }
+
+        friend bool operator==(const Iterator& first, const Iterator& second) noexcept {
+            return first._index == second._index;
+        }
+
+        friend bool operator!=(const Iterator& first, const Iterator& second) noexcept {
+            return first._index != second._index;
+        }
+    private:
+        void skip_dead() noexcept {
+            while (_index < _count && _entries[_index].hash < FIRST_VALID_HASH) {
+                ++_index;
+            }
+        }
+    };
+private:
+    Allocator*                     _allocator;
+    DynamicArray<Entry, Allocator> _entries;
+    Data                           _slots;
+    // in slots
+    u32                            _capacity;
+    // live entries, '_entries' also holds the dead ones
+    u32                            _count;
+    // removed slots keep probe chains intact until next rebuild
+    u32                            _tombstone_count;
+    HashMapConfig                  _config;
+    [[no_unique_address]] Hasher   _hasher;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    static constexpr u32 FREE_HASH = 0;
+    static constexpr u32 TOMBSTONE_HASH = 1;
+    static constexpr u32 FIRST_VALID_HASH = 2;
+    static constexpr bool USE_HANDLE = Allocator::using_handle();
+
+    OrderedHashMap(const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : OrderedHashMap(DEFAULT_INIT_CAPACITY, get_current_gpa(), config, hasher, equal)
+    {}
+
+    OrderedHashMap(Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : OrderedHashMap(DEFAULT_INIT_CAPACITY, allocator, config, hasher, equal)
+    {}
+
+    OrderedHashMap(u32 prealloc_count, Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _entries{allocator}
+        , _capacity{0}
+        , _count{0}
+        , _tombstone_count{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT_MSG(allocator, "Should be valid pointer");
+        SF_ASSERT(config.grow_factor > 1.0f);
+        SF_ASSERT(config.load_factor > 0.0f && config.load_factor < 1.0f);
+        reset_slots();
+        _entries.reserve(prealloc_count);
+        allocate_slots(capacity_for(prealloc_count));
+    }
+
+    OrderedHashMap(OrderedHashMap&& rhs) noexcept
+        : _allocator{rhs._allocator}
+        , _entries{std::move(rhs._entries)}
+        , _slots{rhs._slots}
+        , _capacity{rhs._capacity}
+        , _count{rhs._count}
+        , _tombstone_count{rhs._tombstone_count}
+        , _config{rhs._config}
+        , _hasher{rhs._hasher}
+        , _equal{rhs._equal}
+    {
+        rhs.reset_slots();
+    }
+
+    OrderedHashMap& operator=(OrderedHashMap&& rhs) noexcept
+    {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        free();
+
+        _allocator = rhs._allocator;
+        _entries = std::move(rhs._entries);
+        _slots = rhs._slots;
+        _capacity = rhs._capacity;
+        _count = rhs._count;
+        _tombstone_count = rhs._tombstone_count;
+        _config = rhs._config;
+        _hasher = rhs._hasher;
+        _equal = rhs._equal;
+
+        rhs.reset_slots();
+        return *this;
+    }
+
+    OrderedHashMap(const OrderedHashMap& rhs) = delete;
+    OrderedHashMap& operator=(const OrderedHashMap& rhs) = delete;
+
+    ~OrderedHashMap() noexcept {
+        free();
+    }
+
+    void free() noexcept {
+        _entries.free();
+        free_slots();
+        reset_slots();
+    }
+
+    void clear() noexcept {
+        _entries.clear();
+        if (_capacity > 0) {
+            sf_mem_zero(slots(), _capacity * sizeof(Slot));
+        }
+        _count = 0;
+        _tombstone_count = 0;
+    }
+
+    void set_allocator(Allocator* alloc) noexcept {
+        SF_ASSERT_MSG(alloc, "Should be valid pointer");
+        _allocator = alloc;
+        _entries.set_allocator(alloc);
+    }
+
+    // updates entry with the same key, in place
+    template<typename Key, typename Val>
+    void put(Key&& key, Val&& val) noexcept {
+        grow_if_needed();
+
+        u32 hash = hash_inner(key);
+        Slot* slot = find_slot_for_insert(key, hash);
+        if (slot->hash >= FIRST_VALID_HASH) {
+            _entries[slot->index].value = std::forward<Val>(val);
+            return;
+        }
+
+        place_entry(slot, std::forward<Key>(key), std::forward<Val>(val), hash);
+    }
+
+    // put without update
+    template<typename Key, typename Val>
+    bool put_if_empty(Key&& key, Val&& val) noexcept {
+        grow_if_needed();
+
+        u32 hash = hash_inner(key);
+        Slot* slot = find_slot_for_insert(key, hash);
+        if (slot->hash >= FIRST_VALID_HASH) {
+            return false;
+        }
+
+        place_entry(slot, std::forward<Key>(key), std::forward<Val>(val), hash);
+        return true;
+    }
+
+    V* get(ConstLRefOrValType<K> key) noexcept {
+        Slot* slot = find_slot(key);
+        if (!slot) {
+            return nullptr;
+        }
+
+        return &_entries[slot->index].value;
+    }
+
+    bool has(ConstLRefOrValType<K> key) noexcept {
+        return find_slot(key) != nullptr;
+    }
+
+    // later entries keep their positions, the dead one is dropped on next rebuild
+    bool remove(ConstLRefOrValType<K> key) noexcept {
+        Slot* slot = find_slot(key);
+        if (!slot) {
+            return false;
+        }
+
+        _entries[slot->index].hash = TOMBSTONE_HASH;
+        // FREE_HASH here would cut probe chains of entries placed after this one
+        slot->hash = TOMBSTONE_HASH;
+        ++_tombstone_count;
+        --_count;
+
+        return true;
+    }
+
+    void reserve(u32 new_count) noexcept {
+        _entries.reserve(new_count);
+        u32 new_capacity = capacity_for(new_count);
+        if (new_capacity > _capacity) {
+            rebuild(new_capacity);
+        }
+    }
+
+    // drops dead entries and rebuilds the table, so entries are contiguous afterwards
+    void compact() noexcept {
+        if (_entries.count() != _count) {
+            rebuild(_capacity);
+        }
+    }
+
+    bool is_empty() const noexcept { return _count == 0; }
+
+    constexpr u32 count() const noexcept { return _count; }
+    constexpr u32 size_in_bytes() const noexcept { return sizeof(Entry) * _count + sizeof(Slot) * _capacity; }
+    constexpr u32 capacity() const noexcept { return _capacity; }
+
+    Iterator begin() noexcept {
+        return Iterator{_entries.data(), 0, _entries.count()};
+    }
+
+    Iterator end() noexcept {
+        return Iterator{_entries.data(), _entries.count(), _entries.count()};
+    }
+private:
+    Slot* slots() const noexcept {
+        if constexpr (USE_HANDLE) {
+            return static_cast<Slot*>(_allocator->handle_to_ptr(_slots.handle));
+        } else {
+            return _slots.ptr;
+        }
+    }
+
+    u32 max_load(u32 capacity) const noexcept {
+        return std::min(static_cast<u32>(capacity * _config.load_factor), capacity - 1);
+    }
+
+    u32 capacity_for(u32 count) const noexcept {
+        u32 capacity = std::max(next_power_of_2(count), 8u);
+        while (max_load(capacity) < count) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void reset_slots() noexcept {
+        if constexpr (USE_HANDLE) {
+            _slots.handle = INVALID_ALLOC_HANDLE;
+        } else {
+            _slots.ptr = nullptr;
+        }
+        _capacity = 0;
+        _count = 0;
+        _tombstone_count = 0;
+    }
+
+    void allocate_slots(u32 new_capacity) noexcept {
+        _capacity = new_capacity;
+        if constexpr (USE_HANDLE) {
+            _slots.handle = _allocator->allocate_handle(_capacity * sizeof(Slot), alignof(Slot));
+        } else {
+            _slots.ptr = static_cast<Slot*>(_allocator->allocate(_capacity * sizeof(Slot), alignof(Slot)));
+        }
+        sf_mem_zero(slots(), _capacity * sizeof(Slot));
+    }
+
+    // compacts live entries to the front in order, then reindexes them from stored
+    // hashes into a table of 'new_capacity' slots; keys are not rehashed
+    void rebuild(u32 new_capacity) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        // table may be gone after 'free()'
+        new_capacity = std::max(new_capacity, capacity_for(DEFAULT_INIT_CAPACITY));
+
+        u32 live{0};
+        for (u32 i{0}; i < _entries.count(); ++i) {
+            if (_entries[i].hash < FIRST_VALID_HASH) {
+                continue;
+            }
+            if (live != i) {
+                _entries[live] = std::move(_entries[i]);
+            }
+            ++live;
+        }
+        if (live < _entries.count()) {
+            _entries.pop_range(_entries.count() - live);
+        }
+
+        if (new_capacity != _capacity) {
+            u32 count = _count;
+            free_slots();
+            allocate_slots(new_capacity);
+            _count = count;
+        } else {
+            sf_mem_zero(slots(), _capacity * sizeof(Slot));
+        }
+        _tombstone_count = 0;
+
+        Slot* s = slots();
+        u32 mask = _capacity - 1;
+        for (u32 i{0}; i < live; ++i) {
+            u32 hash = _entries[i].hash;
+            u32 index = hash & mask;
+            while (s[index].hash != FREE_HASH) {
+                index = (index + 1) & mask;
+            }
+            s[index] = Slot{ .hash = hash, .index = i };
+        }
+    }
+
+    void free_slots() noexcept {
+        if (_capacity == 0) {
+            return;
+        }
+        if constexpr (USE_HANDLE) {
+            _allocator->free_handle(_slots.handle, alignof(Slot));
+        } else {
+            _allocator->free(_slots.ptr, alignof(Slot));
+        }
+    }
+
+    void grow_if_needed() noexcept {
+        if (_count + _tombstone_count >= max_load(_capacity)) {
+            // mostly tombstones: rebuild at the same capacity to reclaim them
+            rebuild(_tombstone_count > _count ? _capacity : static_cast<u32>(_capacity * _config.grow_factor));
+        } else if (_entries.count() - _count > std::max(_count, DEFAULT_INIT_CAPACITY)) {
+            // reused slots leave dead entries behind without adding tombstones
+            rebuild(_capacity);
+        }
+    }
+
+    Slot* find_slot(ConstLRefOrValType<K> key) noexcept {
+        u32 hash = hash_inner(key);
+        Slot* s = slots();
+        const Entry* entries = _entries.data();
+        u32 mask = _capacity - 1;
+
+        for (u32 n{0}, index = hash & mask; n < _capacity; ++n, index = (index + 1) & mask) {
+            if (s[index].hash == hash && _equal(key, entries[s[index].index].key)) {
+                return s + index;
+            }
+            if (s[index].hash == FREE_HASH) {
+                return nullptr;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // returns the slot holding the key, or the first reusable (free or tombstone) slot
+    // on its probe chain; the whole chain is checked before a tombstone is reused
+    Slot* find_slot_for_insert(ConstLRefOrValType<K> key, u32 hash) noexcept {
+        Slot* s = slots();
+        const Entry* entries = _entries.data();
+        u32 mask = _capacity - 1;
+        Slot* first_tombstone = nullptr;
+
+        for (u32 n{0}, index = hash & mask; n < _capacity; ++n, index = (index + 1) & mask) {
+            if (s[index].hash == FREE_HASH) {
+                return first_tombstone ? first_tombstone : s + index;
+            }
+            if (s[index].hash == TOMBSTONE_HASH) {
+                if (!first_tombstone) {
+                    first_tombstone = s + index;
+                }
+            } else if (s[index].hash == hash && _equal(key, entries[s[index].index].key)) {
+                return s + index;
+            }
+        }
+
+        SF_ASSERT_MSG(first_tombstone, "Should have empty space");
+        return first_tombstone;
+    }
+
+    template<typename Key, typename Val>
+    void place_entry(Slot* slot, Key&& key, Val&& val, u32 hash) noexcept {
+        if (slot->hash == TOMBSTONE_HASH) {
+            --_tombstone_count;
+        }
+        *slot = Slot{ .hash = hash, .index = _entries.count() };
+        _entries.append_emplace(Entry{ .key = std::forward<Key>(key), .value = std::forward<Val>(val), .hash = hash });
+        ++_count;
+    }
+
+    // folds the 64-bit hash so both halves decide slot and match
+    u32 hash_inner(ConstLRefOrValType<K> key) const noexcept {
+        u64 hash = _hasher(key);
+        return std::max(static_cast<u32>(hash ^ (hash >> 32)), FIRST_VALID_HASH);
+    }
+};
+
+} // sf
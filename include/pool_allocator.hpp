@@ -0,0 +1,220 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "dynamic_array.hpp"
+#include "general_purpose_allocator.hpp"
+#include "traits.hpp"
+#include "constants.hpp"
+#include "defines.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+
+namespace sf {
+
+// Allocator of equal sized blocks. Chunks of blocks are taken from the system and never
+// move, free blocks are chained through their own first bytes, so allocate and free are
+// a pointer pop and push with no header per block. New chunks are carved lazily, block by
+// block, as the free list runs dry. Requests larger than BlockSize are a bug, which makes
+// it a fit for node-like objects and fixed capacity containers, not for growing arrays.
+// A handle is the global block index: chunk index times blocks per chunk plus the slot.
+template<u32 BlockSize, u16 Alignment = alignof(std::max_align_t)>
+struct PoolAllocator {
+public:
+    static_assert(BlockSize > 0, "Block size should be positive");
+    static_assert((Alignment & (Alignment - 1)) == 0, "Alignment should be a power of two");
+
+    static constexpr u16 BLOCK_ALIGNMENT{std::max<u16>(Alignment, alignof(void*))};
+    static constexpr u32 BLOCK_STRIDE{(std::max<u32>(BlockSize, sizeof(void*)) + BLOCK_ALIGNMENT - 1) & ~static_cast<u32>(BLOCK_ALIGNMENT - 1)};
+    static constexpr u32 DEFAULT_BLOCKS_PER_CHUNK{256};
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+private:
+    DynamicArray<u8*, GeneralPurposeAllocator> _chunks;
+    FreeBlock*  _free_head;
+    u32         _blocks_per_chunk_log2;
+    // next never used block: chunk and slot within it
+    u32         _carve_chunk;
+    u32         _carve_index;
+    u32         _count;
+public:
+    PoolAllocator() noexcept
+        : PoolAllocator(DEFAULT_BLOCKS_PER_CHUNK)
+    {}
+
+    // rounded up to a power of two
+    explicit PoolAllocator(u32 blocks_per_chunk) noexcept
+        : _chunks{get_current_gpa()}
+        , _free_head{nullptr}
+        , _blocks_per_chunk_log2{static_cast<u32>(std::countr_zero(next_power_of_2(std::max(blocks_per_chunk, 1u))))}
+        , _carve_chunk{0}
+        , _carve_index{0}
+        , _count{0}
+    {}
+
+    PoolAllocator(PoolAllocator&& rhs) noexcept
+        : _chunks{std::move(rhs._chunks)}
+        , _free_head{rhs._free_head}
+        , _blocks_per_chunk_log2{rhs._blocks_per_chunk_log2}
+        , _carve_chunk{rhs._carve_chunk}
+        , _carve_index{rhs._carve_index}
+        , _count{rhs._count}
+    {
+        rhs.clear();
+    }
+
+    PoolAllocator& operator=(PoolAllocator&& rhs) noexcept {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        release();
+        _chunks = std::move(rhs._chunks);
+        _free_head = rhs._free_head;
+        _blocks_per_chunk_log2 = rhs._blocks_per_chunk_log2;
+        _carve_chunk = rhs._carve_chunk;
+        _carve_index = rhs._carve_index;
+        _count = rhs._count;
+
+        rhs.clear();
+        return *this;
+    }
+
+    PoolAllocator(const PoolAllocator& rhs) = delete;
+    PoolAllocator& operator=(const PoolAllocator& rhs) = delete;
+
+    ~PoolAllocator() noexcept {
+        release();
+    }
+
+    void* allocate(usize size, u16 alignment) noexcept {
+        SF_ASSERT_MSG(size <= BlockSize, "Allocation is larger than the pool block");
+        SF_ASSERT_MSG(alignment <= BLOCK_ALIGNMENT, "Alignment is stricter than the pool block");
+        ++_count;
+        if (_free_head) {
+            FreeBlock* block = _free_head;
+            _free_head = block->next;
+            return block;
+        }
+
+        return carve();
+    }
+
+    usize allocate_handle(usize size, u16 alignment) noexcept {
+        return ptr_to_handle(allocate(size, alignment));
+    }
+
+    // blocks never change size, anything that still fits stays in place
+    ReallocReturn reallocate(void* addr, usize new_size, u16 alignment) noexcept {
+        if (addr == nullptr) {
+            return {allocate(new_size, alignment), false};
+        }
+
+        SF_ASSERT_MSG(new_size <= BlockSize, "Allocation is larger than the pool block");
+        return {new_size <= BlockSize ? addr : nullptr, false};
+    }
+
+    ReallocReturnHandle reallocate_handle(usize handle, usize new_size, u16 alignment) noexcept {
+        if (handle == INVALID_ALLOC_HANDLE) {
+            return {allocate_handle(new_size, alignment), false};
+        }
+
+        SF_ASSERT_MSG(new_size <= BlockSize, "Allocation is larger than the pool block");
+        return {new_size <= BlockSize ? handle : INVALID_ALLOC_HANDLE, false};
+    }
+
+    void* handle_to_ptr(usize handle) const noexcept {
+        if (handle == INVALID_ALLOC_HANDLE) {
+            return nullptr;
+        }
+
+        u32 chunk = static_cast<u32>(handle) >> _blocks_per_chunk_log2;
+        u32 slot = static_cast<u32>(handle) & (blocks_per_chunk() - 1);
+        SF_ASSERT_MSG(chunk < _chunks.count(), "Handle is not from this pool");
+        return _chunks[chunk] + static_cast<usize>(slot) * BLOCK_STRIDE;
+    }
+
+    // scans the chunks, only worth it for allocators driven by handles
+    usize ptr_to_handle(void* ptr) const noexcept {
+        if (!ptr) {
+            return INVALID_ALLOC_HANDLE;
+        }
+
+        u32 chunk = find_chunk(ptr);
+        if (chunk == INVALID_ID) {
+            return INVALID_ALLOC_HANDLE;
+        }
+        u32 slot = static_cast<u32>((static_cast<u8*>(ptr) - _chunks[chunk]) / BLOCK_STRIDE);
+        return (chunk << _blocks_per_chunk_log2) | slot;
+    }
+
+    void free(void* addr, u16 alignment = 0) noexcept {
+        if (!addr) {
+            return;
+        }
+
+#ifdef SF_DEBUG
+        SF_ASSERT_MSG(find_chunk(addr) != INVALID_ID, "Block is not from this pool");
+#endif
+        FreeBlock* block = static_cast<FreeBlock*>(addr);
+        block->next = _free_head;
+        _free_head = block;
+        --_count;
+    }
+
+    void free_handle(usize handle, u16 alignment = 0) noexcept {
+        free(handle_to_ptr(handle), alignment);
+    }
+
+    // every block is free again, chunks are kept
+    void clear() noexcept {
+        _free_head = nullptr;
+        _carve_chunk = 0;
+        _carve_index = 0;
+        _count = 0;
+    }
+
+    // hands chunks back to the system
+    void release() noexcept {
+        for (u8* chunk : _chunks) {
+            sf_mem_free(chunk, BLOCK_ALIGNMENT);
+        }
+        _chunks.clear();
+        clear();
+    }
+
+    constexpr u32 count() const noexcept { return _count; }
+    constexpr u32 chunk_count() const noexcept { return _chunks.count(); }
+    constexpr u32 blocks_per_chunk() const noexcept { return 1u << _blocks_per_chunk_log2; }
+    constexpr u32 capacity() const noexcept { return _chunks.count() << _blocks_per_chunk_log2; }
+    static constexpr u32 block_size() noexcept { return BlockSize; }
+    static constexpr bool using_handle() noexcept { return false; }
+private:
+    void* carve() noexcept {
+        if (_carve_index == blocks_per_chunk()) {
+            ++_carve_chunk;
+            _carve_index = 0;
+        }
+        if (_carve_chunk == _chunks.count()) {
+            _chunks.append(static_cast<u8*>(sf_mem_alloc(static_cast<usize>(BLOCK_STRIDE) << _blocks_per_chunk_log2, BLOCK_ALIGNMENT)));
+        }
+
+        return _chunks[_carve_chunk] + static_cast<usize>(_carve_index++) * BLOCK_STRIDE;
+    }
+
+    u32 find_chunk(void* ptr) const noexcept {
+        usize chunk_bytes = static_cast<usize>(BLOCK_STRIDE) << _blocks_per_chunk_log2;
+        for (u32 i{0}; i < _chunks.count(); ++i) {
+            if (static_cast<u8*>(ptr) >= _chunks[i] && static_cast<u8*>(ptr) < _chunks[i] + chunk_bytes) {
+                return i;
+            }
+        }
+        return INVALID_ID;
+    }
+};
+
+} // sf
@@ -0,0 +1,453 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "general_purpose_allocator.hpp"
+#include "hashmap.hpp"
+#include "traits.hpp"
+#include "constants.hpp"
+#include "defines.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+namespace sf {
+
+// Linear probing with Robin Hood displacement: on insert an entry that is further
+// from its home bucket steals the slot of a "richer" entry which sits closer to its own.
+// Removal shifts the following cluster one slot back, so no tombstones are ever left.
+template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, u32 DEFAULT_INIT_CAPACITY = 32, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct RobinHoodHashMap {
+public:
+    using KeyType = K;
+    using ValueType = V;
+
+    struct Bucket {
+        K   key;
+        V   value;
+        // low bits of the full hash, used to skip key comparisons
+        u32 hash;
+        // probe distance + 1, 0 marks a free bucket
+        u32 dist;
+    };
+
+    union Data {
+        Bucket* ptr;
+        u32     handle;
+    };
+
+    struct Iterator {
+    private:
+        Bucket* _bucket;
+        Bucket* _end;
+    public:
+        Iterator(Bucket* bucket, Bucket* end) noexcept
+            : _bucket{bucket}
+            , _end{end}
+        {
+            skip_free();
+        }
+
+        Bucket& operator*() const noexcept { return *_bucket; }
+        Bucket* operator->() const noexcept { return _bucket; }
+
+        Iterator& operator++() noexcept {
+            ++_bucket;
+            skip_free();
+            return *this;
+        }
+
+        friend bool operator==(const Iterator& first, const Iterator& second) noexcept {
+            return first._bucket == second._bucket;
+        }
+
+        friend bool operator!=(const Iterator& first, const Iterator& second) noexcept {
+            return first._bucket != second._bucket;
+        }
+    private:
+        void skip_free() noexcept {
+            while (_bucket != _end && _bucket->dist == FREE_DIST) {
+                ++_bucket;
+            }
+        }
+    };
+private:
+    Allocator*          _allocator;
+    Data                _data;
+    u32                 _capacity;
+    u32                 _count;
+    // longest probe distance seen since the last resize
+    u32                 _max_dist;
+    HashMapConfig       _config;
+    [[no_unique_address]] Hasher   _hasher;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    static constexpr u32 FREE_DIST = 0;
+    static constexpr bool USE_HANDLE = Allocator::using_handle();
+
+    RobinHoodHashMap(const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{get_current_gpa()}
+        , _capacity{0}
+        , _count{0}
+        , _max_dist{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        resize_empty(DEFAULT_INIT_CAPACITY);
+    }
+
+    RobinHoodHashMap(Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _capacity{0}
+        , _count{0}
+        , _max_dist{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        resize_empty(DEFAULT_INIT_CAPACITY);
+    }
+
+    RobinHoodHashMap(u32 prealloc_count, Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _capacity{0}
+        , _count{0}
+        , _max_dist{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        resize_empty(prealloc_count);
+    }
+
+    RobinHoodHashMap(RobinHoodHashMap&& rhs) noexcept
+        : _allocator{rhs._allocator}
+        , _data{rhs._data}
+        , _capacity{rhs._capacity}
+        , _count{rhs._count}
+        , _max_dist{rhs._max_dist}
+        , _config{rhs._config}
+        , _hasher{rhs._hasher}
+        , _equal{rhs._equal}
+    {
+        rhs.reset_empty();
+    }
+
+    RobinHoodHashMap& operator=(RobinHoodHashMap&& rhs) noexcept
+    {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        free();
+
+        _allocator = rhs._allocator;
+        _data = rhs._data;
+        _capacity = rhs._capacity;
+        _count = rhs._count;
+        _max_dist = rhs._max_dist;
+        _config = rhs._config;
+        _hasher = rhs._hasher;
+        _equal = rhs._equal;
+
+        rhs.reset_empty();
+        return *this;
+    }
+
+    RobinHoodHashMap(const RobinHoodHashMap& rhs) = delete;
+    RobinHoodHashMap& operator=(const RobinHoodHashMap& rhs) = delete;
+
+    ~RobinHoodHashMap() noexcept {
+        free();
+    }
+
+    void free() noexcept {
+        if (_capacity == 0) {
+            return;
+        }
+
+        destroy_buckets();
+        if constexpr (USE_HANDLE) {
+            _allocator->free_handle(_data.handle, alignof(Bucket));
+        } else {
+            _allocator->free(_data.ptr, alignof(Bucket));
+        }
+        reset_empty();
+    }
+
+    void clear() noexcept {
+        if (_capacity == 0) {
+            return;
+        }
+
+        destroy_buckets();
+        sf_mem_zero(access_data(), _capacity * sizeof(Bucket));
+        _count = 0;
+        _max_dist = 0;
+    }
+
+    void set_allocator(Allocator* alloc) noexcept {
+        SF_ASSERT_MSG(alloc, "Should be valid pointer");
+        _allocator = alloc;
+    }
+
+    // updates entry with the same key
+    template<typename Key, typename Val>
+    void put(Key&& key, Val&& val) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        u64 hash = _hasher(key);
+        Bucket* bucket = find_bucket(key, hash);
+
+        if (bucket) {
+            bucket->value = std::forward<Val>(val);
+            return;
+        }
+
+        grow_if_needed();
+        insert_new(Bucket{ .key = std::forward<Key>(key), .value = std::forward<Val>(val), .hash = static_cast<u32>(hash), .dist = 1 });
+    }
+
+    // put without update
+    template<typename Key, typename Val>
+    bool put_if_empty(Key&& key, Val&& val) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        u64 hash = _hasher(key);
+
+        if (find_bucket(key, hash)) {
+            return false;
+        }
+
+        grow_if_needed();
+        insert_new(Bucket{ .key = std::forward<Key>(key), .value = std::forward<Val>(val), .hash = static_cast<u32>(hash), .dist = 1 });
+        return true;
+    }
+
+    V* get(ConstLRefOrValType<K> key) noexcept {
+        Bucket* bucket = find_bucket(key, _hasher(key));
+        if (!bucket) {
+            return nullptr;
+        }
+
+        return &bucket->value;
+    }
+
+    bool has(ConstLRefOrValType<K> key) noexcept {
+        return find_bucket(key, _hasher(key)) != nullptr;
+    }
+
+    // backward-shift deletion: pull every following entry of the cluster one slot
+    // closer to its home until we hit a free bucket or an entry already at home
+    bool remove(ConstLRefOrValType<K> key) noexcept {
+        Bucket* bucket = find_bucket(key, _hasher(key));
+        if (!bucket) {
+            return false;
+        }
+
+        Bucket* data = access_data();
+        u32 mask = _capacity - 1;
+        u32 index = static_cast<u32>(bucket - data);
+        u32 next = (index + 1) & mask;
+
+        while (data[next].dist > 1) {
+            data[index].key = std::move(data[next].key);
+            data[index].value = std::move(data[next].value);
+            data[index].hash = data[next].hash;
+            data[index].dist = data[next].dist - 1;
+            index = next;
+            next = (next + 1) & mask;
+        }
+
+        destroy_bucket(data + index);
+        data[index].dist = FREE_DIST;
+        --_count;
+
+        return true;
+    }
+
+    void reserve(u32 new_capacity) noexcept {
+        SF_ASSERT_MSG(_allocator, "Allocator should be set");
+        if (new_capacity > _capacity) {
+            resize(new_capacity);
+        }
+    }
+
+    bool is_empty() const noexcept { return _capacity == 0 || _count == 0; }
+
+    constexpr u32 count() const noexcept { return _count; }
+    constexpr u32 size_in_bytes() const noexcept { return sizeof(Bucket) * _count; }
+    constexpr u32 capacity() const noexcept { return _capacity; }
+    constexpr u32 capacity_remain() const noexcept { return _capacity - _count; }
+    // upper bound of buckets a lookup has to inspect
+    constexpr u32 max_probe_length() const noexcept { return _max_dist; }
+
+    Iterator begin() noexcept {
+        Bucket* data = access_data();
+        return Iterator{data, data + _capacity};
+    }
+
+    Iterator end() noexcept {
+        Bucket* data = access_data();
+        return Iterator{data + _capacity, data + _capacity};
+    }
+private:
+    Bucket* access_data() const noexcept {
+        if constexpr (USE_HANDLE) {
+            if (_data.handle == INVALID_ALLOC_HANDLE) {
+                return nullptr;
+            }
+            return static_cast<Bucket*>(_allocator->handle_to_ptr(_data.handle));
+        } else {
+            return _data.ptr;
+        }
+    }
+
+    void reset_empty() noexcept {
+        if constexpr (USE_HANDLE) {
+            _data.handle = INVALID_ALLOC_HANDLE;
+        } else {
+            _data.ptr = nullptr;
+        }
+        _capacity = 0;
+        _count = 0;
+        _max_dist = 0;
+    }
+
+    void destroy_bucket(Bucket* bucket) noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K>) {
+            bucket->key.~K();
+        }
+        if constexpr (!std::is_trivially_destructible_v<V>) {
+            bucket->value.~V();
+        }
+    }
+
+    void destroy_buckets() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K> || !std::is_trivially_destructible_v<V>) {
+            Bucket* data = access_data();
+            for (u32 i{0}; i < _capacity; ++i) {
+                if (data[i].dist != FREE_DIST) {
+                    destroy_bucket(data + i);
+                }
+            }
+        }
+    }
+
+    void resize_empty(u32 new_capacity) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        _capacity = next_power_of_2(new_capacity == 0 ? DEFAULT_INIT_CAPACITY : new_capacity);
+
+        if constexpr (USE_HANDLE) {
+            _data.handle = _allocator->allocate_handle(_capacity * sizeof(Bucket), alignof(Bucket));
+        } else {
+            _data.ptr = static_cast<Bucket*>(_allocator->allocate(_capacity * sizeof(Bucket), alignof(Bucket)));
+        }
+
+        sf_mem_zero(access_data(), _capacity * sizeof(Bucket));
+        _count = 0;
+        _max_dist = 0;
+    }
+
+    void grow_if_needed() noexcept {
+        if (_capacity == 0) {
+            resize_empty(DEFAULT_INIT_CAPACITY);
+        } else if (_count + 1 > static_cast<u32>(_capacity * _config.load_factor)) {
+            resize(_capacity * _config.grow_factor);
+        }
+    }
+
+    void resize(u32 new_capacity) noexcept {
+        u32 old_capacity = _capacity;
+        Data old_data = _data;
+
+        resize_empty(std::max(new_capacity, _capacity));
+
+        if (old_capacity == 0) {
+            return;
+        }
+
+        Bucket* old_buffer;
+        if constexpr (USE_HANDLE) {
+            // allocator buffer may have moved while allocating the new table
+            old_buffer = static_cast<Bucket*>(_allocator->handle_to_ptr(old_data.handle));
+        } else {
+            old_buffer = old_data.ptr;
+        }
+
+        for (u32 i{0}; i < old_capacity; ++i) {
+            Bucket* bucket = old_buffer + i;
+            if (bucket->dist == FREE_DIST) {
+                continue;
+            }
+            insert_new(Bucket{ .key = std::move(bucket->key), .value = std::move(bucket->value), .hash = bucket->hash, .dist = 1 });
+            destroy_bucket(bucket);
+        }
+
+        if constexpr (USE_HANDLE) {
+            _allocator->free_handle(old_data.handle, alignof(Bucket));
+        } else {
+            _allocator->free(old_data.ptr, alignof(Bucket));
+        }
+    }
+
+    u32 index_hash(u64 hash) const noexcept {
+        return static_cast<u32>(hash) & (_capacity - 1);
+    }
+
+    Bucket* find_bucket(ConstLRefOrValType<K> key, u64 hash) const noexcept {
+        if (_capacity == 0) {
+            return nullptr;
+        }
+
+        Bucket* data = access_data();
+        u32 mask = _capacity - 1;
+        u32 index = index_hash(hash);
+        u32 short_hash = static_cast<u32>(hash);
+
+        // every entry is at most as far from home as the one we are looking for
+        // would be, so the search ends at the first "richer" bucket
+        for (u32 dist{1}; dist <= data[index].dist; ++dist) {
+            if (data[index].hash == short_hash && _equal(key, data[index].key)) {
+                return data + index;
+            }
+            index = (index + 1) & mask;
+        }
+
+        return nullptr;
+    }
+
+    // key must not be present in the map
+    void insert_new(Bucket&& entry) noexcept {
+        Bucket* data = access_data();
+        u32 mask = _capacity - 1;
+        u32 index = index_hash(entry.hash);
+
+        while (true) {
+            Bucket& bucket = data[index];
+
+            if (bucket.dist == FREE_DIST) {
+                ::new (&bucket) Bucket{ std::move(entry) };
+                _max_dist = std::max(_max_dist, bucket.dist);
+                ++_count;
+                return;
+            }
+
+            if (bucket.dist < entry.dist) {
+                std::swap(bucket.key, entry.key);
+                std::swap(bucket.value, entry.value);
+                std::swap(bucket.hash, entry.hash);
+                std::swap(bucket.dist, entry.dist);
+                _max_dist = std::max(_max_dist, bucket.dist);
+            }
+
+            ++entry.dist;
+            index = (index + 1) & mask;
+        }
+    }
+};
+
+} // sf
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "defines.hpp"
+#include <atomic>
+#include <bit>
+#include <mutex>
+
+namespace sf {
+
+struct SlabThreadHeap;
+
+// Header at the start of every span, objects follow it back to back.
+struct SlabSpan {
+    // links in the partial list of its size class or owning heap
+    SlabSpan* prev;
+    SlabSpan* next;
+    void*     free_list;
+    // thread heap allocating from this span, null for spans of the shared partial lists
+    std::atomic<SlabThreadHeap*> owner;
+    // first never handed out byte, objects past it are carved on demand
+    u32       carve_offset;
+    u32       used;
+    u32       capacity;
+    u16       size_class;
+};
+
+// Small object front-end for GeneralPurposeAllocator. Requests up to MAX_SIZE are rounded
+// to one of CLASS_COUNT size classes (16 byte steps up to 128, then four classes per power
+// of two) and served from SPAN_SIZE spans holding objects of one class. All spans come from
+// a single address range reserved up front, so telling a slab pointer from a system one is
+// a range check and finding its span is a mask, with no per-object header.
+// Spans left empty while their class has others are decommitted and reused by any class.
+// Shared spans are guarded by a lock per size class; SlabThreadHeap owns spans outright
+// and works on them without locks.
+struct SlabAllocator {
+public:
+    static constexpr u32 SPAN_SIZE{256 * 1024};
+    static constexpr usize RESERVE_SIZE{usize{4} << 30};
+    static constexpr u32 SPAN_HEADER_SIZE{64};
+    static constexpr u32 MAX_SIZE{32 * 1024};
+    static constexpr u16 MAX_ALIGNMENT{16};
+    static constexpr u32 LINEAR_CLASS_COUNT{8};
+    static constexpr u32 CLASSES_PER_DOUBLING{4};
+    static constexpr u32 CLASS_COUNT{LINEAR_CLASS_COUNT + CLASSES_PER_DOUBLING * 8};
+
+    static_assert(sizeof(SlabSpan) <= SPAN_HEADER_SIZE);
+private:
+    struct SizeClass {
+        std::mutex lock;
+        SlabSpan*  partial{nullptr};
+    };
+
+    SizeClass        _classes[CLASS_COUNT]{};
+    std::mutex       _span_lock;
+    std::once_flag   _reserve_once;
+    // SPAN_SIZE aligned start inside the raw reservation
+    std::atomic<u8*> _base{nullptr};
+    u8*              _reservation{nullptr};
+    // guarded by _span_lock
+    usize            _span_top{0};
+    SlabSpan*        _free_spans{nullptr};
+    std::atomic<u32> _span_count{0};
+    // heaps of exited threads with their spans, waiting for a new thread, guarded by _span_lock
+    SlabThreadHeap*  _orphan_heaps{nullptr};
+
+    friend struct SlabThreadHeap;
+public:
+    // constant initialized, the range is reserved on first use
+    constexpr SlabAllocator() noexcept = default;
+    ~SlabAllocator() noexcept;
+
+    SlabAllocator(const SlabAllocator& rhs) = delete;
+    SlabAllocator& operator=(const SlabAllocator& rhs) = delete;
+
+    // nullptr when the request is too large, too aligned or the range is used up
+    void* allocate(usize size, u16 alignment) noexcept;
+    // addr has to be owned, blocks of a thread heap's span are queued back to that heap
+    void  free(void* addr) noexcept;
+
+    // heap for a new thread, an orphaned one with its spans when there is any
+    SlabThreadHeap* adopt_heap() noexcept;
+
+    bool owns(const void* addr) const noexcept {
+        const u8* base = _base.load(std::memory_order_acquire);
+        return base && static_cast<const u8*>(addr) >= base && static_cast<const u8*>(addr) < base + RESERVE_SIZE;
+    }
+
+    // size class of an owned pointer, it may grow in place up to this
+    u32 usable_size(const void* addr) const noexcept {
+        return class_size(span_of(addr)->size_class);
+    }
+
+    u32 span_count() const noexcept { return _span_count.load(std::memory_order_relaxed); }
+
+    static constexpr u32 size_class_of(usize size) noexcept {
+        u32 s = size == 0 ? 1 : static_cast<u32>(size);
+        if (s <= LINEAR_CLASS_COUNT * 16) {
+            return (s + 15) / 16 - 1;
+        }
+        // s is in (2^log2, 2^(log2 + 1)], split into CLASSES_PER_DOUBLING steps
+        u32 log2 = 31 - std::countl_zero(s - 1);
+        u32 sub = (s - 1 - (1u << log2)) >> (log2 - 2);
+        return LINEAR_CLASS_COUNT + (log2 - 7) * CLASSES_PER_DOUBLING + sub;
+    }
+
+    static constexpr u32 class_size(u32 size_class) noexcept {
+        if (size_class < LINEAR_CLASS_COUNT) {
+            return (size_class + 1) * 16;
+        }
+        u32 log2 = 7 + (size_class - LINEAR_CLASS_COUNT) / CLASSES_PER_DOUBLING;
+        u32 sub = (size_class - LINEAR_CLASS_COUNT) % CLASSES_PER_DOUBLING;
+        return (1u << log2) + (sub + 1) * (1u << (log2 - 2));
+    }
+private:
+    static SlabSpan* span_of(const void* addr) noexcept {
+        return reinterpret_cast<SlabSpan*>(reinterpret_cast<usize>(addr) & ~static_cast<usize>(SPAN_SIZE - 1));
+    }
+
+    void reserve_range() noexcept;
+    SlabSpan* acquire_span(u32 size_class, SlabThreadHeap* owner) noexcept;
+    void release_span(SlabSpan* span) noexcept;
+    static void push_partial(SizeClass& size_class, SlabSpan* span) noexcept;
+    static void unlink_partial(SizeClass& size_class, SlabSpan* span) noexcept;
+};
+
+// Per thread front of a SlabAllocator. Spans taken by a heap are used by its thread alone,
+// so allocating and freeing their blocks takes no lock. A block freed by another thread is
+// pushed onto the owning heap's lock-free remote stack and taken back the next time that heap
+// runs out of a size class. 'flush' gives empty spans back and leaves the heap, with spans
+// still holding live blocks, to be adopted by the next thread; heaps are never freed, so a
+// remote free can always reach its owner.
+struct SlabThreadHeap {
+public:
+    using SizeClassSpans = SlabSpan*[SlabAllocator::CLASS_COUNT];
+private:
+    SlabAllocator*     _slab;
+    // spans with free blocks, full ones are relinked once a block comes back
+    SizeClassSpans     _spans;
+    std::atomic<void*> _remote_free;
+    SlabThreadHeap*    _next_orphan;
+
+    friend struct SlabAllocator;
+public:
+    explicit SlabThreadHeap(SlabAllocator* slab) noexcept;
+
+    // nullptr when the slab can not serve the request
+    void* allocate(usize size, u16 alignment) noexcept;
+    // any pointer owned by the slab, whoever allocated it
+    void  free(void* addr) noexcept;
+    // gives back empty spans and hands the heap to the slab, it must not be used afterwards
+    void  flush() noexcept;
+private:
+    void push_remote(void* addr) noexcept;
+    void drain_remote() noexcept;
+    void free_local(SlabSpan* span, void* addr) noexcept;
+    void link(SlabSpan* span) noexcept;
+    void unlink(SlabSpan* span) noexcept;
+};
+
+static_assert(SlabAllocator::class_size(SlabAllocator::CLASS_COUNT - 1) == SlabAllocator::MAX_SIZE);
+static_assert(SlabAllocator::size_class_of(SlabAllocator::MAX_SIZE) == SlabAllocator::CLASS_COUNT - 1);
+
+} // sf
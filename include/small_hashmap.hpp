@@ -0,0 +1,315 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "general_purpose_allocator.hpp"
+#include "hashmap.hpp"
+#include "traits.hpp"
+#include "defines.hpp"
+#include <new>
+#include <utility>
+
+namespace sf {
+
+// Map which keeps up to INLINE_COUNT entries inside itself, looked up by linear scan
+// without hashing. Inserting past that spills all entries into a HashMap on the allocator,
+// so tiny short lived maps cost neither an allocation nor the zeroing of a bucket table.
+// Once spilled it stays a HashMap until 'free()'.
+template<typename K, typename V, u32 INLINE_COUNT = 8, AllocatorTrait Allocator = GeneralPurposeAllocator, u32 DEFAULT_INIT_CAPACITY = 32, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct SmallHashMap {
+public:
+    using KeyType = K;
+    using ValueType = V;
+    using MapType = HashMap<K, V, Allocator, DEFAULT_INIT_CAPACITY, Hasher, KeyEqual>;
+
+    static_assert(INLINE_COUNT > 0, "Inline count should be at least 1");
+
+    struct Entry {
+        K key;
+        V value;
+    };
+
+    // inline entries and the spilled map are never alive at the same time
+    union Storage {
+        Entry   entries[INLINE_COUNT];
+        MapType map;
+
+        Storage() noexcept {}
+        ~Storage() noexcept {}
+    };
+private:
+    Allocator*          _allocator;
+    Storage             _storage;
+    u32                 _inline_count;
+    bool                _spilled;
+    HashMapConfig       _config;
+    [[no_unique_address]] Hasher   _hasher;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    SmallHashMap(const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{get_current_gpa()}
+        , _inline_count{0}
+        , _spilled{false}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {}
+
+    SmallHashMap(Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _inline_count{0}
+        , _spilled{false}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT_MSG(allocator, "Should be valid pointer");
+    }
+
+    SmallHashMap(SmallHashMap&& rhs) noexcept
+        : _allocator{rhs._allocator}
+        , _inline_count{0}
+        , _spilled{false}
+        , _config{rhs._config}
+        , _hasher{rhs._hasher}
+        , _equal{rhs._equal}
+    {
+        take(rhs);
+    }
+
+    SmallHashMap& operator=(SmallHashMap&& rhs) noexcept {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        free();
+        _allocator = rhs._allocator;
+        _config = rhs._config;
+        _hasher = rhs._hasher;
+        _equal = rhs._equal;
+        take(rhs);
+
+        return *this;
+    }
+
+    SmallHashMap(const SmallHashMap& rhs) = delete;
+    SmallHashMap& operator=(const SmallHashMap& rhs) = delete;
+
+    ~SmallHashMap() noexcept {
+        free();
+    }
+
+    // destroys the entries and the spilled table, map is inline again afterwards
+    void free() noexcept {
+        if (_spilled) {
+            _storage.map.~MapType();
+            _spilled = false;
+        } else {
+            destroy_inline();
+        }
+    }
+
+    // keeps the spilled table allocated
+    void clear() noexcept {
+        if (_spilled) {
+            _storage.map.clear();
+        } else {
+            destroy_inline();
+        }
+    }
+
+    void set_allocator(Allocator* alloc) noexcept {
+        SF_ASSERT_MSG(alloc, "Should be valid pointer");
+        SF_ASSERT_MSG(!_spilled, "Spilled table is owned by the old allocator");
+        _allocator = alloc;
+    }
+
+    // updates entry with the same key
+    template<typename Key, typename Val>
+    void put(Key&& key, Val&& val) noexcept {
+        if (_spilled) {
+            _storage.map.put(std::forward<Key>(key), std::forward<Val>(val));
+            return;
+        }
+
+        Entry* entry = find_inline(key);
+        if (entry) {
+            entry->value = std::forward<Val>(val);
+            return;
+        }
+
+        put_new(std::forward<Key>(key), std::forward<Val>(val));
+    }
+
+    // put without update
+    template<typename Key, typename Val>
+    bool put_if_empty(Key&& key, Val&& val) noexcept {
+        if (_spilled) {
+            return _storage.map.put_if_empty(std::forward<Key>(key), std::forward<Val>(val));
+        }
+
+        if (find_inline(key)) {
+            return false;
+        }
+
+        put_new(std::forward<Key>(key), std::forward<Val>(val));
+        return true;
+    }
+
+    // value for the key, built from 'factory()' when missing
+    template<typename Key, typename F>
+    V& find_or_insert(Key&& key, F&& factory) noexcept {
+        if (_spilled) {
+            return _storage.map.find_or_insert(std::forward<Key>(key), std::forward<F>(factory));
+        }
+
+        Entry* entry = find_inline(key);
+        if (entry) {
+            return entry->value;
+        }
+
+        return *put_new(std::forward<Key>(key), factory());
+    }
+
+    V* get(ConstLRefOrValType<K> key) noexcept {
+        return get_inner(key);
+    }
+
+    template<typename Q> requires TransparentKey<Q, K, Hasher, KeyEqual>
+    V* get(const Q& key) noexcept {
+        return get_inner(key);
+    }
+
+    bool remove(ConstLRefOrValType<K> key) noexcept {
+        return remove_inner(key);
+    }
+
+    template<typename Q> requires TransparentKey<Q, K, Hasher, KeyEqual>
+    bool remove(const Q& key) noexcept {
+        return remove_inner(key);
+    }
+
+    // calls 'fn(const K&, V&)' for every entry
+    template<typename F>
+    void for_each(F&& fn) noexcept {
+        if (_spilled) {
+            for (auto& bucket : _storage.map) {
+                if (bucket.hash >= MapType::FIRST_VALID_HASH) {
+                    fn(static_cast<const K&>(bucket.key), bucket.value);
+                }
+            }
+        } else {
+            for (u32 i{0}; i < _inline_count; ++i) {
+                fn(static_cast<const K&>(_storage.entries[i].key), _storage.entries[i].value);
+            }
+        }
+    }
+
+    bool is_spilled() const noexcept { return _spilled; }
+    bool is_empty() const noexcept { return count() == 0; }
+    u32 count() const noexcept { return _spilled ? _storage.map.count() : _inline_count; }
+    u32 capacity() const noexcept { return _spilled ? _storage.map.capacity() : INLINE_COUNT; }
+    static constexpr u32 inline_capacity() noexcept { return INLINE_COUNT; }
+private:
+    template<typename Q>
+    Entry* find_inline(const Q& key) noexcept {
+        for (u32 i{0}; i < _inline_count; ++i) {
+            if (_equal(_storage.entries[i].key, key)) {
+                return _storage.entries + i;
+            }
+        }
+        return nullptr;
+    }
+
+    template<typename Q>
+    V* get_inner(const Q& key) noexcept {
+        if (_spilled) {
+            return _storage.map.get(key);
+        }
+
+        Entry* entry = find_inline(key);
+        return entry ? &entry->value : nullptr;
+    }
+
+    // order of inline entries is not kept, the last one fills the hole
+    template<typename Q>
+    bool remove_inner(const Q& key) noexcept {
+        if (_spilled) {
+            return _storage.map.remove(key);
+        }
+
+        Entry* entry = find_inline(key);
+        if (!entry) {
+            return false;
+        }
+
+        Entry* last = _storage.entries + _inline_count - 1;
+        if (entry != last) {
+            *entry = std::move(*last);
+        }
+        last->~Entry();
+        --_inline_count;
+        return true;
+    }
+
+    // key is known to be missing
+    template<typename Key, typename Val>
+    V* put_new(Key&& key, Val&& val) noexcept {
+        if (_inline_count < INLINE_COUNT) {
+            Entry* entry = ::new (_storage.entries + _inline_count) Entry{ K(std::forward<Key>(key)), V(std::forward<Val>(val)) };
+            ++_inline_count;
+            return &entry->value;
+        }
+
+        spill();
+        return _storage.map.try_emplace(std::forward<Key>(key), std::forward<Val>(val)).value;
+    }
+
+    // moves inline entries into a freshly allocated table, which is built in the same storage
+    void spill() noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        u32 moved_count = _inline_count;
+        alignas(Entry) u8 moved_storage[sizeof(Entry) * INLINE_COUNT];
+        Entry* moved = reinterpret_cast<Entry*>(moved_storage);
+        for (u32 i{0}; i < moved_count; ++i) {
+            ::new (moved + i) Entry{ std::move(_storage.entries[i]) };
+            _storage.entries[i].~Entry();
+        }
+        _inline_count = 0;
+
+        u32 prealloc_count = std::max(DEFAULT_INIT_CAPACITY, INLINE_COUNT * 2);
+        ::new (&_storage.map) MapType{prealloc_count, _allocator, _config, _hasher, _equal};
+        _spilled = true;
+
+        for (u32 i{0}; i < moved_count; ++i) {
+            _storage.map.put(std::move(moved[i].key), std::move(moved[i].value));
+            moved[i].~Entry();
+        }
+    }
+
+    void destroy_inline() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<Entry>) {
+            for (u32 i{0}; i < _inline_count; ++i) {
+                _storage.entries[i].~Entry();
+            }
+        }
+        _inline_count = 0;
+    }
+
+    // expects this map to be freed
+    void take(SmallHashMap& rhs) noexcept {
+        if (rhs._spilled) {
+            ::new (&_storage.map) MapType{std::move(rhs._storage.map)};
+            _spilled = true;
+            rhs._storage.map.~MapType();
+            rhs._spilled = false;
+        } else {
+            for (u32 i{0}; i < rhs._inline_count; ++i) {
+                ::new (_storage.entries + i) Entry{ std::move(rhs._storage.entries[i]) };
+            }
+            _inline_count = rhs._inline_count;
+            rhs.destroy_inline();
+        }
+    }
+};
+
+} // sf
@@ -0,0 +1,525 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "general_purpose_allocator.hpp"
+#include "hashmap.hpp"
+#include "traits.hpp"
+#include "constants.hpp"
+#include "defines.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+namespace sf {
+
+// Structure-of-arrays layout: 32-bit hashes, keys and values live in three
+// separate arrays of one allocation. Probing walks only the hash array and
+// touches a key on a hash match, values are read once the key is found,
+// so large values never pass through cache during a lookup.
+template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, u32 DEFAULT_INIT_CAPACITY = 32, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct SplitHashMap {
+public:
+    using KeyType = K;
+    using ValueType = V;
+
+    union Data {
+        u8* ptr;
+        u32 handle;
+    };
+
+    struct Entry {
+        K& key;
+        V& value;
+    };
+
+    struct Iterator {
+    private:
+        const u32* _hashes;
+        K*         _keys;
+        V*         _values;
+        u32        _index;
+        u32        _capacity;
+    public:
+        Iterator(const u32* hashes, K* keys, V* values, u32 index, u32 capacity) noexcept
+            : _hashes{hashes}
+            , _keys{keys}
+            , _values{values}
+            , _index{index}
+            , _capacity{capacity}
+        {
+            skip_empty();
+        }
+
+        Entry operator*() const noexcept { return Entry{ _keys[_index], _values[_index] }; }
+
+        Iterator& operator++() noexcept {
+            ++_index;
+            skip_empty();
+            return *this;
+        }
+
+        friend bool operator==(const Iterator& first, const Iterator& second) noexcept {
+            return first._index == second._index;
+        }
+
+        friend bool operator!=(const Iterator& first, const Iterator& second) noexcept {
+            return first._index != second._index;
+        }
+    private:
+        void skip_empty() noexcept {
+            while (_index < _capacity && _hashes[_index] < FIRST_VALID_HASH) {
+                ++_index;
+            }
+        }
+    };
+private:
+    // hashes, keys and values arrays, in one allocation
+    Allocator*          _allocator;
+    Data                _data;
+    u32                 _capacity;
+    u32                 _count;
+    // removed entries keep their hash slot as a tombstone until next resize
+    u32                 _tombstone_count;
+    HashMapConfig       _config;
+    [[no_unique_address]] Hasher   _hasher;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    static constexpr u32 FREE_HASH = 0;
+    static constexpr u32 TOMBSTONE_HASH = 1;
+    static constexpr u32 FIRST_VALID_HASH = 2;
+    static constexpr bool USE_HANDLE = Allocator::using_handle();
+    static constexpr u16 BLOCK_ALIGNMENT = static_cast<u16>(std::max({ alignof(u32), alignof(K), alignof(V) }));
+
+    SplitHashMap(const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{get_current_gpa()}
+        , _capacity{0}
+        , _count{0}
+        , _tombstone_count{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        SF_ASSERT(config.load_factor > 0.0f && config.load_factor < 1.0f);
+        resize_empty(DEFAULT_INIT_CAPACITY);
+    }
+
+    SplitHashMap(Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _capacity{0}
+        , _count{0}
+        , _tombstone_count{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        SF_ASSERT(config.load_factor > 0.0f && config.load_factor < 1.0f);
+        resize_empty(DEFAULT_INIT_CAPACITY);
+    }
+
+    SplitHashMap(u32 prealloc_count, Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _capacity{0}
+        , _count{0}
+        , _tombstone_count{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        SF_ASSERT(config.load_factor > 0.0f && config.load_factor < 1.0f);
+        resize_empty(capacity_for(prealloc_count));
+    }
+
+    SplitHashMap(SplitHashMap&& rhs) noexcept
+        : _allocator{rhs._allocator}
+        , _data{rhs._data}
+        , _capacity{rhs._capacity}
+        , _count{rhs._count}
+        , _tombstone_count{rhs._tombstone_count}
+        , _config{rhs._config}
+        , _hasher{rhs._hasher}
+        , _equal{rhs._equal}
+    {
+        rhs.reset_empty();
+    }
+
+    SplitHashMap& operator=(SplitHashMap&& rhs) noexcept
+    {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        free();
+
+        _allocator = rhs._allocator;
+        _data = rhs._data;
+        _capacity = rhs._capacity;
+        _count = rhs._count;
+        _tombstone_count = rhs._tombstone_count;
+        _config = rhs._config;
+        _hasher = rhs._hasher;
+        _equal = rhs._equal;
+
+        rhs.reset_empty();
+        return *this;
+    }
+
+    SplitHashMap(const SplitHashMap& rhs) = delete;
+    SplitHashMap& operator=(const SplitHashMap& rhs) = delete;
+
+    ~SplitHashMap() noexcept {
+        free();
+    }
+
+    void free() noexcept {
+        if (_capacity == 0) {
+            return;
+        }
+
+        destroy_entries();
+        if constexpr (USE_HANDLE) {
+            _allocator->free_handle(_data.handle, BLOCK_ALIGNMENT);
+        } else {
+            _allocator->free(_data.ptr, BLOCK_ALIGNMENT);
+        }
+        reset_empty();
+    }
+
+    void clear() noexcept {
+        if (_capacity == 0) {
+            return;
+        }
+
+        destroy_entries();
+        sf_mem_zero(hashes(), _capacity * sizeof(u32));
+        _count = 0;
+        _tombstone_count = 0;
+    }
+
+    void set_allocator(Allocator* alloc) noexcept {
+        SF_ASSERT_MSG(alloc, "Should be valid pointer");
+        _allocator = alloc;
+    }
+
+    // updates entry with the same key
+    template<typename Key, typename Val>
+    void put(Key&& key, Val&& val) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        grow_if_needed();
+
+        u32 hash = hash_inner(key);
+        u32 index = find_index_for_insert(key, hash);
+
+        if (hashes()[index] >= FIRST_VALID_HASH) {
+            values()[index] = std::forward<Val>(val);
+            return;
+        }
+
+        place_entry(index, std::forward<Key>(key), std::forward<Val>(val), hash);
+    }
+
+    // put without update
+    template<typename Key, typename Val>
+    bool put_if_empty(Key&& key, Val&& val) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        grow_if_needed();
+
+        u32 hash = hash_inner(key);
+        u32 index = find_index_for_insert(key, hash);
+
+        if (hashes()[index] >= FIRST_VALID_HASH) {
+            return false;
+        }
+
+        place_entry(index, std::forward<Key>(key), std::forward<Val>(val), hash);
+        return true;
+    }
+
+    V* get(ConstLRefOrValType<K> key) noexcept {
+        u32 index = find_index(key);
+        if (index == INVALID_INDEX) {
+            return nullptr;
+        }
+
+        return values() + index;
+    }
+
+    bool has(ConstLRefOrValType<K> key) noexcept {
+        return find_index(key) != INVALID_INDEX;
+    }
+
+    bool remove(ConstLRefOrValType<K> key) noexcept {
+        u32 index = find_index(key);
+        if (index == INVALID_INDEX) {
+            return false;
+        }
+
+        destroy_entry(index);
+        // FREE_HASH here would cut probe chains of entries placed after this one
+        hashes()[index] = TOMBSTONE_HASH;
+        ++_tombstone_count;
+        --_count;
+
+        return true;
+    }
+
+    void reserve(u32 new_count) noexcept {
+        SF_ASSERT_MSG(_allocator, "Allocator should be set");
+        u32 new_capacity = capacity_for(new_count);
+        if (new_capacity > _capacity) {
+            resize(new_capacity);
+        }
+    }
+
+    bool is_empty() const noexcept { return _capacity == 0 || _count == 0; }
+
+    constexpr u32 count() const noexcept { return _count; }
+    constexpr u32 size_in_bytes() const noexcept { return (sizeof(u32) + sizeof(K) + sizeof(V)) * _count; }
+    constexpr u32 capacity() const noexcept { return _capacity; }
+    constexpr u32 capacity_remain() const noexcept { return _capacity - _count; }
+
+    Iterator begin() noexcept {
+        if (_capacity == 0) {
+            return Iterator{nullptr, nullptr, nullptr, 0, 0};
+        }
+        return Iterator{hashes(), keys(), values(), 0, _capacity};
+    }
+
+    Iterator end() noexcept {
+        if (_capacity == 0) {
+            return Iterator{nullptr, nullptr, nullptr, 0, 0};
+        }
+        return Iterator{hashes(), keys(), values(), _capacity, _capacity};
+    }
+private:
+    static constexpr u32 INVALID_INDEX = UINT32_MAX;
+
+    u8* access_data() const noexcept {
+        if constexpr (USE_HANDLE) {
+            return static_cast<u8*>(_allocator->handle_to_ptr(_data.handle));
+        } else {
+            return _data.ptr;
+        }
+    }
+
+    u32* hashes() const noexcept { return reinterpret_cast<u32*>(access_data()); }
+    K* keys() const noexcept { return reinterpret_cast<K*>(access_data() + keys_offset(_capacity)); }
+    V* values() const noexcept { return reinterpret_cast<V*>(access_data() + values_offset(_capacity)); }
+
+    static constexpr usize align_up(usize offset, usize alignment) noexcept {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+
+    static constexpr usize keys_offset(u32 capacity) noexcept {
+        return align_up(static_cast<usize>(capacity) * sizeof(u32), alignof(K));
+    }
+
+    static constexpr usize values_offset(u32 capacity) noexcept {
+        return align_up(keys_offset(capacity) + static_cast<usize>(capacity) * sizeof(K), alignof(V));
+    }
+
+    static constexpr usize block_size(u32 capacity) noexcept {
+        return values_offset(capacity) + static_cast<usize>(capacity) * sizeof(V);
+    }
+
+    u32 max_load(u32 capacity) const noexcept {
+        return std::min(static_cast<u32>(capacity * _config.load_factor), capacity - 1);
+    }
+
+    u32 capacity_for(u32 count) const noexcept {
+        u32 capacity = std::max(next_power_of_2(count), 8u);
+        while (max_load(capacity) < count) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void reset_empty() noexcept {
+        if constexpr (USE_HANDLE) {
+            _data.handle = INVALID_ALLOC_HANDLE;
+        } else {
+            _data.ptr = nullptr;
+        }
+        _capacity = 0;
+        _count = 0;
+        _tombstone_count = 0;
+    }
+
+    void destroy_entry(u32 index) noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K>) {
+            keys()[index].~K();
+        }
+        if constexpr (!std::is_trivially_destructible_v<V>) {
+            values()[index].~V();
+        }
+    }
+
+    void destroy_entries() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K> || !std::is_trivially_destructible_v<V>) {
+            u32* h = hashes();
+            for (u32 i{0}; i < _capacity; ++i) {
+                if (h[i] >= FIRST_VALID_HASH) {
+                    destroy_entry(i);
+                }
+            }
+        }
+    }
+
+    void resize_empty(u32 new_capacity) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        // index_hash masks with capacity - 1
+        _capacity = std::max(next_power_of_2(new_capacity), 8u);
+
+        if constexpr (USE_HANDLE) {
+            _data.handle = _allocator->allocate_handle(block_size(_capacity), BLOCK_ALIGNMENT);
+        } else {
+            _data.ptr = static_cast<u8*>(_allocator->allocate(block_size(_capacity), BLOCK_ALIGNMENT));
+        }
+
+        sf_mem_zero(hashes(), _capacity * sizeof(u32));
+        _count = 0;
+        _tombstone_count = 0;
+    }
+
+    // stored hashes carry the bucket index, so entries move without rehashing keys
+    void resize(u32 new_capacity) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+
+        u32 old_capacity = _capacity;
+        Data old_data = _data;
+        u32 old_count = _count;
+
+        resize_empty(new_capacity);
+
+        // block may have moved if allocator reallocated its buffer (handle allocators)
+        u8* old_block = nullptr;
+        if (old_capacity > 0) {
+            if constexpr (USE_HANDLE) {
+                old_block = static_cast<u8*>(_allocator->handle_to_ptr(old_data.handle));
+            } else {
+                old_block = old_data.ptr;
+            }
+        }
+        u32* old_hashes = reinterpret_cast<u32*>(old_block);
+        K* old_keys = reinterpret_cast<K*>(old_block + keys_offset(old_capacity));
+        V* old_values = reinterpret_cast<V*>(old_block + values_offset(old_capacity));
+
+        u32* new_hashes = hashes();
+        K* new_keys = keys();
+        V* new_values = values();
+
+        for (u32 i{0}; i < old_capacity; ++i) {
+            u32 hash = old_hashes[i];
+            if (hash < FIRST_VALID_HASH) {
+                continue;
+            }
+
+            u32 index = index_hash(hash);
+            while (new_hashes[index] != FREE_HASH) {
+                index = (index + 1) & (_capacity - 1);
+            }
+
+            new_hashes[index] = hash;
+            ::new (new_keys + index) K(std::move(old_keys[i]));
+            ::new (new_values + index) V(std::move(old_values[i]));
+            if constexpr (!std::is_trivially_destructible_v<K>) {
+                old_keys[i].~K();
+            }
+            if constexpr (!std::is_trivially_destructible_v<V>) {
+                old_values[i].~V();
+            }
+        }
+
+        _count = old_count;
+
+        if (old_capacity > 0) {
+            if constexpr (USE_HANDLE) {
+                _allocator->free_handle(old_data.handle, BLOCK_ALIGNMENT);
+            } else {
+                _allocator->free(old_data.ptr, BLOCK_ALIGNMENT);
+            }
+        }
+    }
+
+    void grow_if_needed() noexcept {
+        if (_count + _tombstone_count >= max_load(_capacity)) {
+            // mostly tombstones: rehash at the same capacity to reclaim them
+            resize(_tombstone_count > _count ? _capacity : static_cast<u32>(_capacity * _config.grow_factor));
+        }
+    }
+
+    u32 find_index(ConstLRefOrValType<K> key) const noexcept {
+        if (_capacity == 0) {
+            return INVALID_INDEX;
+        }
+
+        u32 hash = hash_inner(key);
+        const u32* h = hashes();
+        const K* k = keys();
+        u32 mask = _capacity - 1;
+
+        for (u32 n{0}, index = index_hash(hash); n < _capacity; ++n, index = (index + 1) & mask) {
+            if (h[index] == hash && _equal(key, k[index])) {
+                return index;
+            }
+            if (h[index] == FREE_HASH) {
+                return INVALID_INDEX;
+            }
+        }
+
+        return INVALID_INDEX;
+    }
+
+    // returns the index holding the key, or the first reusable (free or tombstone) index
+    // on its probe chain; the whole chain is checked before a tombstone is reused
+    u32 find_index_for_insert(ConstLRefOrValType<K> key, u32 hash) const noexcept {
+        const u32* h = hashes();
+        const K* k = keys();
+        u32 mask = _capacity - 1;
+        u32 first_tombstone = INVALID_INDEX;
+
+        for (u32 n{0}, index = index_hash(hash); n < _capacity; ++n, index = (index + 1) & mask) {
+            if (h[index] == FREE_HASH) {
+                return first_tombstone != INVALID_INDEX ? first_tombstone : index;
+            }
+            if (h[index] == TOMBSTONE_HASH) {
+                if (first_tombstone == INVALID_INDEX) {
+                    first_tombstone = index;
+                }
+            } else if (h[index] == hash && _equal(key, k[index])) {
+                return index;
+            }
+        }
+
+        SF_ASSERT_MSG(first_tombstone != INVALID_INDEX, "Should have empty space");
+        return first_tombstone;
+    }
+
+    template<typename Key, typename Val>
+    void place_entry(u32 index, Key&& key, Val&& val, u32 hash) noexcept {
+        u32* h = hashes();
+        if (h[index] == TOMBSTONE_HASH) {
+            --_tombstone_count;
+        }
+        h[index] = hash;
+        ::new (keys() + index) K(std::forward<Key>(key));
+        ::new (values() + index) V(std::forward<Val>(val));
+        ++_count;
+    }
+
+    // folds the 64-bit hash so both halves decide bucket and match
+    u32 hash_inner(ConstLRefOrValType<K> key) const noexcept {
+        u64 hash = _hasher(key);
+        return std::max(static_cast<u32>(hash ^ (hash >> 32)), FIRST_VALID_HASH);
+    }
+
+    u32 index_hash(u32 hash) const noexcept {
+        return hash & (_capacity - 1);
+    }
+};
+
+} // sf
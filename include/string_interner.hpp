@@ -0,0 +1,193 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "arena_allocator.hpp"
+#include "dynamic_array.hpp"
+#include "general_purpose_allocator.hpp"
+#include "hash.hpp"
+#include "traits.hpp"
+#include "constants.hpp"
+#include "defines.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <algorithm>
+#include <string_view>
+
+namespace sf {
+
+// Interned string id, equal symbols of one interner mean equal strings. Trivially
+// copyable and 4 bytes, so DefaultHasher/DefaultEqual hash and compare the id alone.
+struct Symbol {
+    u32 id;
+
+    constexpr bool operator==(const Symbol& rhs) const noexcept = default;
+    constexpr bool is_valid() const noexcept;
+};
+
+inline constexpr Symbol INVALID_SYMBOL{ UINT32_MAX };
+
+constexpr bool Symbol::is_valid() const noexcept {
+    return id != INVALID_SYMBOL.id;
+}
+
+// Deduplicating string table. Every distinct string is copied once, null terminated,
+// into the string allocator (usually an ArenaAllocator or LinearAllocator the caller
+// owns and frees in bulk) and gets the next u32 id. Id to string is an array lookup;
+// string to id probes an open addressing index of (hash, id) slots kept under half full.
+// Strings live as long as the allocator does, the interner never frees them.
+template<AllocatorTrait Allocator = ArenaAllocator>
+struct StringInterner {
+public:
+    struct Entry {
+        // pointer for arenas, handle for allocators which move their buffer (LinearAllocator)
+        union {
+            const char* ptr;
+            usize       handle;
+        };
+        u32 length;
+        u32 hash;
+    };
+
+    struct Slot {
+        u32 hash;
+        u32 id;
+    };
+
+    static constexpr u32 EMPTY_HASH = 0;
+    static constexpr u32 MIN_SLOT_COUNT = 64;
+    static constexpr bool USE_HANDLE = Allocator::using_handle();
+private:
+    Allocator*                                       _allocator;
+    DynamicArray<Entry, GeneralPurposeAllocator>     _entries;
+    DynamicArray<Slot, GeneralPurposeAllocator>      _slots;
+public:
+    explicit StringInterner(Allocator* string_allocator) noexcept
+        : _allocator{string_allocator}
+        , _entries{get_current_gpa()}
+        , _slots{MIN_SLOT_COUNT, MIN_SLOT_COUNT, get_current_gpa()}
+    {
+        SF_ASSERT_MSG(string_allocator, "Should be valid pointer");
+        _slots.fill(Slot{ .hash = EMPTY_HASH, .id = 0 });
+    }
+
+    StringInterner(StringInterner&& rhs) noexcept = default;
+    StringInterner& operator=(StringInterner&& rhs) noexcept = default;
+    StringInterner(const StringInterner& rhs) = delete;
+    StringInterner& operator=(const StringInterner& rhs) = delete;
+
+    // id of the string, copied in on first sight
+    Symbol intern(std::string_view str) noexcept {
+        u32 hash = hash_of(str);
+        u32 mask = _slots.count() - 1;
+        u32 index = hash & mask;
+        for (; _slots[index].hash != EMPTY_HASH; index = (index + 1) & mask) {
+            if (_slots[index].hash == hash && view_of(_entries[_slots[index].id]) == str) {
+                return Symbol{ _slots[index].id };
+            }
+        }
+
+        SF_ASSERT_MSG(str.size() < UINT32_MAX, "String is too long to intern");
+        u32 id = _entries.count();
+        SF_ASSERT_MSG(id != INVALID_SYMBOL.id, "Interner is out of symbol ids");
+        _entries.append(copy_string(str, hash));
+        _slots[index] = Slot{ .hash = hash, .id = id };
+
+        if ((_entries.count() + 1) * 2 > _slots.count()) {
+            rehash(_slots.count() * 2);
+        }
+        return Symbol{ id };
+    }
+
+    // INVALID_SYMBOL when the string was never interned, nothing is copied
+    Symbol find(std::string_view str) const noexcept {
+        u32 hash = hash_of(str);
+        u32 mask = _slots.count() - 1;
+        for (u32 index = hash & mask; _slots[index].hash != EMPTY_HASH; index = (index + 1) & mask) {
+            if (_slots[index].hash == hash && view_of(_entries[_slots[index].id]) == str) {
+                return Symbol{ _slots[index].id };
+            }
+        }
+        return INVALID_SYMBOL;
+    }
+
+    std::string_view view(Symbol symbol) const noexcept {
+        SF_ASSERT_MSG(symbol.id < _entries.count(), "Symbol is not from this interner");
+        return view_of(_entries[symbol.id]);
+    }
+
+    // view(symbol).data() is null terminated as well
+    const char* c_str(Symbol symbol) const noexcept {
+        return view(symbol).data();
+    }
+
+    bool contains(std::string_view str) const noexcept {
+        return find(str).is_valid();
+    }
+
+    // keeps the string allocator untouched, clear or rewind it separately to reclaim the bytes
+    void clear() noexcept {
+        _entries.clear();
+        _slots.fill(Slot{ .hash = EMPTY_HASH, .id = 0 });
+    }
+
+    void reserve(u32 count) noexcept {
+        _entries.reserve(count);
+        u32 needed = next_power_of_2(std::max(count * 2 + 2, MIN_SLOT_COUNT));
+        if (needed > _slots.count()) {
+            rehash(needed);
+        }
+    }
+
+    bool is_empty() const noexcept { return _entries.count() == 0; }
+    u32 count() const noexcept { return _entries.count(); }
+private:
+    static u32 hash_of(std::string_view str) noexcept {
+        u64 hash = hash_bytes(str.data(), str.size(), DEFAULT_HASH_SEED);
+        return std::max(static_cast<u32>(hash ^ (hash >> 32)), 1u);
+    }
+
+    std::string_view view_of(const Entry& entry) const noexcept {
+        if constexpr (USE_HANDLE) {
+            return std::string_view{ static_cast<const char*>(_allocator->handle_to_ptr(entry.handle)), entry.length };
+        } else {
+            return std::string_view{ entry.ptr, entry.length };
+        }
+    }
+
+    Entry copy_string(std::string_view str, u32 hash) noexcept {
+        Entry entry;
+        char* dest;
+        if constexpr (USE_HANDLE) {
+            entry.handle = _allocator->allocate_handle(str.size() + 1, alignof(char));
+            dest = static_cast<char*>(_allocator->handle_to_ptr(entry.handle));
+        } else {
+            dest = static_cast<char*>(_allocator->allocate(str.size() + 1, alignof(char)));
+            entry.ptr = dest;
+        }
+        SF_ASSERT_MSG(dest, "String allocator is out of memory");
+        if (!str.empty()) {
+            sf_mem_copy(dest, (void*)str.data(), str.size());
+        }
+        dest[str.size()] = '\0';
+        entry.length = static_cast<u32>(str.size());
+        entry.hash = hash;
+        return entry;
+    }
+
+    // ids never change, only slots move
+    void rehash(u32 new_slot_count) noexcept {
+        DynamicArray<Slot, GeneralPurposeAllocator> slots{new_slot_count, new_slot_count, get_current_gpa()};
+        slots.fill(Slot{ .hash = EMPTY_HASH, .id = 0 });
+        u32 mask = new_slot_count - 1;
+        for (u32 id{0}; id < _entries.count(); ++id) {
+            u32 index = _entries[id].hash & mask;
+            while (slots[index].hash != EMPTY_HASH) {
+                index = (index + 1) & mask;
+            }
+            slots[index] = Slot{ .hash = _entries[id].hash, .id = id };
+        }
+        _slots = std::move(slots);
+    }
+};
+
+} // sf
@@ -0,0 +1,626 @@
+#pragma once
+
+#include "asserts_sf.hpp"
+#include "general_purpose_allocator.hpp"
+#include "hashmap.hpp"
+#include "traits.hpp"
+#include "constants.hpp"
+#include "defines.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <algorithm>
+#include <bit>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SF_SWISS_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SF_SWISS_SSE2 1
+#endif
+
+namespace sf {
+
+// Swiss-table layout: one control byte per slot lives in a separate array,
+// holding 7 bits of hash for full slots or an EMPTY/DELETED marker.
+// Probing scans a whole group of control bytes at once and touches
+// key/value payload only for slots whose tag matched.
+namespace swiss {
+
+static constexpr u8 CTRL_EMPTY   = 0x80;
+static constexpr u8 CTRL_DELETED = 0xFE;
+
+constexpr bool is_full(u8 ctrl) noexcept { return (ctrl & 0x80) == 0; }
+
+constexpr u64 h1(u64 hash) noexcept { return hash >> 7; }
+constexpr u8  h2(u64 hash) noexcept { return static_cast<u8>(hash & 0x7F); }
+
+// bit i of mask is set when slot i of the group matched
+struct BitMask {
+    u32 mask;
+
+    constexpr bool has_any() const noexcept { return mask != 0; }
+    constexpr u32 lowest() const noexcept { return static_cast<u32>(std::countr_zero(mask)); }
+    constexpr void clear_lowest() noexcept { mask &= mask - 1; }
+};
+
+#if defined(SF_SWISS_AVX2)
+
+struct Group {
+    static constexpr u32 WIDTH = 32;
+    __m256i ctrl;
+
+    explicit Group(const u8* pos) noexcept
+        : ctrl{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos)) }
+    {}
+
+    BitMask match(u8 tag) const noexcept {
+        return { static_cast<u32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_set1_epi8(static_cast<char>(tag)), ctrl))) };
+    }
+
+    BitMask match_empty() const noexcept {
+        return match(CTRL_EMPTY);
+    }
+
+    // EMPTY and DELETED are the only control values with the high bit set
+    BitMask match_empty_or_deleted() const noexcept {
+        return { static_cast<u32>(_mm256_movemask_epi8(ctrl)) };
+    }
+};
+
+#elif defined(SF_SWISS_SSE2)
+
+struct Group {
+    static constexpr u32 WIDTH = 16;
+    __m128i ctrl;
+
+    explicit Group(const u8* pos) noexcept
+        : ctrl{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)) }
+    {}
+
+    BitMask match(u8 tag) const noexcept {
+        return { static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(tag)), ctrl))) };
+    }
+
+    BitMask match_empty() const noexcept {
+        return match(CTRL_EMPTY);
+    }
+
+    // EMPTY and DELETED are the only control values with the high bit set
+    BitMask match_empty_or_deleted() const noexcept {
+        return { static_cast<u32>(_mm_movemask_epi8(ctrl)) };
+    }
+};
+
+#else
+
+// portable fallback: 8 control bytes per u64 word (SWAR)
+struct Group {
+    static constexpr u32 WIDTH = 8;
+    static constexpr u64 LSBS = 0x0101010101010101ull;
+    static constexpr u64 MSBS = 0x8080808080808080ull;
+    u64 ctrl;
+
+    explicit Group(const u8* pos) noexcept {
+        sf_mem_copy(&ctrl, const_cast<u8*>(pos), sizeof(u64));
+    }
+
+    // gathers the high bit of every byte into the low 8 bits
+    static constexpr u32 pack(u64 high_bits) noexcept {
+        return static_cast<u32>(((high_bits >> 7) * 0x0102040810204080ull) >> 56);
+    }
+
+    // may report false positives, those are filtered by key comparison
+    BitMask match(u8 tag) const noexcept {
+        u64 x = ctrl ^ (LSBS * tag);
+        return { pack((x - LSBS) & ~x & MSBS) };
+    }
+
+    BitMask match_empty() const noexcept {
+        return { pack(ctrl & ~(ctrl << 6) & MSBS) };
+    }
+
+    BitMask match_empty_or_deleted() const noexcept {
+        return { pack(ctrl & MSBS) };
+    }
+};
+
+#endif
+
+} // swiss
+
+template<typename K, typename V, AllocatorTrait Allocator = GeneralPurposeAllocator, u32 DEFAULT_INIT_CAPACITY = 32, HasherTrait<K> Hasher = DefaultHasher<K>, KeyEqualTrait<K> KeyEqual = DefaultEqual<K>>
+struct SwissHashMap {
+public:
+    using KeyType = K;
+    using ValueType = V;
+    using Group = swiss::Group;
+
+    struct Slot {
+        K key;
+        V value;
+    };
+
+    union Data {
+        u8* ptr;
+        u32 handle;
+    };
+
+    struct Iterator {
+    private:
+        const u8* _ctrl;
+        Slot*     _slot;
+        Slot*     _end;
+    public:
+        Iterator(const u8* ctrl, Slot* slot, Slot* end) noexcept
+            : _ctrl{ctrl}
+            , _slot{slot}
+            , _end{end}
+        {
+            skip_empty();
+        }
+
+        Slot& operator*() const noexcept { return *_slot; }
+        Slot* operator->() const noexcept { return _slot; }
+
+        Iterator& operator++() noexcept {
+            ++_ctrl;
+            ++_slot;
+            skip_empty();
+            return *this;
+        }
+
+        friend bool operator==(const Iterator& first, const Iterator& second) noexcept {
+            return first._slot == second._slot;
+        }
+
+        friend bool operator!=(const Iterator& first, const Iterator& second) noexcept {
+            return first._slot != second._slot;
+        }
+    private:
+        void skip_empty() noexcept {
+            while (_slot != _end && !swiss::is_full(*_ctrl)) {
+                ++_ctrl;
+                ++_slot;
+            }
+        }
+    };
+private:
+    // control bytes followed by slots, in one allocation
+    Allocator*          _allocator;
+    Data                _data;
+    u32                 _capacity;
+    u32                 _count;
+    // inserts left before we hit the load factor, deleted slots are not given back
+    u32                 _growth_left;
+    HashMapConfig       _config;
+    [[no_unique_address]] Hasher   _hasher;
+    [[no_unique_address]] KeyEqual _equal;
+public:
+    static constexpr bool USE_HANDLE = Allocator::using_handle();
+    static constexpr u32 MIN_CAPACITY = Group::WIDTH;
+    static constexpr u16 BLOCK_ALIGNMENT = static_cast<u16>(std::max<usize>(alignof(Slot), Group::WIDTH));
+
+    SwissHashMap(const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{get_current_gpa()}
+        , _capacity{0}
+        , _count{0}
+        , _growth_left{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        SF_ASSERT(config.load_factor > 0.0f && config.load_factor < 1.0f);
+        resize_empty(DEFAULT_INIT_CAPACITY);
+    }
+
+    SwissHashMap(Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _capacity{0}
+        , _count{0}
+        , _growth_left{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        SF_ASSERT(config.load_factor > 0.0f && config.load_factor < 1.0f);
+        resize_empty(DEFAULT_INIT_CAPACITY);
+    }
+
+    SwissHashMap(u32 prealloc_count, Allocator* allocator, const HashMapConfig& config = get_default_config(), Hasher hasher = {}, KeyEqual equal = {})
+        : _allocator{allocator}
+        , _capacity{0}
+        , _count{0}
+        , _growth_left{0}
+        , _config{config}
+        , _hasher{hasher}
+        , _equal{equal}
+    {
+        SF_ASSERT(config.grow_factor > 1.0f);
+        SF_ASSERT(config.load_factor > 0.0f && config.load_factor < 1.0f);
+        resize_empty(capacity_for(prealloc_count));
+    }
+
+    SwissHashMap(SwissHashMap&& rhs) noexcept
+        : _allocator{rhs._allocator}
+        , _data{rhs._data}
+        , _capacity{rhs._capacity}
+        , _count{rhs._count}
+        , _growth_left{rhs._growth_left}
+        , _config{rhs._config}
+        , _hasher{rhs._hasher}
+        , _equal{rhs._equal}
+    {
+        rhs.reset_empty();
+    }
+
+    SwissHashMap& operator=(SwissHashMap&& rhs) noexcept
+    {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        free();
+
+        _allocator = rhs._allocator;
+        _data = rhs._data;
+        _capacity = rhs._capacity;
+        _count = rhs._count;
+        _growth_left = rhs._growth_left;
+        _config = rhs._config;
+        _hasher = rhs._hasher;
+        _equal = rhs._equal;
+
+        rhs.reset_empty();
+        return *this;
+    }
+
+    SwissHashMap(const SwissHashMap& rhs) = delete;
+    SwissHashMap& operator=(const SwissHashMap& rhs) = delete;
+
+    ~SwissHashMap() noexcept {
+        free();
+    }
+
+    void free() noexcept {
+        if (_capacity == 0) {
+            return;
+        }
+
+        destroy_slots();
+        if constexpr (USE_HANDLE) {
+            _allocator->free_handle(_data.handle, BLOCK_ALIGNMENT);
+        } else {
+            _allocator->free(_data.ptr, BLOCK_ALIGNMENT);
+        }
+        reset_empty();
+    }
+
+    void clear() noexcept {
+        if (_capacity == 0) {
+            return;
+        }
+
+        destroy_slots();
+        sf_mem_set(ctrl(), _capacity, swiss::CTRL_EMPTY);
+        _count = 0;
+        _growth_left = max_load(_capacity);
+    }
+
+    void set_allocator(Allocator* alloc) noexcept {
+        SF_ASSERT_MSG(alloc, "Should be valid pointer");
+        _allocator = alloc;
+    }
+
+    // updates entry with the same key
+    template<typename Key, typename Val>
+    void put(Key&& key, Val&& val) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        u64 hash = _hasher(key);
+        Slot* slot = find_slot(key, hash);
+
+        if (slot) {
+            slot->value = std::forward<Val>(val);
+            return;
+        }
+
+        insert_new(hash, std::forward<Key>(key), std::forward<Val>(val));
+    }
+
+    // put without update
+    template<typename Key, typename Val>
+    bool put_if_empty(Key&& key, Val&& val) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        u64 hash = _hasher(key);
+
+        if (find_slot(key, hash)) {
+            return false;
+        }
+
+        insert_new(hash, std::forward<Key>(key), std::forward<Val>(val));
+        return true;
+    }
+
+    V* get(ConstLRefOrValType<K> key) noexcept {
+        Slot* slot = find_slot(key, _hasher(key));
+        if (!slot) {
+            return nullptr;
+        }
+
+        return &slot->value;
+    }
+
+    bool has(ConstLRefOrValType<K> key) noexcept {
+        return find_slot(key, _hasher(key)) != nullptr;
+    }
+
+    bool remove(ConstLRefOrValType<K> key) noexcept {
+        Slot* slot = find_slot(key, _hasher(key));
+        if (!slot) {
+            return false;
+        }
+
+        u32 index = static_cast<u32>(slot - slots());
+        destroy_slot(slot);
+        --_count;
+
+        // a group with an empty byte was never full, so no probe sequence
+        // could have passed through it and the slot can become empty again
+        u8* ctrl_bytes = ctrl();
+        u32 group_start = index & ~(Group::WIDTH - 1);
+        if (Group{ctrl_bytes + group_start}.match_empty().has_any()) {
+            ctrl_bytes[index] = swiss::CTRL_EMPTY;
+            ++_growth_left;
+        } else {
+            ctrl_bytes[index] = swiss::CTRL_DELETED;
+        }
+
+        return true;
+    }
+
+    void reserve(u32 new_count) noexcept {
+        SF_ASSERT_MSG(_allocator, "Allocator should be set");
+        u32 new_capacity = capacity_for(new_count);
+        if (new_capacity > _capacity) {
+            rehash(new_capacity);
+        }
+    }
+
+    bool is_empty() const noexcept { return _capacity == 0 || _count == 0; }
+
+    constexpr u32 count() const noexcept { return _count; }
+    constexpr u32 size_in_bytes() const noexcept { return sizeof(Slot) * _count; }
+    constexpr u32 capacity() const noexcept { return _capacity; }
+    constexpr u32 capacity_remain() const noexcept { return _capacity - _count; }
+
+    Iterator begin() noexcept {
+        if (_capacity == 0) {
+            return Iterator{nullptr, nullptr, nullptr};
+        }
+        Slot* s = slots();
+        return Iterator{ctrl(), s, s + _capacity};
+    }
+
+    Iterator end() noexcept {
+        if (_capacity == 0) {
+            return Iterator{nullptr, nullptr, nullptr};
+        }
+        Slot* s = slots() + _capacity;
+        return Iterator{ctrl() + _capacity, s, s};
+    }
+private:
+    u8* access_data() const noexcept {
+        if constexpr (USE_HANDLE) {
+            return static_cast<u8*>(_allocator->handle_to_ptr(_data.handle));
+        } else {
+            return _data.ptr;
+        }
+    }
+
+    u8* ctrl() const noexcept { return access_data(); }
+    Slot* slots() const noexcept { return reinterpret_cast<Slot*>(access_data() + slots_offset(_capacity)); }
+
+    static constexpr usize slots_offset(u32 capacity) noexcept {
+        return (static_cast<usize>(capacity) + alignof(Slot) - 1) & ~(alignof(Slot) - 1);
+    }
+
+    static constexpr usize block_size(u32 capacity) noexcept {
+        return slots_offset(capacity) + static_cast<usize>(capacity) * sizeof(Slot);
+    }
+
+    u32 max_load(u32 capacity) const noexcept {
+        return std::min(static_cast<u32>(capacity * _config.load_factor), capacity - 1);
+    }
+
+    u32 capacity_for(u32 count) const noexcept {
+        u32 capacity = std::max(next_power_of_2(count), MIN_CAPACITY);
+        while (max_load(capacity) < count) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void reset_empty() noexcept {
+        if constexpr (USE_HANDLE) {
+            _data.handle = INVALID_ALLOC_HANDLE;
+        } else {
+            _data.ptr = nullptr;
+        }
+        _capacity = 0;
+        _count = 0;
+        _growth_left = 0;
+    }
+
+    void destroy_slot(Slot* slot) noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K>) {
+            slot->key.~K();
+        }
+        if constexpr (!std::is_trivially_destructible_v<V>) {
+            slot->value.~V();
+        }
+    }
+
+    void destroy_slots() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<K> || !std::is_trivially_destructible_v<V>) {
+            u8* ctrl_bytes = ctrl();
+            Slot* s = slots();
+            for (u32 i{0}; i < _capacity; ++i) {
+                if (swiss::is_full(ctrl_bytes[i])) {
+                    destroy_slot(s + i);
+                }
+            }
+        }
+    }
+
+    void resize_empty(u32 new_capacity) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+        _capacity = std::max(next_power_of_2(new_capacity), MIN_CAPACITY);
+
+        if constexpr (USE_HANDLE) {
+            _data.handle = _allocator->allocate_handle(block_size(_capacity), BLOCK_ALIGNMENT);
+        } else {
+            _data.ptr = static_cast<u8*>(_allocator->allocate(block_size(_capacity), BLOCK_ALIGNMENT));
+        }
+
+        sf_mem_set(ctrl(), _capacity, swiss::CTRL_EMPTY);
+        _count = 0;
+        _growth_left = max_load(_capacity);
+    }
+
+    // moves every live slot into a fresh table, dropping DELETED markers
+    void rehash(u32 new_capacity) noexcept {
+        SF_ASSERT_MSG(_allocator, "Should be valid pointer");
+
+        u32 old_capacity = _capacity;
+        Data old_data = _data;
+        u8* old_ctrl = nullptr;
+        Slot* old_slots = nullptr;
+        if (old_capacity > 0) {
+            old_ctrl = ctrl();
+            old_slots = slots();
+        }
+        u32 old_count = _count;
+
+        resize_empty(new_capacity);
+
+        // block may have moved if allocator reallocated its buffer (handle allocators)
+        if constexpr (USE_HANDLE) {
+            if (old_capacity > 0) {
+                old_ctrl = static_cast<u8*>(_allocator->handle_to_ptr(old_data.handle));
+                old_slots = reinterpret_cast<Slot*>(old_ctrl + slots_offset(old_capacity));
+            }
+        }
+
+        u8* new_ctrl = ctrl();
+        Slot* new_slots = slots();
+
+        for (u32 i{0}; i < old_capacity; ++i) {
+            if (!swiss::is_full(old_ctrl[i])) {
+                continue;
+            }
+
+            Slot* old_slot = old_slots + i;
+            u64 hash = _hasher(old_slot->key);
+            u32 index = find_insert_index(new_ctrl, hash);
+            new_ctrl[index] = swiss::h2(hash);
+            ::new (new_slots + index) Slot{ .key = std::move(old_slot->key), .value = std::move(old_slot->value) };
+            destroy_slot(old_slot);
+        }
+
+        _count = old_count;
+        _growth_left -= old_count;
+
+        if (old_capacity > 0) {
+            if constexpr (USE_HANDLE) {
+                _allocator->free_handle(old_data.handle, BLOCK_ALIGNMENT);
+            } else {
+                _allocator->free(old_data.ptr, BLOCK_ALIGNMENT);
+            }
+        }
+    }
+
+    void rehash_and_grow() noexcept {
+        // mostly tombstones: rehash at the same size to reclaim them
+        if (_capacity > 0 && _count <= max_load(_capacity) / 2) {
+            rehash(_capacity);
+        } else {
+            rehash(std::max(static_cast<u32>(_capacity * _config.grow_factor), MIN_CAPACITY));
+        }
+    }
+
+    Slot* find_slot(ConstLRefOrValType<K> key, u64 hash) const noexcept {
+        if (_capacity == 0) {
+            return nullptr;
+        }
+
+        const u8* ctrl_bytes = ctrl();
+        Slot* s = slots();
+        u32 group_mask = (_capacity / Group::WIDTH) - 1;
+        u32 group_index = static_cast<u32>(swiss::h1(hash)) & group_mask;
+        u8 tag = swiss::h2(hash);
+
+        for (u32 step{1}; ; ++step) {
+            u32 offset = group_index * Group::WIDTH;
+            Group group{ctrl_bytes + offset};
+
+            for (swiss::BitMask match = group.match(tag); match.has_any(); match.clear_lowest()) {
+                Slot* slot = s + offset + match.lowest();
+                if (_equal(key, slot->key)) {
+                    return slot;
+                }
+            }
+
+            if (group.match_empty().has_any()) {
+                return nullptr;
+            }
+
+            // triangular probing visits every group once for power of two group counts
+            if (step > group_mask) {
+                return nullptr;
+            }
+            group_index = (group_index + step) & group_mask;
+        }
+    }
+
+    u32 find_insert_index(const u8* ctrl_bytes, u64 hash) const noexcept {
+        u32 group_mask = (_capacity / Group::WIDTH) - 1;
+        u32 group_index = static_cast<u32>(swiss::h1(hash)) & group_mask;
+
+        for (u32 step{1}; ; ++step) {
+            u32 offset = group_index * Group::WIDTH;
+            swiss::BitMask match = Group{ctrl_bytes + offset}.match_empty_or_deleted();
+            if (match.has_any()) {
+                return offset + match.lowest();
+            }
+            SF_ASSERT_MSG(step <= group_mask, "Table should always have a free slot");
+            group_index = (group_index + step) & group_mask;
+        }
+    }
+
+    template<typename Key, typename Val>
+    void insert_new(u64 hash, Key&& key, Val&& val) noexcept {
+        if (_capacity == 0) {
+            rehash_and_grow();
+        }
+
+        u32 index = find_insert_index(ctrl(), hash);
+        if (_growth_left == 0 && ctrl()[index] == swiss::CTRL_EMPTY) {
+            rehash_and_grow();
+            index = find_insert_index(ctrl(), hash);
+        }
+
+        u8* ctrl_bytes = ctrl();
+        if (ctrl_bytes[index] == swiss::CTRL_EMPTY) {
+            --_growth_left;
+        }
+        ctrl_bytes[index] = swiss::h2(hash);
+        ::new (slots() + index) Slot{ .key = std::forward<Key>(key), .value = std::forward<Val>(val) };
+        ++_count;
+    }
+};
+
+} // sf
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "traits.hpp"
+#include "defines.hpp"
+
+namespace sf {
+
+// Boundary tag in front of every block. Offsets and sizes are u32 like allocator handles,
+// and stay valid when the buffer moves on growth.
+struct TlsfBlockHeader {
+    // payload size of the physically previous block
+    u32 prev_size;
+    // payload size, multiple of ALIGN_SIZE, low bit marks a free block
+    u32 size;
+};
+
+// kept in the payload of free blocks only
+struct TlsfFreeLinks {
+    u32 prev;
+    u32 next;
+};
+
+// Two-Level Segregated Fit: free blocks are binned by power of two (first level) and
+// SL_COUNT linear steps within it (second level). Two bitmaps find the smallest non empty
+// bin that fits with two bit scans, so allocate and free are O(1) however fragmented the
+// buffer is. Freed blocks merge with free physical neighbours right away through the
+// boundary tags. Single buffer addressed by handles, like FreeList.
+struct TlsfAllocator {
+public:
+    static constexpr u32 ALIGN_SIZE_LOG2{3};
+    static constexpr u32 ALIGN_SIZE{1 << ALIGN_SIZE_LOG2};
+    static constexpr u32 SL_COUNT_LOG2{4};
+    static constexpr u32 SL_COUNT{1 << SL_COUNT_LOG2};
+    // sizes below SMALL_BLOCK_SIZE share first level 0 in ALIGN_SIZE steps
+    static constexpr u32 FL_INDEX_SHIFT{SL_COUNT_LOG2 + ALIGN_SIZE_LOG2};
+    static constexpr u32 SMALL_BLOCK_SIZE{1 << FL_INDEX_SHIFT};
+    // block sizes stay below 1 << FL_INDEX_MAX
+    static constexpr u32 FL_INDEX_MAX{31};
+    static constexpr u32 FL_COUNT{FL_INDEX_MAX - FL_INDEX_SHIFT + 1};
+
+    static constexpr u32 HEADER_SIZE{sizeof(TlsfBlockHeader)};
+    static constexpr u32 MIN_BLOCK_SIZE{sizeof(TlsfFreeLinks)};
+    // buffer base alignment, the largest alignment kept across growth
+    static constexpr u16 MAX_ALIGNMENT{64};
+    static constexpr usize DEFAULT_CAPACITY{1024 * 64};
+    static constexpr u32 NONE{0xFFFF'FFFF};
+    static constexpr u32 FREE_BIT{1};
+private:
+    u8*  _buffer;
+    u32  _capacity;
+    u32  _fl_bitmap;
+    u32  _sl_bitmap[FL_COUNT];
+    u32  _heads[FL_COUNT][SL_COUNT];
+public:
+    TlsfAllocator() noexcept;
+    TlsfAllocator(usize capacity) noexcept;
+    TlsfAllocator(TlsfAllocator&& rhs) noexcept;
+    TlsfAllocator& operator=(TlsfAllocator&& rhs) noexcept;
+    ~TlsfAllocator() noexcept;
+
+    void* allocate(usize size, u16 alignment) noexcept;
+    usize allocate_handle(usize size, u16 alignment) noexcept;
+    ReallocReturn reallocate(void* addr, usize new_size, u16 alignment) noexcept;
+    ReallocReturnHandle reallocate_handle(usize handle, usize new_size, u16 alignment) noexcept;
+    void* handle_to_ptr(usize handle) const noexcept;
+    usize ptr_to_handle(void* ptr) const noexcept;
+    void  free(void* addr, u16 alignment = 0) noexcept;
+    void  free_handle(usize handle, u16 alignment = 0) noexcept;
+    void  clear() noexcept;
+
+    // payload bytes of the block behind the handle, at least the requested size
+    u32 block_size(usize handle) const noexcept;
+    constexpr u8* begin() noexcept { return _buffer; }
+    constexpr usize capacity() const noexcept { return _capacity; }
+    static constexpr bool using_handle() noexcept { return true; }
+private:
+    TlsfBlockHeader* header(u32 block) const noexcept;
+    TlsfFreeLinks* links(u32 block) const noexcept;
+    u32 next_block(u32 block) const noexcept;
+    u32 prev_block(u32 block) const noexcept;
+    void set_size(u32 block, u32 size) noexcept;
+    void insert_free(u32 block) noexcept;
+    void remove_free(u32 block) noexcept;
+    u32 find_free(u32 size) noexcept;
+    u32 split(u32 block, u32 size) noexcept;
+    u32 merge_free_neighbours(u32 block) noexcept;
+    u32 allocate_block(u32 size, u16 alignment) noexcept;
+    void grow(u32 min_free_size) noexcept;
+};
+
+} // sf
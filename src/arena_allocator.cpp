@@ -18,10 +18,14 @@ ArenaAllocator::ArenaAllocator(GeneralPurposeAllocator& gpa)
 }
 
 void* ArenaAllocator::allocate(usize size, u16 alignment) {
+    // the header in front of every allocation needs its own alignment
+    alignment = std::max<u16>(alignment, alignof(ArenaAllocatorHeader));
     auto [region, padding] = find_sufficient_region_for_alloc(size, alignment);
 
+    // padding of a fresh region depends on where its data lands
     if (region->data == nullptr) {
-        init_new_region(region, size + padding);
+        init_new_region(region, size + alignment + sizeof(ArenaAllocatorHeader));
+        padding = calc_padding_with_header(region->data, alignment, sizeof(ArenaAllocatorHeader));
     }
 
     void* return_ptr = static_cast<void*>(region->data + region->offset + padding);
@@ -148,11 +152,13 @@ ArenaAllocator::FindSufficcientRegionReturn ArenaAllocator::find_sufficient_regi
 }
 
 void ArenaAllocator::init_new_region(Region* region, usize alloc_size) {
-    const usize alloc_size_ = std::max(alloc_size, get_mem_page_size() * static_cast<usize>(DEFAULT_REGION_CAPACITY_PAGES));
-    region->data = static_cast<u8*>(sf_mem_alloc(alloc_size, DEFAULT_ALIGNMENT));
+    // aligned_alloc wants a multiple of the alignment
+    const usize min_size = get_mem_page_size() * static_cast<usize>(DEFAULT_REGION_CAPACITY_PAGES);
+    const usize region_size = (std::max(alloc_size, min_size) + DEFAULT_ALIGNMENT - 1) & ~static_cast<usize>(DEFAULT_ALIGNMENT - 1);
+    region->data = static_cast<u8*>(sf_mem_alloc(region_size, DEFAULT_ALIGNMENT));
     region->offset = 0;
     region->prev_offset = 0;
-    region->capacity = alloc_size;
+    region->capacity = region_size;
 }
 
 ReallocReturnHandle ArenaAllocator::reallocate_handle(usize handle, usize size, u16 alignment) {
@@ -4,27 +4,104 @@
 #include "constants.hpp"
 #include "defines.hpp"
 #include "memory_sf.hpp"
+#include "slab_allocator.hpp"
 
 namespace sf {
 
 static GeneralPurposeAllocator gpa;
 
+// never destroyed, blocks may still be freed by destructors of other statics at exit
+union GlobalSlab {
+    SlabAllocator slab;
+
+    constexpr GlobalSlab() noexcept : slab{} {}
+    ~GlobalSlab() noexcept {}
+};
+
+constinit static GlobalSlab global_slab;
+
+static thread_local SlabThreadHeap* thread_heap{nullptr};
+// set once the thread flushed its heap, on demand or at exit, later requests use the
+// shared slab lists instead of adopting another heap
+static thread_local bool thread_heap_flushed{false};
+
+struct ThreadHeapGuard {
+    ~ThreadHeapGuard() noexcept {
+        gpa_flush_thread_cache();
+    }
+};
+
+static thread_local ThreadHeapGuard thread_heap_guard;
+
+// null once the thread flushed, the heap is adopted on first use
+static SlabThreadHeap* current_heap() noexcept {
+    if (thread_heap || thread_heap_flushed) {
+        return thread_heap;
+    }
+
+    // odr-use registers the destructor of the guard for this thread
+    (void)&thread_heap_guard;
+    thread_heap = global_slab.slab.adopt_heap();
+    return thread_heap;
+}
+
 GeneralPurposeAllocator* get_current_gpa()
 {
     return &gpa;
 }
 
+void gpa_flush_thread_cache() noexcept {
+    if (thread_heap) {
+        thread_heap->flush();
+        thread_heap = nullptr;
+    }
+    thread_heap_flushed = true;
+}
+
+// small requests come from the slabs, large or over aligned ones from the system
 void* GeneralPurposeAllocator::allocate(u32 size, u16 alignment) noexcept {
-    return sf_mem_alloc(size, alignment);
+    SlabThreadHeap* heap = current_heap();
+    void* ptr = heap ? heap->allocate(size, alignment) : global_slab.slab.allocate(size, alignment);
+    return ptr ? ptr : sf_mem_alloc(size, alignment);
 }
 
+// a slab block keeps its place while the new size fits its class
 ReallocReturn GeneralPurposeAllocator::reallocate(void* addr, u32 new_size, u16 alignment) noexcept {
-    return {sf_mem_realloc(addr, new_size), false};
+    if (!addr) {
+        return {allocate(new_size, alignment), false};
+    }
+
+    SlabAllocator& slab = global_slab.slab;
+    if (!slab.owns(addr)) {
+        return {sf_mem_realloc(addr, new_size), false};
+    }
+
+    u32 usable = slab.usable_size(addr);
+    if (new_size <= usable) {
+        return {addr, false};
+    }
+
+    void* new_addr = allocate(new_size, alignment);
+    sf_mem_copy(new_addr, addr, usable);
+    free(addr, alignment);
+    return {new_addr, false};
 }
 
 void GeneralPurposeAllocator::free(void* addr, u16 alignment) noexcept {
-    sf_mem_free(addr, alignment);
-    addr = nullptr;
+    if (!addr) {
+        return;
+    }
+
+    if (global_slab.slab.owns(addr)) {
+        SlabThreadHeap* heap = thread_heap;
+        if (heap) {
+            heap->free(addr);
+        } else {
+            global_slab.slab.free(addr);
+        }
+    } else {
+        sf_mem_free(addr, alignment);
+    }
 }
 
 void* GeneralPurposeAllocator::handle_to_ptr(usize handle) const noexcept {
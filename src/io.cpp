@@ -1,7 +1,18 @@
 #include "io.hpp"
 #include "defines.hpp"
+#include "memory_sf.hpp"
 #include <string_view>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace sf {
 
 std::string_view extract_extension_from_file_name(std::string_view file_name) {
@@ -114,4 +125,101 @@ std::string_view strip_part_from_start_and_extension(std::string_view file_path,
     return file_path.substr(from, to - from);
 }
 
+// string_view is not null terminated, OS calls need a copy
+static bool copy_path(std::string_view file_path, char (&buffer)[4096]) noexcept {
+    if (file_path.size() >= sizeof(buffer)) {
+        return false;
+    }
+    sf_mem_copy(buffer, (void*)file_path.data(), file_path.size());
+    buffer[file_path.size()] = '\0';
+    return true;
+}
+
+Result<MappedFile> map_file_read_only(std::string_view file_path) noexcept {
+    char path[4096];
+    if (!copy_path(file_path, path)) {
+        return {ResultError::VALUE};
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return {ResultError::VALUE};
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return {ResultError::VALUE};
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        return {ResultError::VALUE};
+    }
+
+    // the view keeps the mapping alive
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) {
+        return {ResultError::VALUE};
+    }
+
+    return MappedFile{ .data = static_cast<const u8*>(data), .size = static_cast<usize>(size.QuadPart) };
+#else
+    i32 fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return {ResultError::VALUE};
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(fd);
+        return {ResultError::VALUE};
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    void* data = mmap(nullptr, static_cast<usize>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return {ResultError::VALUE};
+    }
+
+    return MappedFile{ .data = static_cast<const u8*>(data), .size = static_cast<usize>(file_stat.st_size) };
+#endif
+}
+
+void unmap_file(MappedFile& file) noexcept {
+    if (!file.data) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(file.data);
+#else
+    munmap(const_cast<u8*>(file.data), file.size);
+#endif
+    file.data = nullptr;
+    file.size = 0;
+}
+
+bool write_file(std::string_view file_path, std::initializer_list<std::span<const u8>> parts) noexcept {
+    char path[4096];
+    if (!copy_path(file_path, path)) {
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    for (std::span<const u8> part : parts) {
+        file.write(reinterpret_cast<const char*>(part.data()), static_cast<std::streamsize>(part.size()));
+    }
+
+    return file.good();
+}
+
 } // sf
@@ -3,29 +3,50 @@
 #include "constants.hpp"
 #include "memory_sf.hpp"
 #include "utility.hpp"
+#include <algorithm>
 
 namespace sf {
 
+static constexpr usize align_up(usize size, usize alignment) noexcept {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
 LinearAllocator::LinearAllocator() noexcept
     : _capacity{ get_mem_page_size() * 10 }
     , _count{ 0 }
     , _buffer{ static_cast<u8*>(sf_mem_alloc(_capacity)) }
+    , _reserved{ 0 }
 {}
 
 LinearAllocator::LinearAllocator(usize capacity) noexcept
     : _capacity{ capacity }
     , _count{ 0 }
     , _buffer{ static_cast<u8*>(sf_mem_alloc(capacity)) }
+    , _reserved{ 0 }
 {}
 
+LinearAllocator::LinearAllocator(VirtualReserve reserve) noexcept
+    : _capacity{ 0 }
+    , _count{ 0 }
+    , _buffer{ nullptr }
+    , _reserved{ align_up(std::max<usize>(reserve.size, 1), get_mem_page_size()) }
+{
+    _buffer = static_cast<u8*>(sf_mem_reserve(_reserved));
+    if (!_buffer) {
+        panic("Failed to reserve address range");
+    }
+}
+
 LinearAllocator::LinearAllocator(LinearAllocator&& rhs) noexcept
     : _capacity{ rhs._capacity }
     , _count{ rhs._count }
     , _buffer{ rhs._buffer }
+    , _reserved{ rhs._reserved }
 {
     rhs._buffer = nullptr;
     rhs._capacity = 0;
     rhs._count = 0;
+    rhs._reserved = 0;
 }
 
 LinearAllocator& LinearAllocator::operator=(LinearAllocator&& rhs) noexcept {
@@ -33,35 +54,33 @@ LinearAllocator& LinearAllocator::operator=(LinearAllocator&& rhs) noexcept {
         return *this;
     }
     
-    if (_buffer) {
-        sf_mem_free(_buffer, _capacity);
-        _buffer = nullptr;
-    }
+    release();
 
     _buffer = rhs._buffer;
     _capacity = rhs._capacity;
     _count = rhs._count;
+    _reserved = rhs._reserved;
 
     rhs._buffer = nullptr;
     rhs._capacity = 0;
     rhs._count = 0;
+    rhs._reserved = 0;
 
     return *this;
 }
 
 LinearAllocator::~LinearAllocator() noexcept
 {
-    if (_buffer) {
-        sf_mem_free(_buffer, _capacity);
-        _buffer = nullptr;
-    }
+    release();
 }
 
 void* LinearAllocator::allocate(usize size, u16 alignment) noexcept
 {
     usize padding = sf_calc_padding(_buffer + _count, alignment);
 
-    if (_count + padding + size > _capacity) {
+    if (_count + padding + size > _capacity && _reserved) {
+        commit(_count + padding + size);
+    } else if (_count + padding + size > _capacity) {
         u32 new_capacity = _capacity == 0 ? DEFAULT_INIT_CAPACITY : _capacity * 2;
         while (_count + padding + size > new_capacity) {
             new_capacity *= 2;
@@ -77,7 +96,9 @@ void* LinearAllocator::allocate(usize size, u16 alignment) noexcept
 
 usize LinearAllocator::allocate_handle(usize size, u16 alignment) noexcept
 {
-    return turn_ptr_into_handle(allocate(size, alignment), _buffer);
+    // allocate may move _buffer, so the base must be read after it
+    void* ptr = allocate(size, alignment);
+    return turn_ptr_into_handle(ptr, _buffer);
 }
 
 ReallocReturn LinearAllocator::reallocate(void* addr, usize new_size, u16 alignment) noexcept {
@@ -107,6 +128,33 @@ void LinearAllocator::resize(usize new_capacity) noexcept {
     _capacity = new_capacity;
 }
 
+// commits at least double the current size so large buffers grow in few system calls
+void LinearAllocator::commit(usize min_capacity) noexcept {
+    if (min_capacity > _reserved) {
+        panic("Linear allocator ran out of reserved address space");
+    }
+
+    usize new_capacity = std::max(_capacity * 2, align_up(min_capacity, COMMIT_GRANULARITY));
+    new_capacity = std::min(new_capacity, _reserved);
+    if (!sf_mem_commit(_buffer + _capacity, new_capacity - _capacity)) {
+        panic("Out of memory");
+    }
+    _capacity = new_capacity;
+}
+
+void LinearAllocator::release() noexcept {
+    if (!_buffer) {
+        return;
+    }
+
+    if (_reserved) {
+        sf_mem_release(_buffer, _reserved);
+    } else {
+        sf_mem_free(_buffer, _capacity);
+    }
+    _buffer = nullptr;
+}
+
 void* LinearAllocator::handle_to_ptr(usize handle) const noexcept {
 #ifdef SF_DEBUG
     if (!is_handle_in_range(_buffer, _capacity, handle) || handle == INVALID_ALLOC_HANDLE) {
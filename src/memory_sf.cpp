@@ -6,6 +6,13 @@
 #include <new>
 #include <cstring>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
 namespace sf {
 
 void* sf_mem_alloc(usize byte_size, u16 alignment, bool zero) {
@@ -67,6 +74,43 @@ bool sf_str_cmp(const char* first, const char* second) {
     return std::strcmp(first, second) == 0;
 }
 
+void* sf_mem_reserve(usize byte_size) {
+#ifdef _WIN32
+    return VirtualAlloc(nullptr, byte_size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void* addr = mmap(nullptr, byte_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return addr == MAP_FAILED ? nullptr : addr;
+#endif
+}
+
+bool sf_mem_commit(void* addr, usize byte_size) {
+#ifdef _WIN32
+    return VirtualAlloc(addr, byte_size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    return mprotect(addr, byte_size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+void sf_mem_decommit(void* addr, usize byte_size) {
+#ifdef _WIN32
+    VirtualFree(addr, byte_size, MEM_DECOMMIT);
+#else
+    madvise(addr, byte_size, MADV_DONTNEED);
+    mprotect(addr, byte_size, PROT_NONE);
+#endif
+}
+
+void sf_mem_release(void* addr, usize byte_size) {
+    if (!addr) {
+        return;
+    }
+#ifdef _WIN32
+    VirtualFree(addr, 0, MEM_RELEASE);
+#else
+    munmap(addr, byte_size);
+#endif
+}
+
 u32 sf_calc_padding(void* address, u16 alignment) {
     void* aligned_addr = sf_align_forward(address, alignment);
     return reinterpret_cast<usize>(aligned_addr) - reinterpret_cast<usize>(address);
@@ -0,0 +1,304 @@
+#include "slab_allocator.hpp"
+#include "asserts_sf.hpp"
+#include "defines.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <new>
+
+namespace sf {
+
+// heaps still in use by threads are leaked, flush them first
+SlabAllocator::~SlabAllocator() noexcept {
+    while (_orphan_heaps) {
+        SlabThreadHeap* heap = _orphan_heaps;
+        _orphan_heaps = heap->_next_orphan;
+        heap->~SlabThreadHeap();
+        sf_mem_free(heap, alignof(SlabThreadHeap));
+    }
+    sf_mem_release(_reservation, RESERVE_SIZE + SPAN_SIZE);
+}
+
+void* SlabAllocator::allocate(usize size, u16 alignment) noexcept {
+    if (size > MAX_SIZE || alignment > MAX_ALIGNMENT) {
+        return nullptr;
+    }
+
+    reserve_range();
+    u32 size_class = size_class_of(size);
+    SizeClass& sc = _classes[size_class];
+    std::lock_guard<std::mutex> lock{sc.lock};
+
+    SlabSpan* span = sc.partial;
+    if (!span) {
+        span = acquire_span(size_class, nullptr);
+        if (!span) {
+            return nullptr;
+        }
+        push_partial(sc, span);
+    }
+
+    void* obj;
+    if (span->free_list) {
+        obj = span->free_list;
+        span->free_list = *static_cast<void**>(obj);
+    } else {
+        obj = reinterpret_cast<u8*>(span) + span->carve_offset;
+        span->carve_offset += class_size(size_class);
+    }
+
+    if (++span->used == span->capacity) {
+        unlink_partial(sc, span);
+    }
+    return obj;
+}
+
+void SlabAllocator::free(void* addr) noexcept {
+    SF_ASSERT_MSG(owns(addr), "Pointer is not from the slab range");
+    SlabSpan* span = span_of(addr);
+    // a live block keeps its span, and so its owner, from changing
+    if (SlabThreadHeap* owner = span->owner.load(std::memory_order_acquire)) {
+        owner->push_remote(addr);
+        return;
+    }
+
+    SizeClass& sc = _classes[span->size_class];
+    std::lock_guard<std::mutex> lock{sc.lock};
+
+    *static_cast<void**>(addr) = span->free_list;
+    span->free_list = addr;
+
+    bool was_full = span->used == span->capacity;
+    --span->used;
+    if (was_full) {
+        push_partial(sc, span);
+    } else if (span->used == 0 && (sc.partial != span || span->next)) {
+        // keeps the last span of a class to avoid thrashing on alloc/free pairs
+        unlink_partial(sc, span);
+        release_span(span);
+    }
+}
+
+SlabThreadHeap* SlabAllocator::adopt_heap() noexcept {
+    reserve_range();
+    {
+        std::lock_guard<std::mutex> lock{_span_lock};
+        if (_orphan_heaps) {
+            SlabThreadHeap* heap = _orphan_heaps;
+            _orphan_heaps = heap->_next_orphan;
+            heap->_next_orphan = nullptr;
+            return heap;
+        }
+    }
+
+    void* memory = sf_mem_alloc(sizeof(SlabThreadHeap), alignof(SlabThreadHeap));
+    return ::new (memory) SlabThreadHeap{this};
+}
+
+void SlabAllocator::reserve_range() noexcept {
+    std::call_once(_reserve_once, [this] {
+        // spans are found by masking, so the range starts SPAN_SIZE aligned
+        _reservation = static_cast<u8*>(sf_mem_reserve(RESERVE_SIZE + SPAN_SIZE));
+        if (_reservation) {
+            usize aligned = (reinterpret_cast<usize>(_reservation) + SPAN_SIZE - 1) & ~static_cast<usize>(SPAN_SIZE - 1);
+            _base.store(reinterpret_cast<u8*>(aligned), std::memory_order_release);
+        }
+    });
+}
+
+// reused spans have only their header page committed
+SlabSpan* SlabAllocator::acquire_span(u32 size_class, SlabThreadHeap* owner) noexcept {
+    u8* base = _base.load(std::memory_order_acquire);
+    if (!base) {
+        return nullptr;
+    }
+
+    SlabSpan* span;
+    {
+        std::lock_guard<std::mutex> lock{_span_lock};
+        if (_free_spans) {
+            span = _free_spans;
+            _free_spans = span->next;
+        } else if (_span_top + SPAN_SIZE <= RESERVE_SIZE) {
+            span = reinterpret_cast<SlabSpan*>(base + _span_top);
+            _span_top += SPAN_SIZE;
+        } else {
+            return nullptr;
+        }
+    }
+
+    if (!sf_mem_commit(span, SPAN_SIZE)) {
+        panic("Out of memory");
+    }
+
+    ::new (span) SlabSpan{
+        .prev = nullptr,
+        .next = nullptr,
+        .free_list = nullptr,
+        .owner = owner,
+        .carve_offset = SPAN_HEADER_SIZE,
+        .used = 0,
+        .capacity = (SPAN_SIZE - SPAN_HEADER_SIZE) / class_size(size_class),
+        .size_class = static_cast<u16>(size_class),
+    };
+    _span_count.fetch_add(1, std::memory_order_relaxed);
+    return span;
+}
+
+// object pages go back to the system, the header page keeps the free span link
+void SlabAllocator::release_span(SlabSpan* span) noexcept {
+    span->owner.store(nullptr, std::memory_order_relaxed);
+    sf_mem_decommit(reinterpret_cast<u8*>(span) + get_mem_page_size(), SPAN_SIZE - get_mem_page_size());
+    _span_count.fetch_sub(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock{_span_lock};
+    span->next = _free_spans;
+    _free_spans = span;
+}
+
+void SlabAllocator::push_partial(SizeClass& size_class, SlabSpan* span) noexcept {
+    span->prev = nullptr;
+    span->next = size_class.partial;
+    if (size_class.partial) {
+        size_class.partial->prev = span;
+    }
+    size_class.partial = span;
+}
+
+void SlabAllocator::unlink_partial(SizeClass& size_class, SlabSpan* span) noexcept {
+    if (span->prev) {
+        span->prev->next = span->next;
+    } else {
+        size_class.partial = span->next;
+    }
+    if (span->next) {
+        span->next->prev = span->prev;
+    }
+    span->prev = nullptr;
+    span->next = nullptr;
+}
+
+SlabThreadHeap::SlabThreadHeap(SlabAllocator* slab) noexcept
+    : _slab{slab}
+    , _spans{}
+    , _remote_free{nullptr}
+    , _next_orphan{nullptr}
+{}
+
+void* SlabThreadHeap::allocate(usize size, u16 alignment) noexcept {
+    if (size > SlabAllocator::MAX_SIZE || alignment > SlabAllocator::MAX_ALIGNMENT) {
+        return nullptr;
+    }
+
+    u32 size_class = SlabAllocator::size_class_of(size);
+    SlabSpan* span = _spans[size_class];
+    if (!span) {
+        // blocks other threads gave back may refill the class before a new span is taken
+        drain_remote();
+        span = _spans[size_class];
+        if (!span) {
+            span = _slab->acquire_span(size_class, this);
+            if (!span) {
+                return nullptr;
+            }
+            link(span);
+        }
+    }
+
+    void* obj;
+    if (span->free_list) {
+        obj = span->free_list;
+        span->free_list = *static_cast<void**>(obj);
+    } else {
+        obj = reinterpret_cast<u8*>(span) + span->carve_offset;
+        span->carve_offset += SlabAllocator::class_size(size_class);
+    }
+
+    if (++span->used == span->capacity) {
+        unlink(span);
+    }
+    return obj;
+}
+
+void SlabThreadHeap::free(void* addr) noexcept {
+    SlabSpan* span = SlabAllocator::span_of(addr);
+    if (span->owner.load(std::memory_order_relaxed) == this) {
+        free_local(span, addr);
+    } else {
+        _slab->free(addr);
+    }
+}
+
+void SlabThreadHeap::flush() noexcept {
+    drain_remote();
+    for (u32 size_class{0}; size_class < SlabAllocator::CLASS_COUNT; ++size_class) {
+        SlabSpan* span = _spans[size_class];
+        while (span) {
+            SlabSpan* next = span->next;
+            if (span->used == 0) {
+                unlink(span);
+                _slab->release_span(span);
+            }
+            span = next;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{_slab->_span_lock};
+    _next_orphan = _slab->_orphan_heaps;
+    _slab->_orphan_heaps = this;
+}
+
+// lock-free stack, any thread pushes and the owner takes all of it at once, so there is no ABA
+void SlabThreadHeap::push_remote(void* addr) noexcept {
+    void* head = _remote_free.load(std::memory_order_relaxed);
+    do {
+        *static_cast<void**>(addr) = head;
+    } while (!_remote_free.compare_exchange_weak(head, addr, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void SlabThreadHeap::drain_remote() noexcept {
+    void* block = _remote_free.exchange(nullptr, std::memory_order_acquire);
+    while (block) {
+        void* next = *static_cast<void**>(block);
+        free_local(SlabAllocator::span_of(block), block);
+        block = next;
+    }
+}
+
+void SlabThreadHeap::free_local(SlabSpan* span, void* addr) noexcept {
+    *static_cast<void**>(addr) = span->free_list;
+    span->free_list = addr;
+
+    bool was_full = span->used == span->capacity;
+    --span->used;
+    if (was_full) {
+        link(span);
+    } else if (span->used == 0 && (_spans[span->size_class] != span || span->next)) {
+        unlink(span);
+        _slab->release_span(span);
+    }
+}
+
+void SlabThreadHeap::link(SlabSpan* span) noexcept {
+    SlabSpan*& head = _spans[span->size_class];
+    span->prev = nullptr;
+    span->next = head;
+    if (head) {
+        head->prev = span;
+    }
+    head = span;
+}
+
+void SlabThreadHeap::unlink(SlabSpan* span) noexcept {
+    if (span->prev) {
+        span->prev->next = span->next;
+    } else {
+        _spans[span->size_class] = span->next;
+    }
+    if (span->next) {
+        span->next->prev = span->prev;
+    }
+    span->prev = nullptr;
+    span->next = nullptr;
+}
+
+} // sf
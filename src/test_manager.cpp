@@ -1,19 +1,40 @@
 #include <cstdlib>
+#include <cstdio>
 #ifdef SF_TESTS
 
 #include "bitset.hpp"
 #include "general_purpose_allocator.hpp"
 #include "linear_allocator.hpp"
 #include "hashmap.hpp"
+#include "swiss_hashmap.hpp"
+#include "robin_hood_hashmap.hpp"
+#include "incremental_hashmap.hpp"
+#include "split_hashmap.hpp"
+#include "concurrent_hashmap.hpp"
+#include "frozen_hashmap.hpp"
+#include "hashset.hpp"
+#include "small_hashmap.hpp"
+#include "ordered_hashmap.hpp"
+#include "cuckoo_hashmap.hpp"
+#include "hashmap_snapshot.hpp"
+#include "lru_cache.hpp"
+#include "string_interner.hpp"
 #include "dynamic_array.hpp"
 #include "logger.hpp"
 #include "test_manager.hpp"
 #include "fixed_array.hpp"
 #include "free_list_allocator.hpp"
 #include "stack_allocator.hpp"
+#include "tlsf_allocator.hpp"
+#include "pool_allocator.hpp"
+#include "slab_allocator.hpp"
 #include <string_view>
 #include <chrono>
+#include <cctype>
 #include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 namespace sf {
 
@@ -225,63 +246,1757 @@ void linear_allocator_test() {
         arr3.reserve(300);
         expect(alloc.count() >= 700 * sizeof(u8), counter);
     }
+
+    {
+        LinearAllocator reserved{VirtualReserve{usize{1} << 30}};
+        expect(reserved.is_reserved() && reserved.capacity() == 0, counter);
+        u8* base = reserved.begin();
+        u64* first = static_cast<u64*>(reserved.allocate(sizeof(u64), alignof(u64)));
+        *first = 42;
+
+        // growing past many commits keeps the buffer and earlier pointers in place
+        for (u32 i{0}; i < 1024; ++i) {
+            sf_mem_set(reserved.allocate(64 * 1024, 16), 64 * 1024, 1);
+        }
+        expect(reserved.begin() == base && *first == 42, counter);
+        expect(reserved.capacity() >= reserved.count() && reserved.capacity() <= reserved.reserved(), counter);
+
+        LinearAllocator moved{std::move(reserved)};
+        expect(moved.begin() == base && !reserved.is_reserved() && *first == 42, counter);
+        moved.clear();
+        expect(moved.allocate(8, 8) == base, counter);
+    }
+
+    {
+        constexpr u32 COUNT{64 * 1024};
+        {
+            LinearAllocator heap{};
+            Perf perf{ "Linear heap buffer 256mb in 4kb allocations" };
+            for (u32 i{0}; i < COUNT; ++i) {
+                sf_mem_set(heap.allocate(4096, 16), 64, 1);
+            }
+        }
+        {
+            LinearAllocator reserved{VirtualReserve{usize{1} << 30}};
+            Perf perf{ "Linear reserved buffer 256mb in 4kb allocations" };
+            for (u32 i{0}; i < COUNT; ++i) {
+                sf_mem_set(reserved.allocate(4096, 16), 64, 1);
+            }
+        }
+    }
+}
+
+void tlsf_allocator_test() {
+    TestCounter counter("TLSF Allocator");
+    {
+        TlsfAllocator alloc{4096};
+        usize capacity = alloc.capacity();
+        usize a = alloc.allocate_handle(100, 8);
+        usize b = alloc.allocate_handle(200, 8);
+        usize c = alloc.allocate_handle(300, 8);
+        expect(alloc.block_size(a) >= 100 && b > a && c > b, counter);
+
+        // a and c stay apart until b is freed, then all three merge with the tail
+        alloc.free_handle(a);
+        alloc.free_handle(c);
+        alloc.free_handle(b);
+        usize whole = alloc.allocate_handle(3000, 8);
+        expect(whole == a && alloc.capacity() == capacity, counter);
+        alloc.free_handle(whole);
+
+        usize aligned = alloc.allocate_handle(24, 64);
+        expect(aligned % 64 == 0 && reinterpret_cast<usize>(alloc.handle_to_ptr(aligned)) % 64 == 0, counter);
+        alloc.free_handle(aligned);
+
+        // growing into the free successor keeps the handle and the bytes
+        usize grown = alloc.allocate_handle(64, 8);
+        sf_mem_set(alloc.handle_to_ptr(grown), 64, 0x5A);
+        ReallocReturnHandle res = alloc.reallocate_handle(grown, 1024, 8);
+        u8* bytes = static_cast<u8*>(alloc.handle_to_ptr(res.handle));
+        expect(res.handle == grown && !res.should_mem_copy && bytes[0] == 0x5A && bytes[63] == 0x5A, counter);
+
+        // past the buffer it grows, handles and contents survive the move
+        usize big = alloc.allocate_handle(64 * 1024, 8);
+        bytes = static_cast<u8*>(alloc.handle_to_ptr(res.handle));
+        expect(alloc.capacity() > capacity && big != INVALID_ALLOC_HANDLE && bytes[63] == 0x5A, counter);
+    }
+
+    {
+        // the grown tail has to land in a bin the search reaches, not the one below it
+        TlsfAllocator alloc{64 * 1024};
+        usize used = alloc.allocate_handle(35895, 8);
+        usize past = alloc.allocate_handle(526765, 8);
+        expect(used != INVALID_ALLOC_HANDLE && past != INVALID_ALLOC_HANDLE && alloc.block_size(past) >= 526765, counter);
+    }
+
+    {
+        TlsfAllocator alloc{};
+        DynamicArray<u64, TlsfAllocator> arr(&alloc);
+        HashMap<u64, u64, TlsfAllocator> map{&alloc};
+        for (u64 i{0}; i < 10'000; ++i) {
+            arr.append(i);
+            map.put(i, i * 2);
+        }
+        bool valid{true};
+        for (u64 i{0}; i < 10'000; ++i) {
+            valid &= arr[i] == i && map.get(i) && *map.get(i) == i * 2;
+        }
+        expect(valid, counter);
+    }
+
+    {
+        // thousands of free fragments between live blocks, then mixed size churn
+        constexpr u32 FRAGMENTS{4000};
+        constexpr u32 OPS{4000};
+        TlsfAllocator tlsf{FRAGMENTS * 128};
+        FreeList<false> free_list{FRAGMENTS * 256};
+        usize tlsf_handles[FRAGMENTS];
+        usize list_handles[FRAGMENTS];
+        for (u32 i{0}; i < FRAGMENTS; ++i) {
+            tlsf_handles[i] = tlsf.allocate_handle(32 + (i % 7) * 8, 8);
+            list_handles[i] = free_list.allocate_handle(32 + (i % 7) * 8, 8);
+        }
+        for (u32 i{0}; i < FRAGMENTS; i += 2) {
+            tlsf.free_handle(tlsf_handles[i]);
+            free_list.free_handle(list_handles[i]);
+        }
+
+        u32 served{0};
+        {
+            Perf perf{ "FreeList 4k alloc/free over 2k fragments" };
+            for (u32 i{0}; i < OPS; ++i) {
+                usize handle = free_list.allocate_handle(64 + (i % 5) * 16, 8);
+                served += handle != INVALID_ALLOC_HANDLE;
+                free_list.free_handle(handle);
+            }
+        }
+        {
+            Perf perf{ "TLSF 4k alloc/free over 2k fragments" };
+            for (u32 i{0}; i < OPS; ++i) {
+                usize handle = tlsf.allocate_handle(64 + (i % 5) * 16, 8);
+                served += handle != INVALID_ALLOC_HANDLE;
+                tlsf.free_handle(handle);
+            }
+        }
+        expect(served == OPS * 2, counter);
+    }
+}
+
+void pool_allocator_test() {
+    TestCounter counter("Pool Allocator");
+    {
+        struct Message {
+            u64 id;
+            u32 size;
+            u8  payload[36];
+        };
+        PoolAllocator<sizeof(Message), alignof(Message)> pool{64};
+        Message* messages[200];
+        for (u32 i{0}; i < 200; ++i) {
+            messages[i] = ::new (pool.allocate(sizeof(Message), alignof(Message))) Message{ .id = i, .size = i * 2, .payload = {} };
+        }
+        bool valid{true};
+        for (u32 i{0}; i < 200; ++i) {
+            valid &= messages[i]->id == i && reinterpret_cast<usize>(messages[i]) % alignof(Message) == 0;
+        }
+        expect(valid && pool.count() == 200 && pool.chunk_count() == 4, counter);
+
+        // freed blocks are reused last in, first out, before carving anything new
+        pool.free(messages[10]);
+        pool.free(messages[20]);
+        expect(pool.allocate(sizeof(Message), alignof(Message)) == messages[20], counter);
+        expect(pool.allocate(sizeof(Message), alignof(Message)) == messages[10], counter);
+
+        usize handle = pool.ptr_to_handle(messages[130]);
+        expect(handle == 130 && pool.handle_to_ptr(handle) == messages[130], counter);
+        expect(pool.reallocate(messages[5], 8, 8).ptr == messages[5], counter);
+
+        pool.clear();
+        expect(pool.count() == 0 && pool.allocate(sizeof(Message), alignof(Message)) == messages[0] && pool.chunk_count() == 4, counter);
+    }
+
+    {
+        // fixed capacity arrays, one block each
+        PoolAllocator<32 * sizeof(u64)> pool{};
+        DynamicArray<u64, PoolAllocator<32 * sizeof(u64)>> arrays[64];
+        for (u32 i{0}; i < 64; ++i) {
+            arrays[i] = DynamicArray<u64, PoolAllocator<32 * sizeof(u64)>>(32, &pool);
+            for (u64 j{0}; j < 32; ++j) {
+                arrays[i].append(i * 100 + j);
+            }
+        }
+        bool valid{true};
+        for (u32 i{0}; i < 64; ++i) {
+            valid &= arrays[i].count() == 32 && arrays[i][31] == i * 100 + 31;
+        }
+        expect(valid && pool.count() == 64, counter);
+        for (auto& arr : arrays) {
+            arr.free();
+        }
+        expect(pool.count() == 0, counter);
+    }
+
+    {
+        constexpr u32 COUNT{1'000'000};
+        constexpr u32 LIVE{1024};
+        void* live[LIVE]{};
+        PoolAllocator<64> pool{4096};
+        GeneralPurposeAllocator* gpa = get_current_gpa();
+        {
+            Perf perf{ "GPA 1m alloc/free of 64 bytes" };
+            for (u32 i{0}; i < COUNT; ++i) {
+                u32 slot = hash_u64(i) % LIVE;
+                gpa->free(live[slot], 8);
+                live[slot] = gpa->allocate(64, 8);
+            }
+        }
+        for (void*& ptr : live) {
+            gpa->free(ptr, 8);
+            ptr = nullptr;
+        }
+        {
+            Perf perf{ "Pool 1m alloc/free of 64 bytes" };
+            for (u32 i{0}; i < COUNT; ++i) {
+                u32 slot = hash_u64(i) % LIVE;
+                pool.free(live[slot]);
+                live[slot] = pool.allocate(64, 8);
+            }
+        }
+        expect(pool.count() <= LIVE && pool.chunk_count() == 1, counter);
+    }
+}
+
+void slab_allocator_test() {
+    TestCounter counter("Slab Allocator");
+    {
+        static_assert(SlabAllocator::size_class_of(1) == 0 && SlabAllocator::class_size(0) == 16);
+        static_assert(SlabAllocator::class_size(SlabAllocator::size_class_of(129)) == 160);
+        static_assert(SlabAllocator::class_size(SlabAllocator::size_class_of(1000)) == 1024);
+        bool classes_fit{true};
+        for (u32 size{1}; size <= SlabAllocator::MAX_SIZE; ++size) {
+            u32 size_class = SlabAllocator::size_class_of(size);
+            classes_fit &= SlabAllocator::class_size(size_class) >= size
+                && (size_class == 0 || SlabAllocator::class_size(size_class - 1) < size);
+        }
+        expect(classes_fit, counter);
+    }
+
+    {
+        SlabAllocator slab{};
+        void* small = slab.allocate(24, 8);
+        void* other = slab.allocate(24, 8);
+        expect(slab.owns(small) && slab.usable_size(small) == 32 && other != small, counter);
+        expect(reinterpret_cast<usize>(small) % 16 == 0 && slab.span_count() == 1, counter);
+        expect(!slab.allocate(SlabAllocator::MAX_SIZE + 1, 8) && !slab.allocate(64, 64), counter);
+
+        // last freed is handed out first
+        slab.free(small);
+        expect(slab.allocate(20, 8) == small, counter);
+
+        // a class spilling into a second span gives it back once emptied
+        constexpr u32 COUNT{(SlabAllocator::SPAN_SIZE / 1024) * 2};
+        void* blocks[COUNT];
+        for (u32 i{0}; i < COUNT; ++i) {
+            blocks[i] = slab.allocate(1000, 8);
+        }
+        u32 spans_full = slab.span_count();
+        for (u32 i{0}; i < COUNT; ++i) {
+            slab.free(blocks[i]);
+        }
+        expect(spans_full == 4 && slab.span_count() == 2, counter);
+        expect(slab.allocate(1000, 8) != nullptr && slab.span_count() == 2, counter);
+    }
+
+    {
+        SlabAllocator slab{};
+        SlabThreadHeap* heap = slab.adopt_heap();
+        constexpr u32 COUNT{1000};
+        void* blocks[COUNT];
+        for (u32 i{0}; i < COUNT; ++i) {
+            blocks[i] = heap->allocate(64, 8);
+        }
+        u32 spans_before = slab.span_count();
+
+        // freed by another thread, the blocks come back to the owning heap
+        std::thread remote([&slab, &blocks] {
+            for (void* block : blocks) {
+                slab.free(block);
+            }
+        });
+        remote.join();
+
+        bool reused{true};
+        for (u32 i{0}; i < COUNT * 2; ++i) {
+            reused &= heap->allocate(64, 8) != nullptr;
+        }
+        expect(reused && slab.span_count() == spans_before, counter);
+
+        // a flushed heap with live blocks is handed to the next thread
+        void* live = heap->allocate(16, 8);
+        heap->flush();
+        SlabThreadHeap* adopted = slab.adopt_heap();
+        SlabThreadHeap* fresh = slab.adopt_heap();
+        expect(adopted == heap && fresh != heap, counter);
+        adopted->free(live);
+        expect(adopted->allocate(16, 8) == live, counter);
+        fresh->flush();
+        adopted->flush();
+    }
+
+    {
+        GeneralPurposeAllocator* gpa = get_current_gpa();
+        u8* bytes = static_cast<u8*>(gpa->allocate(20, 8));
+        sf_mem_set(bytes, 20, 7);
+        ReallocReturn same = gpa->reallocate(bytes, 32, 8);
+        ReallocReturn moved = gpa->reallocate(same.ptr, 100, 8);
+        u8* moved_bytes = static_cast<u8*>(moved.ptr);
+        expect(same.ptr == bytes && moved.ptr != bytes && moved_bytes[0] == 7 && moved_bytes[19] == 7, counter);
+        void* large = gpa->allocate(SlabAllocator::MAX_SIZE * 2, 8);
+        ReallocReturn large_moved = gpa->reallocate(large, SlabAllocator::MAX_SIZE * 4, 8);
+        gpa->free(moved.ptr);
+        gpa->free(large_moved.ptr);
+
+        std::thread workers[4];
+        std::atomic<u32> valid_count{0};
+        for (u32 t{0}; t < 4; ++t) {
+            workers[t] = std::thread([gpa, t, &valid_count] {
+                DynamicArray<u64> arr{gpa};
+                for (u64 i{0}; i < 100'000; ++i) {
+                    arr.append(i * t);
+                }
+                bool valid{true};
+                for (u64 i{0}; i < 100'000; ++i) {
+                    valid &= arr[i] == i * t;
+                }
+                valid_count += valid;
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        expect(valid_count == 4, counter);
+    }
+
+    {
+        constexpr u32 COUNT{1'000'000};
+        constexpr u32 LIVE{4096};
+        void* live[LIVE]{};
+        GeneralPurposeAllocator* gpa = get_current_gpa();
+        {
+            Perf perf{ "System 1m alloc/free of 16..512 bytes" };
+            for (u32 i{0}; i < COUNT; ++i) {
+                u32 slot = hash_u64(i) % LIVE;
+                sf_mem_free(live[slot]);
+                live[slot] = sf_mem_alloc(16 + (i % 32) * 16);
+            }
+        }
+        for (void*& ptr : live) {
+            sf_mem_free(ptr);
+            ptr = nullptr;
+        }
+        {
+            Perf perf{ "Slab GPA 1m alloc/free of 16..512 bytes" };
+            for (u32 i{0}; i < COUNT; ++i) {
+                u32 slot = hash_u64(i) % LIVE;
+                gpa->free(live[slot]);
+                live[slot] = gpa->allocate(16 + (i % 32) * 16, 8);
+            }
+        }
+        for (void* ptr : live) {
+            gpa->free(ptr);
+        }
+    }
+
+    {
+        // every thread frees its own blocks, the case thread caches serve without locks
+        constexpr u32 THREADS{4};
+        constexpr u32 COUNT{250'000};
+        auto run = [](auto alloc, auto free) {
+            std::thread workers[THREADS];
+            for (u32 t{0}; t < THREADS; ++t) {
+                workers[t] = std::thread([alloc, free, t] {
+                    constexpr u32 LIVE{1024};
+                    void* live[LIVE]{};
+                    for (u32 i{0}; i < COUNT; ++i) {
+                        u32 slot = hash_u64(i + t * COUNT) % LIVE;
+                        free(live[slot]);
+                        live[slot] = alloc(16 + (i % 32) * 16);
+                    }
+                    for (void* ptr : live) {
+                        free(ptr);
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        };
+        GeneralPurposeAllocator* gpa = get_current_gpa();
+        {
+            Perf perf{ "System 4 threads x 250k alloc/free" };
+            run([](u32 size) { return sf_mem_alloc(size); }, [](void* ptr) { sf_mem_free(ptr); });
+        }
+        {
+            Perf perf{ "Slab GPA thread caches 4 threads x 250k alloc/free" };
+            run([gpa](u32 size) { return gpa->allocate(size, 8); }, [gpa](void* ptr) { gpa->free(ptr); });
+        }
+    }
+}
+
+void hashmap_test() {
+    {
+        TestCounter counter("HashMap");
+        using MapType = HashMap<std::string_view, usize, LinearAllocator>;
+        LinearAllocator alloc(1024 * sizeof(MapType::Bucket));
+        MapType map{&alloc}; 
+        map.set_allocator(&alloc);
+        map.reserve(32);
+
+        std::string_view key1 = "kate_age";
+        std::string_view key2 = "paul_age";
+    
+        map.put(key1, 18ul);
+        map.put(key2, 20ul);
+
+        auto age1 = map.get(key1);
+        auto age2 = map.get(key2);
+
+        expect(age1, counter);
+        expect(age2, counter);
+
+        auto del1 = map.remove(key1);
+        auto del2 = map.remove(key1);
+        auto del3 = map.remove(key2);
+
+        expect(del1, counter);
+        expect(!del2, counter);
+        expect(del3, counter);
+
+        map.fill(999ul);
+        for (auto& item : map) {
+            expect(item.value == 999ul, counter);
+        }
+    }
+
+    {
+        TestCounter counter("HashMap 2");
+        using MapType = HashMap<usize, Resource, LinearAllocator>;
+        LinearAllocator alloc(1024 * sizeof(MapType::Bucket));
+        MapType map{&alloc}; 
+        map.reserve(20);
+
+        constexpr u32 COUNT{5};
+
+        for (usize i{0}; i < COUNT; ++i) {
+            map.put(i, Resource(new int(i)));
+        }
+
+        expect(map.count() == COUNT, counter);
+
+        for (usize i{0}; i < 2; ++i) {
+            map.remove(i);
+        }
+
+        expect(map.count() == COUNT - 2, counter);
+    }
+
+    {
+        TestCounter counter("HashMap remove keeps probe chains");
+        HashMap<u32, u32> map{};
+        constexpr u32 COUNT{1000};
+
+        for (u32 i{0}; i < COUNT; ++i) {
+            map.put(i, i);
+        }
+        for (u32 i{0}; i < COUNT; i += 3) {
+            map.remove(i);
+        }
+
+        bool all_found{true};
+        for (u32 i{0}; i < COUNT; ++i) {
+            u32* val = map.get(i);
+            all_found &= (i % 3 == 0) ? val == nullptr : (val && *val == i);
+        }
+        expect(all_found, counter);
+
+        // reinserting must not duplicate keys living past a tombstone
+        for (u32 i{0}; i < COUNT; ++i) {
+            map.put(i, i + 1);
+        }
+        expect(map.count() == COUNT, counter);
+        expect(map.get(COUNT - 1) && *map.get(COUNT - 1) == COUNT, counter);
+    }
+
+    {
+        TestCounter counter("HashMap custom hasher");
+        // case-insensitive keys through stateless lambdas
+        using CaseHasher = decltype([](std::string_view key) -> u64 {
+            u64 hash = OFFSET_BASIS;
+            for (char c : key) {
+                hash ^= static_cast<u8>(std::tolower(c));
+                hash *= PRIME;
+            }
+            return hash;
+        });
+        using CaseEqual = decltype([](std::string_view first, std::string_view second) {
+            return first.size() == second.size() && std::equal(first.begin(), first.end(), second.begin(), [](char a, char b) {
+                return std::tolower(a) == std::tolower(b);
+            });
+        });
+
+        HashMap<std::string_view, u32, GeneralPurposeAllocator, 32, CaseHasher, CaseEqual> map{};
+        map.put(std::string_view{"Content-Type"}, 1u);
+        map.put(std::string_view{"content-type"}, 2u);
+
+        expect(map.count() == 1, counter);
+        expect(map.get("CONTENT-TYPE") && *map.get("CONTENT-TYPE") == 2u, counter);
+        static_assert(sizeof(map) == sizeof(HashMap<std::string_view, u32>), "Stateless functors should take no space");
+
+        // runtime function pointers stay available as an explicit opt-in
+        HashMap<u32, u32, GeneralPurposeAllocator, 32, RuntimeHasher<u32>, RuntimeEqual<u32>> runtime_map{
+            get_default_config(), RuntimeHasher<u32>{ hashfn_default<u32> }, RuntimeEqual<u32>{ equal_fn_default<u32> }
+        };
+        runtime_map.put(7u, 49u);
+        expect(runtime_map.get(7u) && *runtime_map.get(7u) == 49u, counter);
+        expect(!runtime_map.get(8u), counter);
+    }
+
+    {
+        TestCounter counter("Default hash");
+        // wyhash final 4 test vector messages, seed is the message index; they cover every
+        // length class of hash_bytes: empty, 1..3, 4..16, 17..47, 48+
+        struct HashVector {
+            std::string_view message;
+            u64              expected;
+        };
+        constexpr HashVector vectors[] = {
+            { "", 0x93228a4de0eec5a2ull },
+            { "a", 0xc5bac3db178713c4ull },
+            { "abc", 0xa97f2f7b1d9b3314ull },
+            { "message digest", 0x786d1f1df3801df4ull },
+            { "abcdefghijklmnopqrstuvwxyz", 0xdca5a8138ad37c87ull },
+            { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", 0xb9e734f117cfaf70ull },
+            { "12345678901234567890123456789012345678901234567890123456789012345678901234567890", 0x6cc5eab49a92d617ull },
+        };
+        static_assert(hash_bytes(vectors[2].message.data(), vectors[2].message.size(), 2) == vectors[2].expected);
+        static_assert(hash_bytes(vectors[6].message.data(), vectors[6].message.size(), 6) == vectors[6].expected);
+        for (u64 i{0}; i < std::size(vectors); ++i) {
+            std::string_view message = vectors[i].message;
+            expect(hash_bytes(message.data(), message.size(), i) == vectors[i].expected, counter);
+        }
+        std::string_view text = vectors[5].message;
+        expect(hashfn_default<std::string_view>(text) == hash_bytes(text.data(), text.size()), counter);
+
+#if defined(__SIZEOF_INT128__)
+        // the portable multiply agrees with the native 128-bit one, carries included
+        bool mum_agrees{true};
+        for (u64 x : { 0ull, 1ull, 0xFFFF'FFFFull, 0xFFFF'FFFF'FFFF'FFFFull, 0x8000'0000'0000'0001ull, HASH_SECRET[0], HASH_SECRET[3] }) {
+            for (u64 y : { 0ull, 3ull, 0xFFFF'FFFF'0000'0000ull, 0xFFFF'FFFF'FFFF'FFFFull, HASH_SECRET[1], HASH_SECRET[2] }) {
+                u64 lo = x;
+                u64 hi = y;
+                hash_mum_portable(&lo, &hi);
+                __uint128_t product = static_cast<__uint128_t>(x) * y;
+                mum_agrees &= lo == static_cast<u64>(product) && hi == static_cast<u64>(product >> 64);
+            }
+        }
+        expect(mum_agrees, counter);
+
+        // hash_u64 folds one multiply of the key with the secrets
+        for (u64 key : { 0ull, 42ull, 0xFFFF'FFFF'FFFF'FFFFull }) {
+            __uint128_t product = static_cast<__uint128_t>(key ^ HASH_SECRET[0]) * HASH_SECRET[1];
+            expect(hash_u64(key) == (static_cast<u64>(product) ^ static_cast<u64>(product >> 64)), counter);
+        }
+#endif
+        expect(hashfn_default<const char*>("lazy dog") == hashfn_default<std::string_view>("lazy dog"), counter);
+
+        // only the live part of a FixedString feeds the hash
+        FixedString<32> first{"key"};
+        FixedString<32> second{"key with garbage"};
+        second.resize(3);
+        expect(hashfn_default<FixedString<32>>(first) == hashfn_default<FixedString<32>>(second), counter);
+
+        // sequential integers must spread over the low bits used for bucket indices
+        constexpr u32 BUCKETS = 1024;
+        FixedArray<u32, BUCKETS> hits{};
+        hits.resize_to_capacity();
+        for (u32 i{0}; i < BUCKETS; ++i) {
+            hits[i] = 0;
+        }
+        for (u32 i{0}; i < BUCKETS * 8; ++i) {
+            ++hits[hashfn_default<u32>(i) & (BUCKETS - 1)];
+        }
+        u32 max_hits{0};
+        for (u32 i{0}; i < BUCKETS; ++i) {
+            max_hits = std::max(max_hits, hits[i]);
+        }
+        expect(max_hits < 32, counter);
+    }
+
+    {
+        TestCounter counter("HashMap heterogeneous lookup");
+        HashMap<FixedString<32>, u32> map{};
+        map.put(FixedString<32>{"/users"}, 1u);
+        map.put(FixedString<32>{"/orders"}, 2u);
+
+        // probing with views into a request buffer, no key is built
+        std::string_view request{"GET /users HTTP/1.1"};
+        std::string_view path = request.substr(4, 6);
+        expect(map.get(path) && *map.get(path) == 1u, counter);
+        expect(map.get("/orders") && *map.get("/orders") == 2u, counter);
+        expect(!map.get(request.substr(4, 5)), counter);
+        expect(map.remove(std::string_view{"/orders"}), counter);
+        expect(!map.get(FixedString<32>{"/orders"}) && map.count() == 1, counter);
+
+        using StringType = String<GeneralPurposeAllocator>;
+        HashMap<StringType, u32> string_map{};
+        StringType key{get_current_gpa()};
+        key.append_sv("content-length");
+        expect(DefaultHasher<StringType>{}(key) == DefaultHasher<StringType>{}(std::string_view{"content-length"}), counter);
+        string_map.put(std::move(key), 42u);
+        expect(string_map.get("content-length") && *string_map.get("content-length") == 42u, counter);
+        expect(!string_map.get("content-type"), counter);
+
+        // functors without 'is_transparent' keep the exact key type
+        static_assert(!TransparentKey<std::string_view, u32, DefaultHasher<u32>, DefaultEqual<u32>>);
+        static_assert(!TransparentKey<const char*, std::string_view, DefaultHasher<std::string_view>, DefaultEqual<std::string_view>>);
+    }
+
+    {
+        TestCounter counter("HashMap stats");
+        HashMap<u32, u32> map{};
+        for (u32 i{0}; i < 1000; ++i) {
+            map.put(i, i);
+        }
+        map.remove(5u);
+
+        u32 hits{0};
+        for (u32 i{0}; i < 2000; ++i) {
+            hits += map.get(i) != nullptr;
+        }
+
+        HashMapStats stats = map.stats();
+        expect(stats.count == 999 && stats.tombstone_count == 1 && stats.capacity == map.capacity(), counter);
+        expect(stats.load > 0.0f && stats.load < 0.8f && stats.bytes_in_use >= stats.capacity * sizeof(HashMap<u32, u32>::Bucket), counter);
+        expect(stats.max_cluster_length >= 1 && stats.max_cluster_length < stats.capacity, counter);
+
+        if constexpr (HASHMAP_STATS_ENABLED) {
+            u64 hit_lookups{0};
+            u64 miss_lookups{0};
+            for (u32 i{0}; i < PROBE_HISTOGRAM_SIZE; ++i) {
+                hit_lookups += stats.counters.hit_probes[i];
+                miss_lookups += stats.counters.miss_probes[i];
+            }
+            // remove looks the key up too
+            expect(hit_lookups == hits + 1 && miss_lookups == 2000 - hits, counter);
+            expect(stats.counters.resize_count > 0 && stats.counters.bytes_allocated_total > stats.bytes_in_use, counter);
+        } else {
+            expect(std::is_empty_v<HashMapCountersStorage>, counter);
+        }
+    }
+
+    {
+        TestCounter counter("HashMap occupancy");
+        constexpr u32 COUNT{200'000};
+        HashMap<u32, u32> map{};
+        for (u32 i{0}; i < COUNT; ++i) {
+            map.put(i, i);
+        }
+        for (u32 i{0}; i < COUNT; ++i) {
+            if (i % 1000 != 0) {
+                map.remove(i);
+            }
+        }
+        expect(map.count() == COUNT / 1000, counter);
+
+        u32 visited{0};
+        u64 sum{0};
+        {
+            Perf perf{ "My map iterate 200 entries out of 256k buckets x1000" };
+            for (u32 r{0}; r < 1000; ++r) {
+                for (auto& bucket : map) {
+                    sum += bucket.value;
+                    ++visited;
+                }
+            }
+        }
+        expect(visited == COUNT && sum == 1000ull * 19'900'000, counter);
+
+        map.clear();
+        expect(map.count() == 0 && map.begin() == map.end() && !map.get(0u), counter);
+        map.put(5u, 50u);
+        expect(map.get(5u) && *map.get(5u) == 50 && ++map.begin() == map.end(), counter);
+        map.free();
+        expect(map.begin() == map.end(), counter);
+    }
+
+    {
+        TestCounter counter("HashMap entry api");
+        HashMap<u32, Resource> map{};
+
+        u32 factory_calls{0};
+        auto factory = [&factory_calls] { ++factory_calls; return Resource(new int(5)); };
+        Resource& first = map.find_or_insert(1u, factory);
+        Resource& second = map.find_or_insert(1u, factory);
+        expect(&first == &second && *first.ptr == 5, counter);
+        expect(factory_calls == 1 && map.count() == 1, counter);
+
+        auto inserted = map.try_emplace(2u, new int(7));
+        expect(inserted.inserted && *inserted.value->ptr == 7, counter);
+        int* unused = new int(8);
+        auto existing = map.try_emplace(2u, unused);
+        expect(!existing.inserted && existing.value == inserted.value && *existing.value->ptr == 7, counter);
+        delete unused;
+
+        // tombstones are reused like in 'put'
+        map.remove(2u);
+        expect(map.try_emplace(2u, new int(9)).inserted && *map.get(2u)->ptr == 9, counter);
+
+        constexpr u32 KEY_COUNT{1 << 16};
+        constexpr u32 OP_COUNT{4'000'000};
+        HashMap<u32, u32> counts{};
+        HashMap<u32, u32> counts_upsert{};
+        {
+            Perf perf{ "My map count, get then put" };
+            for (u32 i{0}; i < OP_COUNT; ++i) {
+                u32 key = (i * 2654435761u) % KEY_COUNT;
+                if (u32* count = counts.get(key)) {
+                    ++*count;
+                } else {
+                    counts.put(key, 1u);
+                }
+            }
+        }
+        {
+            Perf perf{ "My map count, upsert" };
+            for (u32 i{0}; i < OP_COUNT; ++i) {
+                counts_upsert.upsert((i * 2654435761u) % KEY_COUNT, [](u32& count) { ++count; });
+            }
+        }
+        expect(counts.count() == counts_upsert.count(), counter);
+        expect(*counts.get(0) == *counts_upsert.get(0) && *counts.get(KEY_COUNT - 1) == *counts_upsert.get(KEY_COUNT - 1), counter);
+    }
+}
+
+void robin_hood_hashmap_test() {
+    {
+        TestCounter counter("RobinHoodHashMap");
+        using MapType = RobinHoodHashMap<std::string_view, usize, LinearAllocator>;
+        LinearAllocator alloc(1024 * sizeof(MapType::Bucket));
+        MapType map{&alloc};
+
+        std::string_view key1 = "kate_age";
+        std::string_view key2 = "paul_age";
+
+        map.put(key1, 18ul);
+        map.put(key2, 20ul);
+        map.put(key2, 21ul);
+
+        expect(map.count() == 2, counter);
+        expect(map.get(key1) && *map.get(key1) == 18ul, counter);
+        expect(map.get(key2) && *map.get(key2) == 21ul, counter);
+        expect(!map.put_if_empty(key1, 99ul), counter);
+
+        expect(map.remove(key1), counter);
+        expect(!map.remove(key1), counter);
+        expect(!map.get(key1), counter);
+        expect(map.count() == 1, counter);
+    }
+
+    {
+        TestCounter counter("RobinHoodHashMap churn");
+        RobinHoodHashMap<u32, u32> map{};
+        constexpr u32 COUNT{10'000};
+
+        for (u32 i{0}; i < COUNT; ++i) {
+            map.put(i, i);
+        }
+        u32 capacity = map.capacity();
+
+        // constant insert/remove must neither grow the table nor lose entries
+        for (u32 round{0}; round < 10; ++round) {
+            for (u32 i{0}; i < COUNT; i += 2) {
+                map.remove(i);
+            }
+            for (u32 i{0}; i < COUNT; i += 2) {
+                map.put(i, i + round);
+            }
+        }
+        expect(map.count() == COUNT, counter);
+        expect(map.capacity() == capacity, counter);
+
+        bool all_found{true};
+        for (u32 i{0}; i < COUNT; ++i) {
+            u32* val = map.get(i);
+            all_found &= val && *val == ((i % 2 == 0) ? i + 9 : i);
+        }
+        expect(all_found, counter);
+        expect(!map.get(COUNT), counter);
+
+        u32 iterated{0};
+        for (auto& bucket : map) {
+            iterated += bucket.dist != 0;
+        }
+        expect(iterated == COUNT, counter);
+        expect(map.max_probe_length() < 64, counter);
+    }
+
+    {
+        TestCounter counter("RobinHoodHashMap 3");
+        RobinHoodHashMap<usize, Resource> map{};
+
+        constexpr u32 COUNT{5};
+        for (usize i{0}; i < COUNT; ++i) {
+            map.put(i, Resource(new int(i)));
+        }
+        for (usize i{0}; i < 2; ++i) {
+            map.remove(i);
+        }
+        expect(map.count() == COUNT - 2, counter);
+        expect(map.get(4) && *map.get(4)->ptr == 4, counter);
+    }
+}
+
+void incremental_hashmap_test() {
+    {
+        TestCounter counter("IncrementalHashMap");
+        using MapType = IncrementalHashMap<std::string_view, usize, LinearAllocator>;
+        LinearAllocator alloc(1024 * sizeof(MapType::Bucket));
+        MapType map{&alloc};
+
+        std::string_view key1 = "kate_age";
+        std::string_view key2 = "paul_age";
+
+        map.put(key1, 18ul);
+        map.put(key2, 20ul);
+        map.put(key2, 21ul);
+
+        expect(map.count() == 2, counter);
+        expect(map.get(key1) && *map.get(key1) == 18ul, counter);
+        expect(map.get(key2) && *map.get(key2) == 21ul, counter);
+        expect(map.remove(key1), counter);
+        expect(!map.remove(key1), counter);
+        expect(map.count() == 1, counter);
+    }
+
+    {
+        TestCounter counter("IncrementalHashMap migration");
+        IncrementalHashMap<u32, u32> map{};
+        constexpr u32 COUNT{100'000};
+
+        bool saw_rehash{false};
+        bool all_found{true};
+        for (u32 i{0}; i < COUNT; ++i) {
+            map.put(i, i);
+            saw_rehash |= map.is_rehashing();
+            // entries have to stay reachable while split between both tables
+            if (map.is_rehashing()) {
+                u32* val = map.get(i / 2);
+                all_found &= val && *val == i / 2;
+            }
+        }
+        expect(saw_rehash, counter);
+        expect(all_found, counter);
+        expect(map.count() == COUNT, counter);
+
+        // updates and removes of keys still waiting in the old table
+        for (u32 i{0}; i < COUNT; i += 2) {
+            map.put(i, i + 1);
+        }
+        for (u32 i{1}; i < COUNT; i += 4) {
+            map.remove(i);
+        }
+        expect(map.count() == COUNT - COUNT / 4, counter);
+
+        u32 iterated{0};
+        for (auto& bucket : map) {
+            all_found &= bucket.value == ((bucket.key % 2 == 0) ? bucket.key + 1 : bucket.key);
+            ++iterated;
+        }
+        expect(all_found, counter);
+        expect(iterated == map.count(), counter);
+
+        map.finish_rehash();
+        expect(!map.is_rehashing(), counter);
+        expect(map.get(COUNT - 2) && *map.get(COUNT - 2) == COUNT - 1, counter);
+        expect(!map.get(1), counter);
+    }
+
+    {
+        TestCounter counter("IncrementalHashMap 3");
+        IncrementalHashMap<usize, Resource> map{};
+
+        constexpr u32 COUNT{100};
+        for (usize i{0}; i < COUNT; ++i) {
+            map.put(i, Resource(new int(i)));
+        }
+        for (usize i{0}; i < 2; ++i) {
+            map.remove(i);
+        }
+        expect(map.count() == COUNT - 2, counter);
+        expect(map.get(50) && *map.get(50)->ptr == 50, counter);
+    }
+}
+
+template<typename Map>
+void measure_worst_put(std::string_view name, Map& map, u32 count) {
+    using Clock = std::chrono::steady_clock;
+    Clock::duration worst{0};
+
+    {
+        Perf perf{ name };
+        for (u32 i{0}; i < count; ++i) {
+            auto start = Clock::now();
+            map.put(i, i);
+            worst = std::max(worst, Clock::now() - start);
+        }
+    }
+
+    LOG_TEST("{}: worst single put {}us", name, std::chrono::duration_cast<std::chrono::microseconds>(worst).count());
+}
+
+void hashmap_test_resize_latency() {
+    TestCounter counter("HashMap resize latency");
+    constexpr u32 COUNT{10'000'000};
+
+    HashMap<u32, u32> map{};
+    IncrementalHashMap<u32, u32> map_incremental{};
+
+    measure_worst_put("My map put", map, COUNT);
+    measure_worst_put("My incremental map put", map_incremental, COUNT);
+}
+
+void swiss_hashmap_test() {
+    {
+        TestCounter counter("SwissHashMap");
+        using MapType = SwissHashMap<std::string_view, usize, LinearAllocator>;
+        LinearAllocator alloc(1024 * sizeof(MapType::Slot));
+        MapType map{&alloc};
+
+        std::string_view key1 = "kate_age";
+        std::string_view key2 = "paul_age";
+
+        map.put(key1, 18ul);
+        map.put(key2, 20ul);
+        map.put(key2, 21ul);
+
+        expect(map.count() == 2, counter);
+        expect(map.get(key1) && *map.get(key1) == 18ul, counter);
+        expect(map.get(key2) && *map.get(key2) == 21ul, counter);
+        expect(!map.put_if_empty(key1, 99ul), counter);
+        expect(!map.get("john_age"), counter);
+
+        expect(map.remove(key1), counter);
+        expect(!map.remove(key1), counter);
+        expect(!map.get(key1), counter);
+        expect(map.count() == 1, counter);
+    }
+
+    {
+        TestCounter counter("SwissHashMap 2");
+        SwissHashMap<u32, u32> map{};
+        constexpr u32 COUNT{10'000};
+
+        for (u32 i{0}; i < COUNT; ++i) {
+            map.put(i, i * 2);
+        }
+        expect(map.count() == COUNT, counter);
+
+        bool all_found{true};
+        for (u32 i{0}; i < COUNT; ++i) {
+            u32* val = map.get(i);
+            all_found &= val && *val == i * 2;
+        }
+        expect(all_found, counter);
+        expect(!map.get(COUNT + 1), counter);
+
+        // churn through deleted slots
+        for (u32 i{0}; i < COUNT; i += 2) {
+            map.remove(i);
+        }
+        for (u32 i{COUNT}; i < COUNT * 2; ++i) {
+            map.put(i, i * 2);
+        }
+        expect(map.count() == COUNT / 2 + COUNT, counter);
+
+        u32 iterated{0};
+        for (auto& slot : map) {
+            expect(slot.value == slot.key * 2, counter);
+            ++iterated;
+        }
+        expect(iterated == map.count(), counter);
+        expect(!map.get(0) && map.get(1) && map.get(COUNT * 2 - 1), counter);
+
+        map.clear();
+        expect(map.count() == 0 && !map.get(1), counter);
+    }
+
+    {
+        TestCounter counter("SwissHashMap 3");
+        SwissHashMap<usize, Resource> map{};
+
+        constexpr u32 COUNT{5};
+        for (usize i{0}; i < COUNT; ++i) {
+            map.put(i, Resource(new int(i)));
+        }
+        expect(map.count() == COUNT, counter);
+
+        for (usize i{0}; i < 2; ++i) {
+            map.remove(i);
+        }
+        expect(map.count() == COUNT - 2, counter);
+        expect(map.get(3) && *map.get(3)->ptr == 3, counter);
+    }
+}
+
+void frozen_hashmap_test() {
+    {
+        TestCounter counter("FixedFrozenHashMap");
+        using OpcodeMap = FixedFrozenHashMap<std::string_view, u32, 6>;
+        constexpr OpcodeMap OPCODES{{ {"add", 1}, {"sub", 2}, {"mul", 3}, {"div", 4}, {"load", 5}, {"store", 6} }};
+
+        static_assert(OPCODES.get("mul") && *OPCODES.get("mul") == 3);
+        static_assert(!OPCODES.get("jmp"));
+
+        u32 sum{0};
+        for (const auto& entry : OPCODES) {
+            sum += entry.value;
+        }
+        expect(sum == 21, counter);
+        expect(OPCODES.get(std::string_view{"store"}) && *OPCODES.get(std::string_view{"store"}) == 6, counter);
+    }
+
+    {
+        TestCounter counter("FrozenHashMap");
+        constexpr u32 COUNT{100'000};
+
+        GeneralPurposeAllocator gpa{};
+        DynamicArray<FixedString<32>, GeneralPurposeAllocator> keys{COUNT, &gpa};
+        DynamicArray<u32, GeneralPurposeAllocator> values{COUNT, &gpa};
+        HashMap<FixedString<32>, u32> map{};
+        for (u32 i{0}; i < COUNT; ++i) {
+            char buffer[32];
+            i32 len = snprintf(buffer, sizeof(buffer), "header-%u", i);
+            FixedString<32> key{std::string_view{buffer, static_cast<usize>(len)}};
+            keys.append(key);
+            values.append(i);
+            map.put(key, i);
+        }
+
+        FrozenHashMap<FixedString<32>, u32> frozen_map{
+            { keys.data(), keys.count() }, { values.data(), values.count() }
+        };
+        expect(frozen_map.count() == COUNT, counter);
+
+        bool all_found{true};
+        for (u32 i{0}; i < COUNT; ++i) {
+            const u32* value = frozen_map.get(keys[i]);
+            all_found &= value && *value == i;
+        }
+        expect(all_found, counter);
+        expect(!frozen_map.get(FixedString<32>{"header-x"}), counter);
+
+        u64 iterated_sum{0};
+        for (const auto& entry : frozen_map) {
+            iterated_sum += entry.value;
+        }
+        expect(iterated_sum == static_cast<u64>(COUNT) * (COUNT - 1) / 2, counter);
+
+        FrozenHashMap<u32, u32> small_map{{ {7, 70}, {9, 90} }};
+        expect(small_map.get(9) && *small_map.get(9) == 90 && !small_map.get(8), counter);
+
+        u64 sum{0};
+        u64 frozen_sum{0};
+        constexpr u32 ROUNDS{20};
+        {
+            Perf perf{ "My map get, 100k string keys" };
+            for (u32 r{0}; r < ROUNDS; ++r) {
+                for (u32 i{0}; i < COUNT; ++i) {
+                    sum += *map.get(keys[(i * 7919) % COUNT]);
+                }
+            }
+        }
+        {
+            Perf perf{ "My frozen map get, 100k string keys" };
+            for (u32 r{0}; r < ROUNDS; ++r) {
+                for (u32 i{0}; i < COUNT; ++i) {
+                    frozen_sum += *frozen_map.get(keys[(i * 7919) % COUNT]);
+                }
+            }
+        }
+        expect(sum == frozen_sum, counter);
+    }
+}
+
+void hashset_test() {
+    TestCounter counter("HashSet");
+    static_assert(sizeof(HashSet<u64>::Bucket) < sizeof(HashMap<u64, bool>::Bucket));
+
+    HashSet<u64> evens{};
+    HashSet<u64> thirds{};
+    for (u64 i{0}; i < 3000; ++i) {
+        if (i % 2 == 0) {
+            evens.insert(i);
+        }
+        if (i % 3 == 0) {
+            thirds.insert(i);
+        }
+    }
+    expect(!evens.insert(10ul), counter);
+    expect(evens.count() == 1500 && thirds.count() == 1000, counter);
+    expect(evens.contains(42ul) && !evens.contains(43ul), counter);
+
+    u64 iterated{0};
+    for (u64 key : evens) {
+        iterated += key % 2 == 0;
+    }
+    expect(iterated == 1500, counter);
+
+    HashSet<u64> both{};
+    both.union_with(evens);
+    both.intersect_with(thirds);
+    expect(both.count() == 500 && both.contains(6ul) && !both.contains(4ul), counter);
+
+    HashSet<u64> either{};
+    either.union_with(evens);
+    either.union_with(thirds);
+    expect(either.count() == 2000, counter);
+
+    either.difference_with(both);
+    expect(either.count() == 1500 && !either.contains(6ul) && either.contains(9ul), counter);
+    expect(either.remove(9ul) && !either.contains(9ul) && !either.remove(9ul), counter);
+
+    HashSet<std::string_view> words{};
+    words.insert(std::string_view{"alpha"});
+    words.insert(std::string_view{"beta"});
+    expect(words.contains("alpha") && !words.contains("gamma"), counter);
+
+    LinearAllocator arena{64 * 1024};
+    HashSet<u32, LinearAllocator> arena_set{&arena};
+    for (u32 i{0}; i < 100; ++i) {
+        arena_set.insert(i);
+    }
+    expect(arena_set.count() == 100 && arena_set.contains(99u), counter);
 }
 
-void hashmap_test() {
+void small_hashmap_test() {
+    TestCounter counter("SmallHashMap");
     {
-        TestCounter counter("HashMap");
-        using MapType = HashMap<std::string_view, usize, LinearAllocator>;
-        LinearAllocator alloc(1024 * sizeof(MapType::Bucket));
-        MapType map{&alloc}; 
-        map.set_allocator(&alloc);
-        map.reserve(32);
+        SmallHashMap<std::string_view, u32, 4> map{};
+        map.put(std::string_view{"host"}, 1u);
+        map.put(std::string_view{"path"}, 2u);
+        map.put(std::string_view{"host"}, 3u);
+        expect(!map.put_if_empty(std::string_view{"path"}, 9u), counter);
+        expect(map.count() == 2 && !map.is_spilled(), counter);
+        expect(map.get("host") && *map.get("host") == 3 && !map.get("query"), counter);
+        expect(map.remove("host") && !map.get("host") && map.count() == 1, counter);
+
+        for (u32 i{0}; i < 8; ++i) {
+            map.find_or_insert(std::string_view{"key"}, [] { return 0u; })++;
+        }
+        map.put(std::string_view{"a"}, 10u);
+        map.put(std::string_view{"b"}, 11u);
+        expect(!map.is_spilled() && map.count() == 4, counter);
+        map.put(std::string_view{"c"}, 12u);
+        expect(map.is_spilled() && map.count() == 5, counter);
+        expect(map.get("path") && *map.get("path") == 2, counter);
+        expect(map.get("key") && *map.get("key") == 8, counter);
+
+        u32 sum{0};
+        map.for_each([&sum](const std::string_view&, u32& value) { sum += value; });
+        expect(sum == 2 + 8 + 10 + 11 + 12, counter);
+
+        SmallHashMap<std::string_view, u32, 4> moved{std::move(map)};
+        expect(moved.count() == 5 && map.count() == 0 && !map.is_spilled(), counter);
+        moved.free();
+        expect(moved.count() == 0 && !moved.is_spilled(), counter);
+    }
 
-        std::string_view key1 = "kate_age";
-        std::string_view key2 = "paul_age";
-    
-        map.put(key1, 18ul);
-        map.put(key2, 20ul);
+    constexpr u32 MAP_COUNT{200'000};
+    u64 sum{0};
+    u64 small_sum{0};
+    {
+        Perf perf{ "My map, 200k short lived maps of 3 entries" };
+        for (u32 i{0}; i < MAP_COUNT; ++i) {
+            HashMap<u32, u32> map{};
+            map.put(i, 1u);
+            map.put(i + 1, 2u);
+            map.put(i + 2, 3u);
+            sum += *map.get(i + 1);
+        }
+    }
+    {
+        Perf perf{ "My small map, 200k short lived maps of 3 entries" };
+        for (u32 i{0}; i < MAP_COUNT; ++i) {
+            SmallHashMap<u32, u32> map{};
+            map.put(i, 1u);
+            map.put(i + 1, 2u);
+            map.put(i + 2, 3u);
+            small_sum += *map.get(i + 1);
+        }
+    }
+    expect(sum == small_sum, counter);
+}
 
-        auto age1 = map.get(key1);
-        auto age2 = map.get(key2);
+void ordered_hashmap_test() {
+    TestCounter counter("OrderedHashMap");
+    {
+        OrderedHashMap<std::string_view, u32> map{};
+        map.put(std::string_view{"content-type"}, 1u);
+        map.put(std::string_view{"host"}, 2u);
+        map.put(std::string_view{"accept"}, 3u);
+        map.put(std::string_view{"host"}, 4u);
+        expect(!map.put_if_empty(std::string_view{"accept"}, 9u), counter);
+        expect(map.count() == 3 && map.get("host") && *map.get("host") == 4, counter);
+
+        expect(map.remove("content-type") && !map.has("content-type"), counter);
+        map.put(std::string_view{"content-type"}, 5u);
+
+        u32 order[3]{};
+        u32 i{0};
+        for (auto& entry : map) {
+            order[i++] = entry.value;
+        }
+        expect(i == 3 && order[0] == 4 && order[1] == 3 && order[2] == 5, counter);
 
-        expect(age1, counter);
-        expect(age2, counter);
+        map.free();
+        map.put(std::string_view{"host"}, 6u);
+        expect(map.count() == 1 && map.get("host") && *map.get("host") == 6, counter);
+    }
 
-        auto del1 = map.remove(key1);
-        auto del2 = map.remove(key1);
-        auto del3 = map.remove(key2);
+    {
+        constexpr u32 COUNT{100'000};
+        OrderedHashMap<u32, u32> map{};
+        for (u32 i{0}; i < COUNT; ++i) {
+            map.put(i * 7919, i);
+        }
+        for (u32 i{0}; i < COUNT; i += 2) {
+            map.remove(i * 7919);
+        }
+        for (u32 i{0}; i < COUNT; i += 4) {
+            map.put(i * 7919, i);
+        }
+        expect(map.count() == COUNT / 2 + COUNT / 4, counter);
 
-        expect(del1, counter);
-        expect(!del2, counter);
-        expect(del3, counter);
+        bool all_found{true};
+        for (u32 i{0}; i < COUNT; ++i) {
+            u32* value = map.get(i * 7919);
+            bool should_have = i % 2 == 1 || i % 4 == 0;
+            all_found &= should_have ? value && *value == i : !value;
+        }
+        expect(all_found, counter);
+
+        // odd keys kept their places, re-added ones follow in insertion order
+        bool ordered{true};
+        u32 prev_odd{0};
+        u32 prev_even{0};
+        bool in_evens{false};
+        for (auto& entry : map) {
+            if (entry.value % 2 == 1) {
+                ordered &= !in_evens && entry.value >= prev_odd;
+                prev_odd = entry.value;
+            } else {
+                ordered &= entry.value >= prev_even;
+                prev_even = entry.value;
+                in_evens = true;
+            }
+        }
+        expect(ordered, counter);
 
-        map.fill(999ul);
-        for (auto& item : map) {
-            expect(item.value == 999ul, counter);
+        map.compact();
+        expect(map.count() == COUNT / 2 + COUNT / 4 && map.get(7919) && *map.get(7919) == 1, counter);
+
+        HashMap<u32, u32> hashmap{};
+        for (auto& entry : map) {
+            hashmap.put(entry.key, entry.value);
+        }
+
+        u64 sum{0};
+        u64 ordered_sum{0};
+        {
+            Perf perf{ "My map iterate 75k entries x100" };
+            for (u32 r{0}; r < 100; ++r) {
+                for (auto& bucket : hashmap) {
+                    sum += bucket.value;
+                }
+            }
         }
+        {
+            Perf perf{ "My ordered map iterate 75k entries x100" };
+            for (u32 r{0}; r < 100; ++r) {
+                for (auto& entry : map) {
+                    ordered_sum += entry.value;
+                }
+            }
+        }
+        expect(sum == ordered_sum, counter);
     }
+}
 
+void cuckoo_hashmap_test() {
+    TestCounter counter("CuckooHashMap");
     {
-        TestCounter counter("HashMap 2");
-        using MapType = HashMap<usize, Resource, LinearAllocator>;
-        LinearAllocator alloc(1024 * sizeof(MapType::Bucket));
-        MapType map{&alloc}; 
-        map.reserve(20);
+        CuckooHashMap<std::string_view, usize> map{};
+        map.put(std::string_view{"kate_age"}, 18ul);
+        map.put(std::string_view{"paul_age"}, 20ul);
+        map.put(std::string_view{"paul_age"}, 21ul);
+        expect(map.count() == 2 && map.get("kate_age") && *map.get("kate_age") == 18ul, counter);
+        expect(map.get("paul_age") && *map.get("paul_age") == 21ul && !map.get("john_age"), counter);
+        expect(!map.put_if_empty(std::string_view{"kate_age"}, 99ul), counter);
+        expect(map.remove("kate_age") && !map.has("kate_age") && !map.remove("kate_age"), counter);
+    }
 
-        constexpr u32 COUNT{5};
+    {
+        // same heterogeneous surface as HashMap, views probe without building a key
+        CuckooHashMap<FixedString<32>, u32> map{};
+        map.put(FixedString<32>{"/users"}, 1u);
+        map.put(FixedString<32>{"/orders"}, 2u);
+        std::string_view request{"GET /users HTTP/1.1"};
+        expect(map.get(request.substr(4, 6)) && *map.get(request.substr(4, 6)) == 1u, counter);
+        expect(map.has("/orders") && !map.has(request.substr(4, 5)), counter);
+        expect(map.remove(std::string_view{"/orders"}) && !map.get(FixedString<32>{"/orders"}) && map.count() == 1, counter);
+    }
 
-        for (usize i{0}; i < COUNT; ++i) {
-            map.put(i, Resource(new int(i)));
+    {
+        constexpr u32 COUNT{1'000'000};
+        HashMapConfig config{0.9f, 2.0f};
+        CuckooHashMap<u64, u64> map{config};
+        HashMap<u64, u64> hashmap{config};
+        // fingerprints and keys of a bucket share its first cache line
+        using Bucket = CuckooHashMap<u64, u64>::Bucket;
+        // the price: 80 bytes of fields padded to two lines, 32 bytes a slot instead of 20
+        static_assert(alignof(Bucket) == 64 && offsetof(Bucket, values) <= 64 && sizeof(Bucket) == 128);
+        for (u64 i{0}; i < COUNT; ++i) {
+            map.put(i * 2654435761ull, i);
+            hashmap.put(i * 2654435761ull, i);
         }
-
         expect(map.count() == COUNT, counter);
 
-        for (usize i{0}; i < 2; ++i) {
+        u64 sum{0};
+        u64 cuckoo_sum{0};
+        {
+            Perf perf{ "My map get 1m at 0.9 load" };
+            for (u64 i{0}; i < COUNT; ++i) {
+                u64* value = hashmap.get(((i * 7919) % COUNT) * 2654435761ull);
+                sum += value ? *value : 0;
+            }
+        }
+        {
+            Perf perf{ "My cuckoo map get 1m at 0.9 load" };
+            for (u64 i{0}; i < COUNT; ++i) {
+                u64* value = map.get(((i * 7919) % COUNT) * 2654435761ull);
+                cuckoo_sum += value ? *value : 0;
+            }
+        }
+        expect(sum == cuckoo_sum && sum == static_cast<u64>(COUNT) * (COUNT - 1) / 2, counter);
+        expect(!map.get(3), counter);
+
+        for (u64 i{0}; i < COUNT; i += 2) {
+            map.remove(i * 2654435761ull);
+        }
+        u64 iterated{0};
+        for (auto entry : map) {
+            iterated += entry.value % 2 == 1;
+        }
+        expect(map.count() == COUNT / 2 && iterated == COUNT / 2, counter);
+
+        map.clear();
+        expect(map.count() == 0 && map.begin() == map.end() && !map.get(2654435761ull), counter);
+    }
+
+    {
+        // nine keys on one hash fill both of their buckets, the last one has to go to the stash
+        struct CollidingHasher {
+            u64 operator()(u64 key) const noexcept { return key < 9 ? 7 : hash_u64(key); }
+        };
+        CuckooHashMap<u64, u64, GeneralPurposeAllocator, 32, CollidingHasher> map{};
+        for (u64 i{0}; i < 10'000; ++i) {
+            map.put(i, i + 1);
+        }
+        bool all_found{true};
+        for (u64 i{0}; i < 10'000; ++i) {
+            all_found &= map.get(i) && *map.get(i) == i + 1;
+        }
+        u32 stashed = map.stash_count();
+        expect(all_found && map.count() == 10'000 && stashed >= 1, counter);
+        for (u64 i{0}; i < 9; ++i) {
             map.remove(i);
         }
+        expect(map.stash_count() < stashed && map.count() == 10'000 - 9 && !map.get(4), counter);
+    }
 
-        expect(map.count() == COUNT - 2, counter);
+    {
+        // four fingerprints in this order overflow the stash halfway through a rehash, the
+        // nested resize moves the linear allocator's buffer under the entries left to move
+        struct FingerprintHasher {
+            u64 operator()(u64 key) const noexcept { return key & 0xFFFF'FFFF; }
+        };
+        constexpr u32 FINGERPRINTS[] = { 0x35a56496, 0x35a56596, 0x3f273d72, 0x3f273c72 };
+        constexpr std::string_view ORDER{"ABCDDBBABDBCDBBDCACDDBADDCBDBABBD"};
+        LinearAllocator alloc{256};
+        CuckooHashMap<u64, u64, LinearAllocator, 4, FingerprintHasher> map{4, &alloc, HashMapConfig{0.95f, 2.0f}};
+        for (u64 i{0}; i < ORDER.size(); ++i) {
+            map.put((i << 32) | FINGERPRINTS[ORDER[i] - 'A'], i);
+        }
+        bool all_found{true};
+        for (u64 i{0}; i < ORDER.size(); ++i) {
+            u64* value = map.get((i << 32) | FINGERPRINTS[ORDER[i] - 'A']);
+            all_found &= value && *value == i;
+        }
+        expect(all_found && map.count() == ORDER.size(), counter);
+    }
+}
+
+void hashmap_snapshot_test() {
+    TestCounter counter("HashMap snapshot");
+    constexpr std::string_view SNAPSHOT_PATH{"sf_hashmap_snapshot_test.bin"};
+    constexpr u32 COUNT{500'000};
+
+    {
+        HashMap<u64, u64> map{};
+        for (u64 i{0}; i < COUNT; ++i) {
+            map.put(i * 2654435761ull, i);
+        }
+        map.remove(0ull);
+        expect(save_snapshot(map, SNAPSHOT_PATH), counter);
+    }
+
+    {
+        Perf perf{ "My map rebuild 500k entries" };
+        HashMap<u64, u64> map{};
+        for (u64 i{0}; i < COUNT; ++i) {
+            map.put(i * 2654435761ull, i);
+        }
+    }
+
+    MappedHashMap<u64, u64> mapped{};
+    {
+        Perf perf{ "My mapped map open 500k entries" };
+        expect(mapped.open(SNAPSHOT_PATH), counter);
+    }
+    expect(mapped.is_open() && mapped.count() == COUNT - 1, counter);
+
+    bool all_found{true};
+    for (u64 i{1}; i < COUNT; ++i) {
+        const u64* value = mapped.get(i * 2654435761ull);
+        all_found &= value && *value == i;
+    }
+    expect(all_found && !mapped.get(0ull) && !mapped.get(3ull), counter);
+
+    u64 iterated{0};
+    mapped.for_each([&iterated](const u64&, const u64&) { ++iterated; });
+    expect(iterated == COUNT - 1, counter);
+
+    MappedHashMap<u32, u64> wrong_layout{};
+    expect(!wrong_layout.open(SNAPSHOT_PATH) && !wrong_layout.is_open(), counter);
+    expect(!wrong_layout.open("sf_missing_snapshot.bin"), counter);
+
+    mapped.close();
+    std::remove(SNAPSHOT_PATH.data());
+}
+
+void lru_cache_test() {
+    TestCounter counter("LruCache");
+    {
+        struct Evicted {
+            u64 keys[8];
+            u32 count;
+        };
+        Evicted evicted{};
+        LruCache<u64, u64> cache{3};
+        cache.set_eviction_callback([](const u64& key, u64&, void* user_data) {
+            Evicted* out = static_cast<Evicted*>(user_data);
+            out->keys[out->count++] = key;
+        }, &evicted);
+
+        cache.put(1ull, 10ull);
+        cache.put(2ull, 20ull);
+        cache.put(3ull, 30ull);
+        expect(cache.is_full() && cache.get(1ull) && *cache.get(1ull) == 10ull, counter);
+
+        // 2 is least recent after the hit on 1
+        cache.put(4ull, 40ull);
+        expect(evicted.count == 1 && evicted.keys[0] == 2 && !cache.get(2ull), counter);
+        expect(cache.peek(3ull) && cache.count() == 3, counter);
+
+        // peek did not refresh 3
+        cache.put(5ull, 50ull);
+        expect(evicted.count == 2 && evicted.keys[1] == 3, counter);
+
+        cache.put(1ull, 11ull);
+        u64 order[3]{};
+        u32 n{0};
+        cache.for_each([&](const u64& key, u64&) { order[n++] = key; });
+        expect(n == 3 && order[0] == 1 && order[1] == 5 && order[2] == 4 && *cache.peek(1ull) == 11ull, counter);
+
+        expect(cache.remove(5ull) && !cache.remove(5ull) && cache.count() == 2 && evicted.count == 2, counter);
+        cache.clear();
+        expect(cache.is_empty() && !cache.get(1ull) && evicted.count == 2, counter);
+    }
+
+    {
+        auto name_of = [](u32 i) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "user_%u", i);
+            return FixedString<32>{std::string_view{buffer}};
+        };
+        LruCache<FixedString<32>, u32> cache{64};
+        for (u32 i{0}; i < 1000; ++i) {
+            cache.put(name_of(i), i);
+        }
+        bool recent_found{true};
+        for (u32 i{1000 - 64}; i < 1000; ++i) {
+            u32* value = cache.get(name_of(i));
+            recent_found &= value && *value == i;
+        }
+        expect(recent_found && cache.count() == 64 && !cache.get(name_of(1000 - 65)), counter);
+
+        LruCache<FixedString<32>, u32> moved{std::move(cache)};
+        expect(moved.count() == 64 && cache.count() == 0 && cache.capacity() == 0, counter);
+    }
+
+    {
+        TestCounter clock_counter("ClockCache");
+        u32 evicted_count{0};
+        ClockCache<u64, u64> cache{3};
+        cache.set_eviction_callback([](const u64&, u64&, void* user_data) {
+            ++*static_cast<u32*>(user_data);
+        }, &evicted_count);
+
+        cache.put(1ull, 10ull);
+        cache.put(2ull, 20ull);
+        cache.put(3ull, 30ull);
+        cache.get(1ull);
+        cache.get(3ull);
+
+        // only 2 was not referenced since the hand last passed
+        cache.put(4ull, 40ull);
+        expect(evicted_count == 1 && !cache.get(2ull) && cache.peek(1ull) && cache.peek(3ull), clock_counter);
+        expect(cache.get(4ull) && *cache.get(4ull) == 40ull && cache.count() == 3, clock_counter);
+
+        // every entry referenced, sweep clears all bits and takes the one after the hand
+        cache.put(5ull, 50ull);
+        expect(evicted_count == 2 && cache.count() == 3 && cache.peek(5ull), clock_counter);
+
+        expect(cache.remove(5ull) && cache.count() == 2, clock_counter);
+        cache.put(6ull, 60ull);
+        expect(evicted_count == 2 && cache.peek(6ull) && cache.is_full(), clock_counter);
+    }
+
+    {
+        constexpr u32 CAPACITY{1 << 16};
+        constexpr u32 OPS{2'000'000};
+        LruCache<u64, u64> lru{CAPACITY};
+        ClockCache<u64, u64> clock{CAPACITY};
+        u64 lru_hits{0};
+        u64 clock_hits{0};
+        {
+            Perf perf{ "My lru cache 2m get/put" };
+            for (u32 i{0}; i < OPS; ++i) {
+                u64 key = hash_u64(i) % (CAPACITY * 2);
+                if (lru.get(key)) {
+                    ++lru_hits;
+                } else {
+                    lru.put(key, key);
+                }
+            }
+        }
+        {
+            Perf perf{ "My clock cache 2m get/put" };
+            for (u32 i{0}; i < OPS; ++i) {
+                u64 key = hash_u64(i) % (CAPACITY * 2);
+                if (clock.get(key)) {
+                    ++clock_hits;
+                } else {
+                    clock.put(key, key);
+                }
+            }
+        }
+        expect(lru.count() == CAPACITY && clock.count() == CAPACITY && lru_hits > 0 && clock_hits > 0, counter);
+    }
+}
+
+void string_interner_test() {
+    TestCounter counter("StringInterner");
+    {
+        ArenaAllocator arena{*get_current_gpa()};
+        StringInterner<ArenaAllocator> interner{&arena};
+        Symbol user = interner.intern("user");
+        Symbol order = interner.intern("order");
+        char buffer[]{"user"};
+        Symbol user_again = interner.intern(std::string_view{buffer});
+        expect(user == user_again && user != order && interner.count() == 2, counter);
+        expect(interner.view(user) == "user" && interner.view(user).data() != buffer, counter);
+        expect(interner.c_str(order)[5] == '\0' && interner.find("order") == order, counter);
+        expect(!interner.find("missing").is_valid() && !interner.contains("missing") && interner.count() == 2, counter);
+
+        Symbol empty = interner.intern("");
+        expect(empty.is_valid() && interner.view(empty).empty() && interner.intern("") == empty, counter);
+
+        // symbols as keys hash and compare the id only
+        HashMap<Symbol, u32> counts{};
+        counts.put(user, 1u);
+        counts.put(interner.intern("user"), 2u);
+        expect(counts.count() == 1 && *counts.get(user) == 2u && !counts.get(order), counter);
+    }
+
+    {
+        // LinearAllocator moves its buffer on growth, views go through handles
+        LinearAllocator alloc{16};
+        StringInterner<LinearAllocator> interner{&alloc};
+        constexpr u32 COUNT{10'000};
+        char buffer[32];
+        bool ids_in_order{true};
+        for (u32 i{0}; i < COUNT; ++i) {
+            i32 len = std::snprintf(buffer, sizeof(buffer), "identifier_%u", i);
+            ids_in_order &= interner.intern(std::string_view{buffer, static_cast<usize>(len)}).id == i;
+        }
+        expect(ids_in_order, counter);
+        bool all_found{true};
+        for (u32 i{0}; i < COUNT; ++i) {
+            i32 len = std::snprintf(buffer, sizeof(buffer), "identifier_%u", i);
+            std::string_view str{buffer, static_cast<usize>(len)};
+            all_found &= interner.find(str).id == i && interner.view(Symbol{i}) == str;
+        }
+        expect(all_found && interner.count() == COUNT, counter);
+
+        interner.clear();
+        expect(interner.is_empty() && !interner.contains("identifier_1"), counter);
+        expect(interner.intern("identifier_1").id == 0, counter);
+    }
+
+    {
+        // a token stream of few distinct identifiers, counted by string and by symbol
+        constexpr u32 TOKENS{1'000'000};
+        constexpr std::string_view WORDS[]{
+            "request_id", "timestamp", "user_agent", "content_length", "status",
+            "method", "path", "query_parameters", "response_time_ms", "upstream_host",
+        };
+        ArenaAllocator arena{*get_current_gpa()};
+        StringInterner<ArenaAllocator> interner{&arena};
+        Symbol symbols[10];
+        for (u32 i{0}; i < 10; ++i) {
+            symbols[i] = interner.intern(WORDS[i]);
+        }
+
+        HashMap<std::string_view, u32> by_string{};
+        HashMap<Symbol, u32> by_symbol{};
+        {
+            Perf perf{ "My map count 1m string tokens" };
+            for (u32 i{0}; i < TOKENS; ++i) {
+                ++by_string.find_or_insert(WORDS[hash_u64(i) % 10], [] { return 0u; });
+            }
+        }
+        {
+            Perf perf{ "My map count 1m symbol tokens" };
+            for (u32 i{0}; i < TOKENS; ++i) {
+                ++by_symbol.find_or_insert(symbols[hash_u64(i) % 10], [] { return 0u; });
+            }
+        }
+        bool same{true};
+        for (u32 i{0}; i < 10; ++i) {
+            same &= *by_string.get(WORDS[i]) == *by_symbol.get(symbols[i]);
+        }
+        expect(same, counter);
+    }
+}
+
+void split_hashmap_test() {
+    {
+        TestCounter counter("SplitHashMap");
+        SplitHashMap<std::string_view, usize> map{};
+
+        std::string_view key1 = "kate_age";
+        std::string_view key2 = "paul_age";
+
+        map.put(key1, 18ul);
+        map.put(key2, 20ul);
+        map.put(key2, 21ul);
+
+        expect(map.count() == 2, counter);
+        expect(map.get(key1) && *map.get(key1) == 18ul, counter);
+        expect(map.get(key2) && *map.get(key2) == 21ul, counter);
+        expect(!map.put_if_empty(key1, 99ul), counter);
+        expect(!map.get("john_age"), counter);
+
+        expect(map.remove(key1), counter);
+        expect(!map.remove(key1), counter);
+        expect(!map.get(key1) && map.has(key2), counter);
+        expect(map.count() == 1, counter);
+    }
+
+    {
+        TestCounter counter("SplitHashMap 2");
+        using MapType = SplitHashMap<u32, u32, LinearAllocator>;
+        LinearAllocator alloc(1024);
+        MapType map{&alloc};
+        constexpr u32 COUNT{10'000};
+
+        for (u32 i{0}; i < COUNT; ++i) {
+            map.put(i, i * 2);
+        }
+        // churn through tombstones
+        for (u32 i{0}; i < COUNT; i += 2) {
+            map.remove(i);
+        }
+        for (u32 i{COUNT}; i < COUNT * 2; ++i) {
+            map.put(i, i * 2);
+        }
+        expect(map.count() == COUNT / 2 + COUNT, counter);
+
+        u32 iterated{0};
+        bool all_match{true};
+        for (auto entry : map) {
+            all_match &= entry.value == entry.key * 2;
+            ++iterated;
+        }
+        expect(all_match, counter);
+        expect(iterated == map.count(), counter);
+        expect(!map.get(0) && map.get(1) && map.get(COUNT * 2 - 1), counter);
+    }
+
+    {
+        TestCounter counter("SplitHashMap large values");
+        struct Payload {
+            u64 data[16];
+        };
+        constexpr u32 COUNT{1'000'000};
+
+        HashMap<u32, Payload> map{};
+        SplitHashMap<u32, Payload> split_map{};
+        for (u32 i{0}; i < COUNT; ++i) {
+            Payload payload{};
+            payload.data[0] = i;
+            map.put(i, payload);
+            split_map.put(i, payload);
+        }
+
+        u64 sum{0};
+        u64 split_sum{0};
+        {
+            Perf perf{ "My map get miss, 128 byte values" };
+            for (u32 i{COUNT}; i < COUNT * 2; ++i) {
+                sum += map.get(i) != nullptr;
+            }
+        }
+        {
+            Perf perf{ "My split map get miss, 128 byte values" };
+            for (u32 i{COUNT}; i < COUNT * 2; ++i) {
+                split_sum += split_map.get(i) != nullptr;
+            }
+        }
+        {
+            Perf perf{ "My map get, 128 byte values" };
+            for (u32 i{0}; i < COUNT; ++i) {
+                sum += map.get(i)->data[0];
+            }
+        }
+        {
+            Perf perf{ "My split map get, 128 byte values" };
+            for (u32 i{0}; i < COUNT; ++i) {
+                split_sum += split_map.get(i)->data[0];
+            }
+        }
+        expect(sum == split_sum, counter);
     }
 }
 
@@ -299,6 +2014,7 @@ void hashmap_test_compare_std()
 
     std::unordered_map<i32, i32> mapstd;
     HashMap<i32, i32> map{};
+    SwissHashMap<i32, i32> map_swiss{};
 
 // Putting
     {
@@ -308,6 +2024,13 @@ void hashmap_test_compare_std()
         }
     }
 
+    {
+        Perf perf{ "My swiss map put" };
+        for (int i = 0; i < TEST_COUNT;++i) {
+            map_swiss.put(keys[i], i);
+        }
+    }
+
     {
         Perf perf{ "STD map put" };
         for (int i = 0; i < TEST_COUNT;++i) {
@@ -326,6 +2049,27 @@ void hashmap_test_compare_std()
         }
     }
 
+    {
+        Perf perf{ "My swiss map get" };
+        for (int i = 0; i < TEST_COUNT;++i) {
+            i32* j = map_swiss.get(keys[i]);
+            if (j && (*j == -999'999'999)) {
+                LOG_TEST("not important");
+            }
+        }
+    }
+
+    {
+        Perf perf{ "My swiss map get miss" };
+        for (int i = 0; i < TEST_COUNT;++i) {
+            // rand() never returns negative keys
+            i32* j = map_swiss.get(-keys[i] - 1);
+            if (j && (*j == -999'999'999)) {
+                LOG_TEST("not important");
+            }
+        }
+    }
+
     {
         Perf perf{ "STD map get" };
         for (int i = 0; i < TEST_COUNT;++i) {
@@ -335,6 +2079,16 @@ void hashmap_test_compare_std()
             }
         }
     }
+
+    {
+        Perf perf{ "STD map get miss" };
+        for (int i = 0; i < TEST_COUNT;++i) {
+            auto it = mapstd.find(-keys[i] - 1);
+            if (it != mapstd.end() && it->second == -999'999'999) {
+                LOG_TEST("not important");
+            }
+        }
+    }
     
 // Removing
     {
@@ -344,6 +2098,13 @@ void hashmap_test_compare_std()
         }
     }
 
+    {
+        Perf perf{ "My swiss map remove" };
+        for (int i = 0; i < TEST_COUNT;++i) {
+            map_swiss.remove(keys[i]);
+        }
+    }
+
     {
         Perf perf{ "STD map remove" };
         for (int i = 0; i < TEST_COUNT;++i) {
@@ -352,10 +2113,203 @@ void hashmap_test_compare_std()
     }
 
     printf("Capacity my: %d\n", map.count());
+    printf("Capacity my swiss: %d\n", map_swiss.count());
     printf("Capacity std: %zu\n", mapstd.size());
     printf("End\n");
 }
 
+void concurrent_hashmap_test() {
+    TestCounter counter("ConcurrentHashMap");
+    constexpr u32 THREAD_COUNT{4};
+    constexpr u32 PER_THREAD{50'000};
+
+    ConcurrentHashMap<u32, u32> map{};
+
+    // disjoint writers, then readers and removers over everything
+    std::thread writers[THREAD_COUNT];
+    for (u32 t{0}; t < THREAD_COUNT; ++t) {
+        writers[t] = std::thread([&map, t] {
+            for (u32 i{t * PER_THREAD}; i < (t + 1) * PER_THREAD; ++i) {
+                map.put(i, i * 2);
+            }
+        });
+    }
+    for (auto& thread : writers) {
+        thread.join();
+    }
+    expect(map.count() == THREAD_COUNT * PER_THREAD, counter);
+
+    std::atomic<u32> mismatches{0};
+    std::thread workers[THREAD_COUNT];
+    for (u32 t{0}; t < THREAD_COUNT; ++t) {
+        workers[t] = std::thread([&map, &mismatches, t] {
+            for (u32 i{0}; i < THREAD_COUNT * PER_THREAD; ++i) {
+                if (i % THREAD_COUNT == t) {
+                    map.remove(i);
+                } else {
+                    map.get(i, [&mismatches, i](const u32& value) {
+                        if (value != i * 2) {
+                            mismatches.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    });
+                }
+            }
+        });
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    expect(mismatches.load() == 0, counter);
+    expect(map.count() == 0, counter);
+
+    map.put(7u, 1u);
+    expect(map.update(7u, [](u32& value) { value += 41; }), counter);
+    u32 value{0};
+    expect(map.get_copy(7u, value) && value == 42, counter);
+    expect(!map.get_copy(8u, value), counter);
+
+    u32 iterated{0};
+    for (u32 i{0}; i < map.shard_count(); ++i) {
+        map.for_each_in_shard(i, [&iterated](const u32& key, const u32& value) {
+            iterated += key == 7 && value == 42;
+        });
+    }
+    expect(iterated == 1, counter);
+
+    // the key is hashed once per call, for the shard and the shard's map together
+    struct CountingHasher {
+        u32* calls;
+        u64 operator()(u32 key) const noexcept {
+            ++*calls;
+            return hash_u64(key);
+        }
+    };
+    u32 calls{0};
+    ConcurrentHashMap<u32, u32, GeneralPurposeAllocator, 64, CountingHasher> counted{get_default_config(), CountingHasher{&calls}};
+    counted.put(1u, 2u);
+    counted.put_if_empty(3u, 4u);
+    counted.get_copy(1u, value);
+    counted.update(3u, [](u32& value) { ++value; });
+    counted.remove(1u);
+    expect(calls == 5, counter);
+}
+
+// 90% reads, 10% writes over a prefilled map, from 1 thread up to all cores
+void concurrent_hashmap_test_scaling() {
+    TestCounter counter("ConcurrentHashMap scaling");
+    constexpr u32 KEY_COUNT{1'000'000};
+    constexpr u32 OPS_PER_THREAD{2'000'000};
+    u32 max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    ConcurrentHashMap<u32, u32> map{};
+    std::mutex global_lock;
+    HashMap<u32, u32> locked_map{};
+    for (u32 i{0}; i < KEY_COUNT; ++i) {
+        map.put(i, i);
+        locked_map.put(i, i);
+    }
+
+    auto run = [max_threads](std::string_view name, u32 thread_count, auto&& op) {
+        DynamicArray<std::thread, GeneralPurposeAllocator> threads{max_threads, get_current_gpa()};
+        LOG_TEST("{}: {} threads", name, thread_count);
+
+        Perf perf{ name };
+        for (u32 t{0}; t < thread_count; ++t) {
+            threads.append(std::thread([&op, t] {
+                u32 key = t * 7919;
+                for (u32 i{0}; i < OPS_PER_THREAD; ++i) {
+                    key = (key * 1103515245u + 12345u) % KEY_COUNT;
+                    op(key, i % 10 == 0);
+                }
+            }));
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+
+    for (u32 thread_count{1}; ; thread_count = std::min(thread_count * 2, max_threads)) {
+        run("Sharded map, 2M ops per thread", thread_count, [&map](u32 key, bool write) {
+            if (write) {
+                map.put(key, key + 1);
+            } else {
+                map.get(key, [](const u32&) {});
+            }
+        });
+        run("Global mutex map, 2M ops per thread", thread_count, [&locked_map, &global_lock](u32 key, bool write) {
+            std::lock_guard guard{global_lock};
+            if (write) {
+                locked_map.put(key, key + 1);
+            } else {
+                locked_map.get(key);
+            }
+        });
+        if (thread_count == max_threads) {
+            break;
+        }
+    }
+
+    expect(map.count() == KEY_COUNT, counter);
+}
+
+void hashmap_test_batched() {
+    TestCounter counter("HashMap batched");
+    constexpr u32 COUNT{8'000'000};
+
+    GeneralPurposeAllocator gpa{};
+    DynamicArray<u64, GeneralPurposeAllocator> keys{COUNT, &gpa};
+    DynamicArray<u64, GeneralPurposeAllocator> values{COUNT, &gpa};
+    for (u32 i{0}; i < COUNT; ++i) {
+        keys.append((static_cast<u64>(rand()) << 32) | i);
+        values.append(i);
+    }
+
+    HashMap<u64, u64> map{};
+    {
+        Perf perf{ "My map put_many" };
+        map.put_many({ keys.data(), keys.count() }, { values.data(), values.count() });
+    }
+    expect(map.count() == COUNT, counter);
+
+    // lookups in random order, the bucket array is far larger than cache
+    for (u32 i{COUNT - 1}; i > 0; --i) {
+        std::swap(keys[i], keys[rand() % (i + 1)]);
+    }
+
+    // both fill the same array of results, values are summed outside the timed scopes
+    DynamicArray<u64*, GeneralPurposeAllocator> out{COUNT, &gpa};
+    out.resize(COUNT);
+    {
+        Perf perf{ "My map get, one by one" };
+        for (u32 i{0}; i < COUNT; ++i) {
+            out[i] = map.get(keys[i]);
+        }
+    }
+    u64 sum{0};
+    for (u32 i{0}; i < COUNT; ++i) {
+        sum += *out[i];
+    }
+
+    sf_mem_set(out.data(), COUNT * sizeof(u64*), 0);
+    {
+        Perf perf{ "My map get_many" };
+        map.get_many({ keys.data(), keys.count() }, { out.data(), out.count() });
+    }
+    u64 batched_sum{0};
+    for (u32 i{0}; i < COUNT; ++i) {
+        batched_sum += *out[i];
+    }
+    expect(sum == batched_sum, counter);
+
+    // misses and updates go through the same paths
+    u64 missing[3] = { keys[0] + (1ull << 63), keys[1], keys[2] + (1ull << 63) };
+    u64 updates[2] = { 7, 9 };
+    map.put_many({ keys.data(), 2 }, { updates, 2 });
+    map.get_many(missing, { out.data(), 3 });
+    expect(!out[0] && out[1] && *out[1] == 9 && !out[2], counter);
+    expect(map.count() == COUNT, counter);
+}
+
 
 static constexpr u32 MAX_STR_LEN = 32;
 
@@ -472,11 +2426,30 @@ void TestManager::collect_all_tests() {
     module_tests.append(fixed_array_test);
     module_tests.append(dyn_array_test);
     module_tests.append(hashmap_test);
+    module_tests.append(robin_hood_hashmap_test);
+    module_tests.append(swiss_hashmap_test);
+    module_tests.append(incremental_hashmap_test);
+    module_tests.append(split_hashmap_test);
+    module_tests.append(frozen_hashmap_test);
+    module_tests.append(hashset_test);
+    module_tests.append(small_hashmap_test);
+    module_tests.append(ordered_hashmap_test);
+    module_tests.append(cuckoo_hashmap_test);
+    module_tests.append(hashmap_snapshot_test);
+    module_tests.append(lru_cache_test);
+    module_tests.append(string_interner_test);
     module_tests.append(hashmap_test_compare_std);
+    module_tests.append(hashmap_test_batched);
+    module_tests.append(concurrent_hashmap_test);
+    module_tests.append(concurrent_hashmap_test_scaling);
     module_tests.append(hashmap_test_strings);
+    module_tests.append(hashmap_test_resize_latency);
     module_tests.append(string_test);
     module_tests.append(linear_allocator_test);
     module_tests.append(stack_allocator_test);
+    module_tests.append(tlsf_allocator_test);
+    module_tests.append(pool_allocator_test);
+    module_tests.append(slab_allocator_test);
     module_tests.append(bitset_test);
     // module_tests.append(freelist_allocator_test);
 }
@@ -0,0 +1,403 @@
+#include "tlsf_allocator.hpp"
+#include "asserts_sf.hpp"
+#include "traits.hpp"
+#include "constants.hpp"
+#include "memory_sf.hpp"
+#include "utility.hpp"
+#include <algorithm>
+#include <bit>
+
+namespace sf {
+
+namespace {
+
+constexpr u32 align_size_up(u32 size, u32 alignment) noexcept {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+constexpr u32 size_of(const TlsfBlockHeader* header) noexcept {
+    return header->size & ~TlsfAllocator::FREE_BIT;
+}
+
+constexpr bool is_free(const TlsfBlockHeader* header) noexcept {
+    return header->size & TlsfAllocator::FREE_BIT;
+}
+
+// bin holding blocks of exactly this size
+void mapping_insert(u32 size, u32& fl, u32& sl) noexcept {
+    if (size < TlsfAllocator::SMALL_BLOCK_SIZE) {
+        fl = 0;
+        sl = size >> TlsfAllocator::ALIGN_SIZE_LOG2;
+    } else {
+        u32 log2 = 31 - std::countl_zero(size);
+        sl = (size >> (log2 - TlsfAllocator::SL_COUNT_LOG2)) ^ TlsfAllocator::SL_COUNT;
+        fl = log2 - (TlsfAllocator::FL_INDEX_SHIFT - 1);
+    }
+}
+
+// size rounded up to the last one of its bin, blocks at least this large fit the request
+u32 round_search_size(u32 size) noexcept {
+    if (size >= TlsfAllocator::SMALL_BLOCK_SIZE) {
+        u32 log2 = 31 - std::countl_zero(size);
+        size += (1u << (log2 - TlsfAllocator::SL_COUNT_LOG2)) - 1;
+    }
+    return size;
+}
+
+// first bin whose every block fits the size
+void mapping_search(u32 size, u32& fl, u32& sl) noexcept {
+    mapping_insert(round_search_size(size), fl, sl);
+}
+
+usize round_capacity(usize capacity) noexcept {
+    usize min_capacity = 4 * TlsfAllocator::HEADER_SIZE + TlsfAllocator::SMALL_BLOCK_SIZE;
+    usize rounded = (std::max(capacity, min_capacity) + TlsfAllocator::MAX_ALIGNMENT - 1) & ~static_cast<usize>(TlsfAllocator::MAX_ALIGNMENT - 1);
+    SF_ASSERT_MSG(rounded < (1ull << TlsfAllocator::FL_INDEX_MAX), "TlsfAllocator capacity is limited to 2 GiB");
+    return rounded;
+}
+
+} // namespace
+
+TlsfAllocator::TlsfAllocator() noexcept
+    : TlsfAllocator(DEFAULT_CAPACITY)
+{}
+
+TlsfAllocator::TlsfAllocator(usize capacity) noexcept
+    : _capacity{ static_cast<u32>(round_capacity(capacity)) }
+{
+    _buffer = static_cast<u8*>(sf_mem_alloc(_capacity, MAX_ALIGNMENT));
+    clear();
+}
+
+TlsfAllocator::TlsfAllocator(TlsfAllocator&& rhs) noexcept
+    : _buffer{ rhs._buffer }
+    , _capacity{ rhs._capacity }
+    , _fl_bitmap{ rhs._fl_bitmap }
+{
+    sf_mem_copy(_sl_bitmap, rhs._sl_bitmap, sizeof(_sl_bitmap));
+    sf_mem_copy(_heads, rhs._heads, sizeof(_heads));
+    rhs._buffer = nullptr;
+    rhs._capacity = 0;
+    rhs._fl_bitmap = 0;
+}
+
+TlsfAllocator& TlsfAllocator::operator=(TlsfAllocator&& rhs) noexcept {
+    if (this == &rhs) {
+        return *this;
+    }
+
+    if (_buffer) {
+        sf_mem_free(_buffer, MAX_ALIGNMENT);
+    }
+
+    _buffer = rhs._buffer;
+    _capacity = rhs._capacity;
+    _fl_bitmap = rhs._fl_bitmap;
+    sf_mem_copy(_sl_bitmap, rhs._sl_bitmap, sizeof(_sl_bitmap));
+    sf_mem_copy(_heads, rhs._heads, sizeof(_heads));
+
+    rhs._buffer = nullptr;
+    rhs._capacity = 0;
+    rhs._fl_bitmap = 0;
+
+    return *this;
+}
+
+TlsfAllocator::~TlsfAllocator() noexcept {
+    if (_buffer) {
+        sf_mem_free(_buffer, MAX_ALIGNMENT);
+        _buffer = nullptr;
+    }
+}
+
+void* TlsfAllocator::allocate(usize size, u16 alignment) noexcept {
+    u32 block = allocate_block(static_cast<u32>(size), alignment);
+    return _buffer + block + HEADER_SIZE;
+}
+
+usize TlsfAllocator::allocate_handle(usize size, u16 alignment) noexcept {
+    return allocate_block(static_cast<u32>(size), alignment) + HEADER_SIZE;
+}
+
+ReallocReturn TlsfAllocator::reallocate(void* addr, usize new_size, u16 alignment) noexcept {
+    if (addr == nullptr) {
+        return {allocate(new_size, alignment), false};
+    }
+    if (!is_address_in_range(_buffer, _capacity, addr)) {
+        return {nullptr, false};
+    }
+
+    ReallocReturnHandle res = reallocate_handle(turn_ptr_into_handle(addr, _buffer), new_size, alignment);
+    return {_buffer + res.handle, false};
+}
+
+// grows in place into a free successor when it can, otherwise moves and copies itself
+ReallocReturnHandle TlsfAllocator::reallocate_handle(usize handle, usize new_size, u16 alignment) noexcept {
+    if (handle == INVALID_ALLOC_HANDLE) {
+        return {allocate_handle(new_size, alignment), false};
+    }
+    if (!is_handle_in_range(_buffer, _capacity, handle)) {
+        return {INVALID_ALLOC_HANDLE, false};
+    }
+
+    u32 block = static_cast<u32>(handle) - HEADER_SIZE;
+    u32 size = std::max(align_size_up(static_cast<u32>(new_size), ALIGN_SIZE), MIN_BLOCK_SIZE);
+    u32 curr_size = size_of(header(block));
+
+    if (alignment <= ALIGN_SIZE || handle % alignment == 0) {
+        if (curr_size >= size) {
+            split(block, size);
+            return {handle, false};
+        }
+
+        u32 next = next_block(block);
+        TlsfBlockHeader* next_header = header(next);
+        if (is_free(next_header) && curr_size + HEADER_SIZE + size_of(next_header) >= size) {
+            remove_free(next);
+            set_size(block, curr_size + HEADER_SIZE + size_of(next_header));
+            split(block, size);
+            return {handle, false};
+        }
+    }
+
+    // offsets survive a buffer move in allocate_block
+    u32 new_block = allocate_block(size, alignment);
+    sf_mem_copy(_buffer + new_block + HEADER_SIZE, _buffer + handle, std::min(curr_size, size));
+    free_handle(handle);
+    return {new_block + HEADER_SIZE, false};
+}
+
+void* TlsfAllocator::handle_to_ptr(usize handle) const noexcept {
+#ifdef SF_DEBUG
+    if (!is_handle_in_range(_buffer, _capacity, handle) || handle == INVALID_ALLOC_HANDLE) {
+        return nullptr;
+    }
+#endif
+
+    return _buffer + handle;
+}
+
+usize TlsfAllocator::ptr_to_handle(void* ptr) const noexcept {
+#ifdef SF_DEBUG
+    if (!is_address_in_range(_buffer, _capacity, ptr) || ptr == nullptr) {
+        return INVALID_ALLOC_HANDLE;
+    }
+#endif
+
+    return turn_ptr_into_handle(ptr, _buffer);
+}
+
+void TlsfAllocator::free(void* addr, u16 alignment) noexcept {
+    if (!addr || !is_address_in_range(_buffer, _capacity, addr)) {
+        return;
+    }
+
+    free_handle(turn_ptr_into_handle(addr, _buffer), alignment);
+}
+
+void TlsfAllocator::free_handle(usize handle, u16 alignment) noexcept {
+    if (handle == INVALID_ALLOC_HANDLE || !is_handle_in_range(_buffer, _capacity, handle)) {
+        return;
+    }
+
+    u32 block = static_cast<u32>(handle) - HEADER_SIZE;
+    SF_ASSERT_MSG(!is_free(header(block)), "Double free");
+    insert_free(merge_free_neighbours(block));
+}
+
+// one free block over the whole buffer, closed by a zero sized used sentinel
+void TlsfAllocator::clear() noexcept {
+    _fl_bitmap = 0;
+    for (u32 fl{0}; fl < FL_COUNT; ++fl) {
+        _sl_bitmap[fl] = 0;
+        for (u32 sl{0}; sl < SL_COUNT; ++sl) {
+            _heads[fl][sl] = NONE;
+        }
+    }
+
+    TlsfBlockHeader* first = header(0);
+    first->prev_size = 0;
+    first->size = 0;
+    header(_capacity - HEADER_SIZE)->size = 0;
+    set_size(0, _capacity - 2 * HEADER_SIZE);
+    insert_free(0);
+}
+
+u32 TlsfAllocator::block_size(usize handle) const noexcept {
+    return size_of(header(static_cast<u32>(handle) - HEADER_SIZE));
+}
+
+TlsfBlockHeader* TlsfAllocator::header(u32 block) const noexcept {
+    return reinterpret_cast<TlsfBlockHeader*>(_buffer + block);
+}
+
+TlsfFreeLinks* TlsfAllocator::links(u32 block) const noexcept {
+    return reinterpret_cast<TlsfFreeLinks*>(_buffer + block + HEADER_SIZE);
+}
+
+u32 TlsfAllocator::next_block(u32 block) const noexcept {
+    return block + HEADER_SIZE + size_of(header(block));
+}
+
+u32 TlsfAllocator::prev_block(u32 block) const noexcept {
+    return block - HEADER_SIZE - header(block)->prev_size;
+}
+
+// keeps the free bit, and the boundary tag of the next block in sync
+void TlsfAllocator::set_size(u32 block, u32 size) noexcept {
+    TlsfBlockHeader* h = header(block);
+    h->size = size | (h->size & FREE_BIT);
+    header(next_block(block))->prev_size = size;
+}
+
+void TlsfAllocator::insert_free(u32 block) noexcept {
+    TlsfBlockHeader* h = header(block);
+    h->size |= FREE_BIT;
+
+    u32 fl, sl;
+    mapping_insert(size_of(h), fl, sl);
+    TlsfFreeLinks* l = links(block);
+    l->prev = NONE;
+    l->next = _heads[fl][sl];
+    if (l->next != NONE) {
+        links(l->next)->prev = block;
+    }
+    _heads[fl][sl] = block;
+    _fl_bitmap |= 1u << fl;
+    _sl_bitmap[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::remove_free(u32 block) noexcept {
+    TlsfBlockHeader* h = header(block);
+    h->size &= ~FREE_BIT;
+
+    u32 fl, sl;
+    mapping_insert(size_of(h), fl, sl);
+    TlsfFreeLinks* l = links(block);
+    if (l->prev != NONE) {
+        links(l->prev)->next = l->next;
+    } else {
+        _heads[fl][sl] = l->next;
+    }
+    if (l->next != NONE) {
+        links(l->next)->prev = l->prev;
+    }
+
+    if (_heads[fl][sl] == NONE) {
+        _sl_bitmap[fl] &= ~(1u << sl);
+        if (_sl_bitmap[fl] == 0) {
+            _fl_bitmap &= ~(1u << fl);
+        }
+    }
+}
+
+// head of the smallest non empty bin that fits, NONE when there is none
+u32 TlsfAllocator::find_free(u32 size) noexcept {
+    u32 fl, sl;
+    mapping_search(size, fl, sl);
+    if (fl >= FL_COUNT) {
+        return NONE;
+    }
+
+    u32 sl_map = _sl_bitmap[fl] & (~0u << sl);
+    if (sl_map == 0) {
+        u32 fl_map = fl + 1 < 32 ? _fl_bitmap & (~0u << (fl + 1)) : 0;
+        if (fl_map == 0) {
+            return NONE;
+        }
+        fl = std::countr_zero(fl_map);
+        sl_map = _sl_bitmap[fl];
+    }
+
+    return _heads[fl][std::countr_zero(sl_map)];
+}
+
+// gives the tail past 'size' of a used block back as a free block
+u32 TlsfAllocator::split(u32 block, u32 size) noexcept {
+    u32 curr_size = size_of(header(block));
+    if (curr_size - size < HEADER_SIZE + MIN_BLOCK_SIZE) {
+        return block;
+    }
+
+    set_size(block, size);
+    u32 rest = next_block(block);
+    header(rest)->size = 0;
+    set_size(rest, curr_size - size - HEADER_SIZE);
+    insert_free(merge_free_neighbours(rest));
+    return block;
+}
+
+// block is not in any bin, returns the start of the merged block
+u32 TlsfAllocator::merge_free_neighbours(u32 block) noexcept {
+    u32 next = next_block(block);
+    TlsfBlockHeader* next_header = header(next);
+    if (is_free(next_header)) {
+        remove_free(next);
+        set_size(block, size_of(header(block)) + HEADER_SIZE + size_of(next_header));
+    }
+
+    if (block != 0) {
+        u32 prev = prev_block(block);
+        TlsfBlockHeader* prev_header = header(prev);
+        if (is_free(prev_header)) {
+            remove_free(prev);
+            set_size(prev, size_of(prev_header) + HEADER_SIZE + size_of(header(block)));
+            block = prev;
+        }
+    }
+
+    return block;
+}
+
+u32 TlsfAllocator::allocate_block(u32 size, u16 alignment) noexcept {
+    SF_ASSERT_MSG(alignment <= MAX_ALIGNMENT, "TlsfAllocator alignment is limited to MAX_ALIGNMENT");
+    size = std::max(align_size_up(size, ALIGN_SIZE), MIN_BLOCK_SIZE);
+    // room to cut a free block in front of an over aligned payload
+    u32 gap_room = alignment > ALIGN_SIZE ? alignment + HEADER_SIZE + MIN_BLOCK_SIZE : 0;
+
+    u32 block = find_free(size + gap_room);
+    if (block == NONE) {
+        // a block of the raw size may land one bin below where the search starts
+        grow(round_search_size(size + gap_room));
+        block = find_free(size + gap_room);
+        SF_ASSERT_MSG(block != NONE, "Grown buffer should fit the block");
+    }
+    remove_free(block);
+
+    if (alignment > ALIGN_SIZE) {
+        u32 payload = block + HEADER_SIZE;
+        u32 aligned = align_size_up(payload, alignment);
+        if (aligned != payload) {
+            if (aligned - payload < HEADER_SIZE + MIN_BLOCK_SIZE) {
+                aligned += alignment;
+            }
+            u32 end = next_block(block);
+            u32 aligned_block = aligned - HEADER_SIZE;
+            set_size(block, aligned_block - block - HEADER_SIZE);
+            header(aligned_block)->size = 0;
+            set_size(aligned_block, end - aligned);
+            // neighbours of a free block are never free, nothing to merge
+            insert_free(block);
+            block = aligned_block;
+        }
+    }
+
+    return split(block, size);
+}
+
+// the old sentinel becomes the header of the new free space at the back
+void TlsfAllocator::grow(u32 min_free_size) noexcept {
+    usize new_capacity = round_capacity(std::max<usize>(static_cast<usize>(_capacity) * 2, static_cast<usize>(_capacity) + min_free_size + 2 * HEADER_SIZE));
+    u8* new_buffer = static_cast<u8*>(sf_mem_alloc(new_capacity, MAX_ALIGNMENT));
+    sf_mem_copy(new_buffer, _buffer, _capacity);
+    sf_mem_free(_buffer, MAX_ALIGNMENT);
+    _buffer = new_buffer;
+
+    u32 block = _capacity - HEADER_SIZE;
+    _capacity = static_cast<u32>(new_capacity);
+    header(_capacity - HEADER_SIZE)->size = 0;
+    set_size(block, _capacity - HEADER_SIZE - block - HEADER_SIZE);
+    insert_free(merge_free_neighbours(block));
+}
+
+} // sf